@@ -0,0 +1,260 @@
+#include "Bounds.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Sphere fitting runs in double precision, as circumspheres of
+	// nearly flat point sets lose a lot of precision in floats
+	struct Point
+	{
+		double x, y, z;
+
+		Point operator+(const Point& other) const { return { x + other.x, y + other.y, z + other.z }; }
+		Point operator-(const Point& other) const { return { x - other.x, y - other.y, z - other.z }; }
+		Point operator*(double scale) const { return { x * scale, y * scale, z * scale }; }
+	};
+
+	double Dot(const Point& a, const Point& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Point Cross(const Point& a, const Point& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+
+	struct Ball
+	{
+		Point center;
+		double radiusSq;	// Negative for the empty ball
+
+		bool Contains(const Point& p) const
+		{
+			Point offset = p - center;
+			return Dot(offset, offset) <= radiusSq * (1.0 + 1e-10) + 1e-20;
+		}
+	};
+
+	Ball BallThrough(const Point& a)
+	{
+		return { a, 0.0 };
+	}
+
+	Ball BallThrough(const Point& a, const Point& b)
+	{
+		Point center = (a + b) * 0.5;
+		Point offset = a - center;
+		return { center, Dot(offset, offset) };
+	}
+
+	// Smallest of the given balls that contains every point, used
+	// when the points are too close to collinear or coplanar
+	Ball SmallestContaining(const Ball* balls, int ballCount, const Point* points, int pointCount)
+	{
+		Ball best = { {}, -1.0 };
+		for (int b = 0; b < ballCount; b++)
+		{
+			bool containsAll = true;
+			for (int p = 0; p < pointCount; p++)
+				containsAll = containsAll && balls[b].Contains(points[p]);
+
+			if (containsAll && (best.radiusSq < 0.0 || balls[b].radiusSq < best.radiusSq))
+				best = balls[b];
+		}
+
+		return best;
+	}
+
+	// Circumcircle of a triangle, in its own plane
+	Ball BallThrough(const Point& a, const Point& b, const Point& c)
+	{
+		Point ab = b - a;
+		Point ac = c - a;
+		Point normal = Cross(ab, ac);
+		double normalLengthSq = Dot(normal, normal);
+
+		if (normalLengthSq <= 1e-24 * Dot(ab, ab) * Dot(ac, ac))
+		{
+			Point points[3] = { a, b, c };
+			Ball pairs[3] = { BallThrough(a, b), BallThrough(b, c), BallThrough(c, a) };
+			return SmallestContaining(pairs, 3, points, 3);
+		}
+
+		Point offset = Cross(ab * Dot(ac, ac) - ac * Dot(ab, ab), normal) * (-0.5 / normalLengthSq);
+		return { a + offset, Dot(offset, offset) };
+	}
+
+	// Circumsphere of a tetrahedron
+	Ball BallThrough(const Point& a, const Point& b, const Point& c, const Point& d)
+	{
+		Point ab = b - a;
+		Point ac = c - a;
+		Point ad = d - a;
+		double determinant = Dot(ab, Cross(ac, ad));
+		double scale = sqrt(Dot(ab, ab) * Dot(ac, ac) * Dot(ad, ad));
+
+		if (fabs(determinant) <= 1e-12 * scale)
+		{
+			Point points[4] = { a, b, c, d };
+			Ball triangles[4] = { BallThrough(a, b, c), BallThrough(a, b, d), BallThrough(a, c, d), BallThrough(b, c, d) };
+			return SmallestContaining(triangles, 4, points, 4);
+		}
+
+		Point offset = (
+			Cross(ac, ad) * Dot(ab, ab) +
+			Cross(ad, ab) * Dot(ac, ac) +
+			Cross(ab, ac) * Dot(ad, ad)) * (0.5 / determinant);
+		return { a + offset, Dot(offset, offset) };
+	}
+}
+
+
+// --------------------------------------------------------
+// Builds a box from its corners
+// --------------------------------------------------------
+Aabb Aabb::FromMinMax(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	Aabb box;
+	box.center = XMFLOAT3(
+		(boundsMin.x + boundsMax.x) * 0.5f,
+		(boundsMin.y + boundsMax.y) * 0.5f,
+		(boundsMin.z + boundsMax.z) * 0.5f);
+	box.extents = XMFLOAT3(
+		(boundsMax.x - boundsMin.x) * 0.5f,
+		(boundsMax.y - boundsMin.y) * 0.5f,
+		(boundsMax.z - boundsMin.z) * 0.5f);
+	return box;
+}
+
+// --------------------------------------------------------
+// The box around every vertex position
+// --------------------------------------------------------
+Aabb Aabb::FromVertices(const Vertex* vertices, size_t vertexCount)
+{
+	if (vertexCount == 0)
+		return { XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 0) };
+
+	XMVECTOR minimum = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR maximum = minimum;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&vertices[i].Position);
+		minimum = XMVectorMin(minimum, position);
+		maximum = XMVectorMax(maximum, position);
+	}
+
+	XMFLOAT3 boundsMin, boundsMax;
+	XMStoreFloat3(&boundsMin, minimum);
+	XMStoreFloat3(&boundsMax, maximum);
+	return FromMinMax(boundsMin, boundsMax);
+}
+
+XMFLOAT3 Aabb::Min() const
+{
+	return XMFLOAT3(center.x - extents.x, center.y - extents.y, center.z - extents.z);
+}
+
+XMFLOAT3 Aabb::Max() const
+{
+	return XMFLOAT3(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+}
+
+// --------------------------------------------------------
+// Transforms the box without touching its corners
+// (Arvo, "Transforming Axis-Aligned Bounding Boxes")
+// --------------------------------------------------------
+Aabb Aabb::Transform(const XMFLOAT4X4& matrix) const
+{
+	XMMATRIX m = XMLoadFloat4x4(&matrix);
+
+	XMVECTOR newCenter = XMVector3Transform(XMLoadFloat3(&center), m);
+	XMVECTOR newExtents =
+		XMVectorAbs(m.r[0]) * extents.x +
+		XMVectorAbs(m.r[1]) * extents.y +
+		XMVectorAbs(m.r[2]) * extents.z;
+
+	Aabb box;
+	XMStoreFloat3(&box.center, newCenter);
+	XMStoreFloat3(&box.extents, newExtents);
+	return box;
+}
+
+// --------------------------------------------------------
+// The smallest sphere around every vertex position
+// - Welzl's algorithm, on shuffled points (fixed seed, so
+//   the same mesh always gets the same sphere)
+// --------------------------------------------------------
+Sphere Sphere::FromVertices(const Vertex* vertices, size_t vertexCount)
+{
+	if (vertexCount == 0)
+		return { XMFLOAT3(0, 0, 0), 0.0f };
+
+	std::vector<Point> points(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		points[i] = { vertices[i].Position.x, vertices[i].Position.y, vertices[i].Position.z };
+
+	std::shuffle(points.begin(), points.end(), std::mt19937(12345));
+
+	// Each time a point falls outside, it must be on the boundary of the
+	// smallest ball around it and every earlier point, so that ball is
+	// rebuilt with it as a support point (up to four deep)
+	Ball ball = BallThrough(points[0]);
+	for (size_t i = 1; i < points.size(); i++)
+	{
+		if (ball.Contains(points[i]))
+			continue;
+
+		ball = BallThrough(points[i]);
+		for (size_t j = 0; j < i; j++)
+		{
+			if (ball.Contains(points[j]))
+				continue;
+
+			ball = BallThrough(points[i], points[j]);
+			for (size_t k = 0; k < j; k++)
+			{
+				if (ball.Contains(points[k]))
+					continue;
+
+				ball = BallThrough(points[i], points[j], points[k]);
+				for (size_t l = 0; l < k; l++)
+				{
+					if (!ball.Contains(points[l]))
+						ball = BallThrough(points[i], points[j], points[k], points[l]);
+				}
+			}
+		}
+	}
+
+	// Round the radius up so float positions are never just outside
+	Sphere sphere;
+	sphere.center = XMFLOAT3((float)ball.center.x, (float)ball.center.y, (float)ball.center.z);
+	sphere.radius = (float)sqrt(std::max(ball.radiusSq, 0.0));
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR offset = XMLoadFloat3(&vertices[i].Position) - XMLoadFloat3(&sphere.center);
+		sphere.radius = std::max(sphere.radius, XMVectorGetX(XMVector3Length(offset)));
+	}
+
+	return sphere;
+}
+
+// --------------------------------------------------------
+// Transforms the sphere, growing it by the largest scale so
+// it still fits non-uniformly scaled contents
+// --------------------------------------------------------
+Sphere Sphere::Transform(const XMFLOAT4X4& matrix) const
+{
+	Sphere sphere;
+	XMStoreFloat3(&sphere.center, XMVector3Transform(XMLoadFloat3(&center), XMLoadFloat4x4(&matrix)));
+	sphere.radius = radius * Bounds::MaxScale(matrix);
+	return sphere;
+}
+
+float Bounds::MaxScale(const XMFLOAT4X4& matrix)
+{
+	float scaleSq = std::max({
+		matrix._11 * matrix._11 + matrix._12 * matrix._12 + matrix._13 * matrix._13,
+		matrix._21 * matrix._21 + matrix._22 * matrix._22 + matrix._23 * matrix._23,
+		matrix._31 * matrix._31 + matrix._32 * matrix._32 + matrix._33 * matrix._33 });
+	return sqrtf(scaleSq);
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// An axis-aligned bounding box, as a center and half extents
+// --------------------------------------------------------
+struct Aabb
+{
+	DirectX::XMFLOAT3 center;
+	DirectX::XMFLOAT3 extents;
+
+	static Aabb FromMinMax(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+	static Aabb FromVertices(const Vertex* vertices, size_t vertexCount);
+
+	DirectX::XMFLOAT3 Min() const;
+	DirectX::XMFLOAT3 Max() const;
+
+	// The box around this box after transforming it (not re-fit to the contents)
+	Aabb Transform(const DirectX::XMFLOAT4X4& matrix) const;
+};
+
+// --------------------------------------------------------
+// A bounding sphere
+// --------------------------------------------------------
+struct Sphere
+{
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	// The smallest sphere around every vertex position
+	static Sphere FromVertices(const Vertex* vertices, size_t vertexCount);
+
+	// Still contains everything after transforming, for any scale or rotation
+	Sphere Transform(const DirectX::XMFLOAT4X4& matrix) const;
+};
+
+// --------------------------------------------------------
+// Helpers shared by the bounds and anything scaling
+// local space distances into world space
+// --------------------------------------------------------
+namespace Bounds
+{
+	// Largest length of the matrix's three axes, which is the most
+	// it can stretch a distance
+	float MaxScale(const DirectX::XMFLOAT4X4& matrix);
+}
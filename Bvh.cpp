@@ -0,0 +1,458 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace
+{
+	// Split candidates per axis, at most (small nodes use fewer
+	// bins, as they have fewer items to tell apart)
+	const int BinCount = 16;
+
+	// Leaves bigger than this are always split, even where the
+	// heuristic would rather not
+	const unsigned int MaxLeafSize = 4;
+
+	// Cost of visiting a node, relative to testing an item's box
+	const float TraversalCost = 1.0f;
+
+	// Marks a stack entry whose node is entirely inside the query
+	const unsigned int InsideFlag = 0x80000000;
+
+	float SurfaceArea(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+	{
+		float x = boundsMax.x - boundsMin.x;
+		float y = boundsMax.y - boundsMin.y;
+		float z = boundsMax.z - boundsMin.z;
+		return 2.0f * (x * y + y * z + z * x);
+	}
+
+	void Grow(XMFLOAT3& boundsMin, XMFLOAT3& boundsMax, const XMFLOAT3& pointMin, const XMFLOAT3& pointMax)
+	{
+		boundsMin = XMFLOAT3(std::min(boundsMin.x, pointMin.x), std::min(boundsMin.y, pointMin.y), std::min(boundsMin.z, pointMin.z));
+		boundsMax = XMFLOAT3(std::max(boundsMax.x, pointMax.x), std::max(boundsMax.y, pointMax.y), std::max(boundsMax.z, pointMax.z));
+	}
+
+	float Component(const XMFLOAT3& vector, int axis)
+	{
+		return axis == 0 ? vector.x : axis == 1 ? vector.y : vector.z;
+	}
+
+	bool MinMaxTouchesSphere(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax, const Sphere& sphere)
+	{
+		// Distance from the center to the nearest point in the box
+		float x = std::max(std::max(boundsMin.x - sphere.center.x, sphere.center.x - boundsMax.x), 0.0f);
+		float y = std::max(std::max(boundsMin.y - sphere.center.y, sphere.center.y - boundsMax.y), 0.0f);
+		float z = std::max(std::max(boundsMin.z - sphere.center.z, sphere.center.z - boundsMax.z), 0.0f);
+		return x * x + y * y + z * z <= sphere.radius * sphere.radius;
+	}
+
+	// --------------------------------------------------------
+	// Slab test
+	// - fminf/fmaxf drop the NaN that a ray lying exactly in a
+	//   slab's plane produces (0 * infinity), treating it as
+	//   inside that slab
+	// --------------------------------------------------------
+	bool MinMaxRayEnters(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax,
+		const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance, float& distance)
+	{
+		float x1 = (boundsMin.x - origin.x) * inverseDirection.x;
+		float x2 = (boundsMax.x - origin.x) * inverseDirection.x;
+		float y1 = (boundsMin.y - origin.y) * inverseDirection.y;
+		float y2 = (boundsMax.y - origin.y) * inverseDirection.y;
+		float z1 = (boundsMin.z - origin.z) * inverseDirection.z;
+		float z2 = (boundsMax.z - origin.z) * inverseDirection.z;
+
+		float enter = fmaxf(fmaxf(fmaxf(fminf(x1, x2), fminf(y1, y2)), fminf(z1, z2)), 0.0f);
+		float exit = fminf(fminf(fmaxf(x1, x2), fmaxf(y1, y2)), fmaxf(z1, z2));
+		if (exit < enter || enter > maxDistance)
+			return false;
+
+		distance = enter;
+		return true;
+	}
+}
+
+
+Bvh::Bvh()
+	: builtCost(0.0f),
+	cost(0.0f)
+{
+}
+
+// --------------------------------------------------------
+// Builds the whole tree from scratch, top down
+// --------------------------------------------------------
+void Bvh::Build(const std::vector<Aabb>& bounds)
+{
+	SetItemBounds(bounds);
+	nodes.clear();
+	itemOrder.resize(bounds.size());
+	for (unsigned int i = 0; i < (unsigned int)bounds.size(); i++)
+		itemOrder[i] = i;
+
+	if (!bounds.empty())
+	{
+		std::vector<XMFLOAT3> centroids(bounds.size());
+		for (size_t i = 0; i < bounds.size(); i++)
+			centroids[i] = bounds[i].center;
+
+		// Never more than 2n - 1 nodes, and reserving them up front
+		// keeps node references valid during the build
+		nodes.reserve(bounds.size() * 2);
+		nodes.push_back({});
+		BuildNode(0, 0, (unsigned int)bounds.size(), centroids);
+	}
+
+	builtCost = ComputeCost();
+	cost = builtCost;
+}
+
+void Bvh::SetItemBounds(const std::vector<Aabb>& bounds)
+{
+	itemBounds = bounds;
+	itemMins.resize(bounds.size());
+	itemMaxs.resize(bounds.size());
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		itemMins[i] = bounds[i].Min();
+		itemMaxs[i] = bounds[i].Max();
+	}
+}
+
+// --------------------------------------------------------
+// Fits a node around its items, then splits them where the
+// binned surface area heuristic finds it cheapest
+// - Items sharing one centroid are simply halved
+// --------------------------------------------------------
+void Bvh::BuildNode(unsigned int nodeIndex, unsigned int first, unsigned int count, const std::vector<XMFLOAT3>& centroids)
+{
+	Node& node = nodes[nodeIndex];
+	node.first = first;
+	node.count = count;
+	FitNode(node);
+	if (count <= 1)
+		return;
+
+	XMFLOAT3 centroidMin = centroids[itemOrder[first]];
+	XMFLOAT3 centroidMax = centroidMin;
+	for (unsigned int i = first; i < first + count; i++)
+		Grow(centroidMin, centroidMax, centroids[itemOrder[i]], centroids[itemOrder[i]]);
+
+	int binCount = std::min(BinCount, (int)count);
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float axisMin = Component(centroidMin, axis);
+		float extent = Component(centroidMax, axis) - axisMin;
+		if (extent <= 0.0f)
+			continue;
+
+		struct Bin { XMFLOAT3 boundsMin; XMFLOAT3 boundsMax; unsigned int count; };
+		Bin bins[BinCount];
+		for (int b = 0; b < binCount; b++)
+			bins[b] = { XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX), XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX), 0 };
+
+		float scale = binCount / extent;
+		for (unsigned int i = first; i < first + count; i++)
+		{
+			unsigned int item = itemOrder[i];
+			int b = std::min(binCount - 1, (int)((Component(centroids[item], axis) - axisMin) * scale));
+			Grow(bins[b].boundsMin, bins[b].boundsMax, itemMins[item], itemMaxs[item]);
+			bins[b].count++;
+		}
+
+		// Areas and counts to the right of each boundary, then sweep from the left
+		float rightArea[BinCount];
+		unsigned int rightCount[BinCount];
+		XMFLOAT3 sweepMin(FLT_MAX, FLT_MAX, FLT_MAX), sweepMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		unsigned int sweepCount = 0;
+		for (int b = binCount - 1; b > 0; b--)
+		{
+			Grow(sweepMin, sweepMax, bins[b].boundsMin, bins[b].boundsMax);
+			sweepCount += bins[b].count;
+			rightArea[b] = sweepCount > 0 ? SurfaceArea(sweepMin, sweepMax) : 0.0f;
+			rightCount[b] = sweepCount;
+		}
+
+		sweepMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		sweepMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		sweepCount = 0;
+		for (int split = 1; split < binCount; split++)
+		{
+			Grow(sweepMin, sweepMax, bins[split - 1].boundsMin, bins[split - 1].boundsMax);
+			sweepCount += bins[split - 1].count;
+			if (sweepCount == 0 || rightCount[split] == 0)
+				continue;
+
+			float splitCost = SurfaceArea(sweepMin, sweepMax) * sweepCount + rightArea[split] * rightCount[split];
+			if (splitCost < bestCost)
+			{
+				bestCost = splitCost;
+				bestAxis = axis;
+				bestSplit = split;
+			}
+		}
+	}
+
+	float area = SurfaceArea(node.boundsMin, node.boundsMax);
+	float leafCost = area * count;
+	bool worthSplitting = bestAxis >= 0 && TraversalCost * area + bestCost < leafCost;
+	if (!worthSplitting && count <= MaxLeafSize)
+		return;
+
+	unsigned int leftCount;
+	if (bestAxis >= 0)
+	{
+		float axisMin = Component(centroidMin, bestAxis);
+		float scale = binCount / (Component(centroidMax, bestAxis) - axisMin);
+		unsigned int* middle = std::partition(&itemOrder[first], &itemOrder[first] + count, [&](unsigned int item)
+		{
+			return std::min(binCount - 1, (int)((Component(centroids[item], bestAxis) - axisMin) * scale)) < bestSplit;
+		});
+		leftCount = (unsigned int)(middle - &itemOrder[first]);
+	}
+	else
+	{
+		leftCount = count / 2;
+	}
+
+	unsigned int left = (unsigned int)nodes.size();
+	nodes.push_back({});
+	nodes.push_back({});
+	nodes[nodeIndex].first = left;
+	nodes[nodeIndex].count = 0;
+
+	BuildNode(left, first, leftCount, centroids);
+	BuildNode(left + 1, first + leftCount, count - leftCount, centroids);
+}
+
+// Fits a leaf around its items, or an interior node around its children
+void Bvh::FitNode(Node& node)
+{
+	node.boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	node.boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	if (node.count == 0)
+	{
+		Grow(node.boundsMin, node.boundsMax, nodes[node.first].boundsMin, nodes[node.first].boundsMax);
+		Grow(node.boundsMin, node.boundsMax, nodes[node.first + 1].boundsMin, nodes[node.first + 1].boundsMax);
+		return;
+	}
+
+	for (unsigned int i = node.first; i < node.first + node.count; i++)
+		Grow(node.boundsMin, node.boundsMax, itemMins[itemOrder[i]], itemMaxs[itemOrder[i]]);
+}
+
+// --------------------------------------------------------
+// Surface area heuristic cost of the whole tree: the chance
+// of reaching each node (its area over the root's) times the
+// work done there
+// --------------------------------------------------------
+float Bvh::ComputeCost() const
+{
+	if (nodes.empty())
+		return 0.0f;
+
+	float rootArea = SurfaceArea(nodes[0].boundsMin, nodes[0].boundsMax);
+	if (rootArea <= 0.0f)
+		return 0.0f;
+
+	float total = 0.0f;
+	for (const Node& node : nodes)
+	{
+		float area = SurfaceArea(node.boundsMin, node.boundsMax);
+		total += node.count == 0 ? TraversalCost * area : node.count * area;
+	}
+
+	return total / rootArea;
+}
+
+// --------------------------------------------------------
+// Children always come after their parent, so walking the
+// nodes backwards refits every child before its parent
+// --------------------------------------------------------
+void Bvh::Refit(const std::vector<Aabb>& bounds)
+{
+	if (bounds.size() != itemBounds.size())
+		throw std::invalid_argument("Refit needs the same number of items as the last build");
+
+	SetItemBounds(bounds);
+	for (size_t i = nodes.size(); i-- > 0;)
+		FitNode(nodes[i]);
+
+	cost = ComputeCost();
+}
+
+bool Bvh::NeedsRebuild(float costRatio) const
+{
+	return cost > builtCost * costRatio;
+}
+
+
+// --------------------------------------------------------
+// Queries
+// - Nodes entirely inside the frustum hand over all of their
+//   items without testing any more boxes
+// --------------------------------------------------------
+void Bvh::QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& items) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		unsigned int entry = stack.back();
+		stack.pop_back();
+
+		const Node& node = nodes[entry & ~InsideFlag];
+		bool inside = (entry & InsideFlag) != 0;
+		if (!inside)
+		{
+			Aabb box = Aabb::FromMinMax(node.boundsMin, node.boundsMax);
+			if (!frustum.IntersectsBox(box.center, box.extents))
+				continue;
+
+			inside = frustum.ContainsBox(box.center, box.extents);
+		}
+
+		if (node.count == 0)
+		{
+			stack.push_back(node.first | (inside ? InsideFlag : 0));
+			stack.push_back((node.first + 1) | (inside ? InsideFlag : 0));
+			continue;
+		}
+
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+		{
+			const Aabb& box = itemBounds[itemOrder[i]];
+			if (inside || frustum.IntersectsBox(box.center, box.extents))
+				items.push_back(itemOrder[i]);
+		}
+	}
+}
+
+void Bvh::QuerySphere(const Sphere& sphere, std::vector<unsigned int>& items) const
+{
+	if (nodes.empty())
+		return;
+
+	std::vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+		if (!MinMaxTouchesSphere(node.boundsMin, node.boundsMax, sphere))
+			continue;
+
+		if (node.count == 0)
+		{
+			stack.push_back(node.first);
+			stack.push_back(node.first + 1);
+			continue;
+		}
+
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+		{
+			if (BvhTests::BoxTouchesSphere(itemBounds[itemOrder[i]], sphere))
+				items.push_back(itemOrder[i]);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Visits the nearer child first, and skips any node the ray
+// only reaches beyond the closest hit so far
+// - direction is expected to be unit length
+// --------------------------------------------------------
+bool Bvh::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+
+	XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	float nearest = maxDistance;
+	bool found = false;
+
+	std::vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty())
+	{
+		const Node& node = nodes[stack.back()];
+		stack.pop_back();
+
+		// Checked again, as a hit since it was pushed may have moved nearer
+		float distance;
+		if (!MinMaxRayEnters(node.boundsMin, node.boundsMax, origin, inverseDirection, nearest, distance))
+			continue;
+
+		if (node.count == 0)
+		{
+			float leftDistance, rightDistance;
+			bool left = MinMaxRayEnters(nodes[node.first].boundsMin, nodes[node.first].boundsMax, origin, inverseDirection, nearest, leftDistance);
+			bool right = MinMaxRayEnters(nodes[node.first + 1].boundsMin, nodes[node.first + 1].boundsMax, origin, inverseDirection, nearest, rightDistance);
+
+			// The nearer child goes on the stack last, to be visited first
+			if (left && right && leftDistance < rightDistance)
+			{
+				stack.push_back(node.first + 1);
+				stack.push_back(node.first);
+			}
+			else
+			{
+				if (left)
+					stack.push_back(node.first);
+				if (right)
+					stack.push_back(node.first + 1);
+			}
+			continue;
+		}
+
+		for (unsigned int i = node.first; i < node.first + node.count; i++)
+		{
+			float itemDistance;
+			if (BvhTests::RayEntersBox(itemBounds[itemOrder[i]], origin, inverseDirection, nearest, itemDistance) &&
+				(!found || itemDistance < nearest))
+			{
+				nearest = itemDistance;
+				hit = { itemOrder[i], itemDistance };
+				found = true;
+			}
+		}
+	}
+
+	return found;
+}
+
+
+//--------
+// Getters
+//--------
+size_t Bvh::GetItemCount() const { return itemBounds.size(); }
+size_t Bvh::GetNodeCount() const { return nodes.size(); }
+float Bvh::GetCost() const { return cost; }
+float Bvh::GetBuiltCost() const { return builtCost; }
+
+
+bool BvhTests::BoxTouchesSphere(const Aabb& box, const Sphere& sphere)
+{
+	return MinMaxTouchesSphere(box.Min(), box.Max(), sphere);
+}
+
+bool BvhTests::RayEntersBox(const Aabb& box, const XMFLOAT3& origin, const XMFLOAT3& inverseDirection,
+	float maxDistance, float& distance)
+{
+	return MinMaxRayEnters(box.Min(), box.Max(), origin, inverseDirection, maxDistance, distance);
+}
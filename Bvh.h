@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+#include "Bounds.h"
+#include "Frustum.h"
+
+// --------------------------------------------------------
+// A bounding volume hierarchy over a set of boxes
+// - Build() for content that doesn't move, Refit() every
+//   frame for things that do, until NeedsRebuild()
+// - Queries return exactly what testing every box would
+// --------------------------------------------------------
+class Bvh
+{
+
+public:
+
+	struct RayHit
+	{
+		unsigned int item;
+		float distance;		// Along the (unit length) direction, to the box
+	};
+
+private:
+
+	// Interior nodes have no items, and their children are next
+	// to each other at first and first + 1; leaves own items
+	// [first, first + count) of itemOrder
+	struct Node
+	{
+		DirectX::XMFLOAT3 boundsMin;
+		unsigned int first;
+		DirectX::XMFLOAT3 boundsMax;
+		unsigned int count;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<unsigned int> itemOrder;
+	std::vector<Aabb> itemBounds;
+
+	// The same boxes as corners, for fitting nodes around them
+	std::vector<DirectX::XMFLOAT3> itemMins;
+	std::vector<DirectX::XMFLOAT3> itemMaxs;
+
+	// Expected cost of a query, relative to testing the root, when
+	// last built and now
+	float builtCost;
+	float cost;
+
+	void SetItemBounds(const std::vector<Aabb>& bounds);
+	void BuildNode(unsigned int nodeIndex, unsigned int first, unsigned int count, const std::vector<DirectX::XMFLOAT3>& centroids);
+	void FitNode(Node& node);
+	float ComputeCost() const;
+
+public:
+
+	// Constructor
+	Bvh();
+
+	void Build(const std::vector<Aabb>& bounds);
+
+	// Same items as the last Build(), with new boxes
+	void Refit(const std::vector<Aabb>& bounds);
+
+	// Whether refitting has left the tree this much worse than
+	// a fresh build would be
+	bool NeedsRebuild(float costRatio = 1.5f) const;
+
+	// Every item whose box touches the frustum, sphere or ray
+	// - Items are appended, not cleared
+	void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& items) const;
+	void QuerySphere(const Sphere& sphere, std::vector<unsigned int>& items) const;
+
+	// The nearest item box the ray enters (or starts in) within maxDistance
+	bool Raycast(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& direction, float maxDistance, RayHit& hit) const;
+
+	// Getters for data
+	size_t GetItemCount() const;
+	size_t GetNodeCount() const;
+	float GetCost() const;
+	float GetBuiltCost() const;
+
+};
+
+// --------------------------------------------------------
+// The tests Bvh queries make against each item box, also
+// usable on their own (as a brute force reference, say)
+// --------------------------------------------------------
+namespace BvhTests
+{
+	bool BoxTouchesSphere(const Aabb& box, const Sphere& sphere);
+
+	// Distance along the ray to where it enters the box (0 when it
+	// starts inside), if it does before maxDistance
+	bool RayEntersBox(const Aabb& box, const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& inverseDirection,
+		float maxDistance, float& distance);
+}
@@ -44,7 +44,7 @@ void Camera::UpdateProjectionMatrix(float aspectRatio)
 //--------
 // Getters
 // -------
-Transform Camera::GetTransform() { return transform; }
+Transform& Camera::GetTransform() { return transform; }
 XMFLOAT4X4 Camera::ViewMatrix() { return viewMatrix; }
 XMFLOAT4X4 Camera::ProjectionMatrix() { return projectionMatrix; }
 
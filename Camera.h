@@ -33,7 +33,7 @@ public:
 	//--------
 	// Getters
 	// -------
-	Transform GetTransform();
+	Transform& GetTransform();
 	DirectX::XMFLOAT4X4 ViewMatrix();
 	DirectX::XMFLOAT4X4 ProjectionMatrix();
 };
@@ -0,0 +1,243 @@
+#include "Culling.h"
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULLING_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC allows AVX intrinsics anywhere; GCC and Clang need the
+// functions using them marked, so the rest of the build can
+// still run on CPUs without AVX
+#if defined(CULLING_X86) && (defined(__GNUC__) || defined(__clang__))
+#define CULLING_AVX_FUNCTION __attribute__((target("avx")))
+#else
+#define CULLING_AVX_FUNCTION
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// One sphere at a time, the same test as
+	// Frustum::IntersectsSphere()
+	// --------------------------------------------------------
+	size_t CullScalar(const Frustum& frustum, const SphereList& spheres, size_t begin, size_t end, uint8_t* visible)
+	{
+		size_t visibleCount = 0;
+		for (size_t i = begin; i < end; i++)
+		{
+			bool inside = true;
+			for (int p = 0; p < 6; p++)
+			{
+				const XMFLOAT4& plane = frustum.planes[p];
+				float distance = plane.x * spheres.x[i] + plane.y * spheres.y[i] + plane.z * spheres.z[i] + plane.w;
+				if (distance < -spheres.radius[i])
+					inside = false;
+			}
+
+			visible[i] = inside ? 1 : 0;
+			visibleCount += visible[i];
+		}
+
+		return visibleCount;
+	}
+
+#if defined(CULLING_X86)
+	// --------------------------------------------------------
+	// Four spheres against each plane at once
+	//
+	// - Multiplies and adds in the same order as the scalar
+	//   test, and keeps spheres whose distance is "not less
+	//   than" -radius, so the answers match it bit for bit
+	// - Leftovers past the last full batch go one at a time
+	// --------------------------------------------------------
+	size_t CullSse(const Frustum& frustum, const SphereList& spheres, size_t begin, size_t end, uint8_t* visible)
+	{
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			planes[p][0] = _mm_set1_ps(frustum.planes[p].x);
+			planes[p][1] = _mm_set1_ps(frustum.planes[p].y);
+			planes[p][2] = _mm_set1_ps(frustum.planes[p].z);
+			planes[p][3] = _mm_set1_ps(frustum.planes[p].w);
+		}
+
+		size_t visibleCount = 0;
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(&spheres.x[i]);
+			__m128 y = _mm_loadu_ps(&spheres.y[i]);
+			__m128 z = _mm_loadu_ps(&spheres.z[i]);
+			__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(planes[p][0], x),
+					_mm_mul_ps(planes[p][1], y)),
+					_mm_mul_ps(planes[p][2], z)),
+					planes[p][3]);
+				inside = _mm_and_ps(inside, _mm_cmpnlt_ps(distance, negativeRadius));
+			}
+
+			int mask = _mm_movemask_ps(inside);
+			for (int lane = 0; lane < 4; lane++)
+				visible[i + lane] = (mask >> lane) & 1;
+			visibleCount += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+		}
+
+		return visibleCount + CullScalar(frustum, spheres, i, end, visible);
+	}
+
+	// --------------------------------------------------------
+	// Same as CullSse(), eight spheres at a time
+	// --------------------------------------------------------
+	CULLING_AVX_FUNCTION
+	size_t CullAvx(const Frustum& frustum, const SphereList& spheres, size_t begin, size_t end, uint8_t* visible)
+	{
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			planes[p][0] = _mm256_set1_ps(frustum.planes[p].x);
+			planes[p][1] = _mm256_set1_ps(frustum.planes[p].y);
+			planes[p][2] = _mm256_set1_ps(frustum.planes[p].z);
+			planes[p][3] = _mm256_set1_ps(frustum.planes[p].w);
+		}
+
+		size_t visibleCount = 0;
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8)
+		{
+			__m256 x = _mm256_loadu_ps(&spheres.x[i]);
+			__m256 y = _mm256_loadu_ps(&spheres.y[i]);
+			__m256 z = _mm256_loadu_ps(&spheres.z[i]);
+			__m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[i]));
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(planes[p][0], x),
+					_mm256_mul_ps(planes[p][1], y)),
+					_mm256_mul_ps(planes[p][2], z)),
+					planes[p][3]);
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_NLT_UQ));
+			}
+
+			int mask = _mm256_movemask_ps(inside);
+			for (int lane = 0; lane < 8; lane++)
+			{
+				visible[i + lane] = (mask >> lane) & 1;
+				visibleCount += visible[i + lane];
+			}
+		}
+
+		// Let the rest finish on the SSE path, which doesn't pay for
+		// mixing AVX and SSE code after this
+		_mm256_zeroupper();
+		return visibleCount + CullSse(frustum, spheres, i, end, visible);
+	}
+
+	// --------------------------------------------------------
+	// Whether the CPU and OS both support AVX (the OS has to
+	// save the wider registers on a context switch)
+	// --------------------------------------------------------
+	bool HasAvx()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		bool osSaves = (info[2] & (1 << 27)) != 0;
+		bool cpuHas = (info[2] & (1 << 28)) != 0;
+		return osSaves && cpuHas && (_xgetbv(0) & 0x6) == 0x6;
+#else
+		return __builtin_cpu_supports("avx");
+#endif
+	}
+#endif
+}
+
+
+void SphereList::Resize(size_t count)
+{
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	radius.resize(count);
+}
+
+void SphereList::Set(size_t index, const Sphere& sphere)
+{
+	x[index] = sphere.center.x;
+	y[index] = sphere.center.y;
+	z[index] = sphere.center.z;
+	radius[index] = sphere.radius;
+}
+
+size_t SphereList::Size() const
+{
+	return x.size();
+}
+
+
+// --------------------------------------------------------
+// The widest kernel, worked out once
+// --------------------------------------------------------
+Culling::Kernel Culling::GetBestKernel()
+{
+	static const Kernel best =
+		IsSupported(Kernel::Avx) ? Kernel::Avx :
+		IsSupported(Kernel::Sse) ? Kernel::Sse :
+		Kernel::Scalar;
+	return best;
+}
+
+bool Culling::IsSupported(Kernel kernel)
+{
+	switch (kernel)
+	{
+#if defined(CULLING_X86)
+	case Kernel::Avx: return HasAvx();
+	case Kernel::Sse: return true;
+#else
+	case Kernel::Avx: return false;
+	case Kernel::Sse: return false;
+#endif
+	default: return true;
+	}
+}
+
+const char* Culling::GetName(Kernel kernel)
+{
+	switch (kernel)
+	{
+	case Kernel::Avx: return "AVX (8 wide)";
+	case Kernel::Sse: return "SSE (4 wide)";
+	default: return "Scalar";
+	}
+}
+
+size_t Culling::CullSpheres(const Frustum& frustum, const SphereList& spheres, size_t begin, size_t end,
+	uint8_t* visible, Kernel kernel)
+{
+	if (end > spheres.Size() || begin > end)
+		throw std::out_of_range("Sphere range is outside the list");
+
+	if (!IsSupported(kernel))
+		throw std::invalid_argument("Culling kernel isn't supported on this CPU");
+
+#if defined(CULLING_X86)
+	if (kernel == Kernel::Avx)
+		return CullAvx(frustum, spheres, begin, end, visible);
+	if (kernel == Kernel::Sse)
+		return CullSse(frustum, spheres, begin, end, visible);
+#endif
+	return CullScalar(frustum, spheres, begin, end, visible);
+}
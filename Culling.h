@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Bounds.h"
+#include "Frustum.h"
+
+// --------------------------------------------------------
+// Bounding spheres laid out one array per component, so a
+// batch of them loads straight into SIMD registers
+// --------------------------------------------------------
+struct SphereList
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+
+	void Resize(size_t count);
+	void Set(size_t index, const Sphere& sphere);
+	size_t Size() const;
+};
+
+// --------------------------------------------------------
+// Frustum tests for many spheres at once
+// - AVX, SSE or scalar, the widest picked at run time, all
+//   matching Frustum::IntersectsSphere() exactly
+// --------------------------------------------------------
+namespace Culling
+{
+	enum class Kernel
+	{
+		Scalar,
+		Sse,	// 4 wide
+		Avx		// 8 wide
+	};
+
+	Kernel GetBestKernel();
+	bool IsSupported(Kernel kernel);
+	const char* GetName(Kernel kernel);
+
+	// Writes 1 (inside or touching) or 0 (outside) to visible[i] for
+	// each sphere i in [begin, end), and returns how many were visible
+	// - Safe to run on several jobs at once over separate ranges
+	size_t CullSpheres(const Frustum& frustum, const SphereList& spheres, size_t begin, size_t end,
+		uint8_t* visible, Kernel kernel = GetBestKernel());
+}
@@ -0,0 +1,131 @@
+#include "EntityStore.h"
+#include <stdexcept>
+
+namespace
+{
+	// Sparse entries of despawned entities
+	const unsigned int NoPosition = 0xFFFFFFFF;
+}
+
+
+// --------------------------------------------------------
+// Entity lifetime
+// --------------------------------------------------------
+EntityHandle EntityStore::Spawn(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
+{
+	unsigned int index;
+	if (freeIndices.empty())
+	{
+		index = (unsigned int)densePositions.size();
+		densePositions.push_back(NoPosition);
+		generations.push_back(0);
+	}
+	else
+	{
+		index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+
+	EntityHandle entity = { index, generations[index] };
+	densePositions[index] = (unsigned int)handles.size();
+
+	handles.push_back(entity);
+	transforms.emplace_back();
+	meshes.push_back(mesh);
+	materials.push_back(material);
+	statics.push_back(0);
+	return entity;
+}
+
+// --------------------------------------------------------
+// Moves the last entity into the despawned one's place, then
+// drops the (now last) leftovers
+//
+// - Bumping the generation invalidates every handle to it
+// - Despawning an entity that's already gone does nothing
+// --------------------------------------------------------
+void EntityStore::Despawn(EntityHandle entity)
+{
+	if (!IsAlive(entity))
+		return;
+
+	size_t position = densePositions[entity.index];
+	size_t last = handles.size() - 1;
+	if (position != last)
+	{
+		handles[position] = handles[last];
+		transforms[position] = std::move(transforms[last]);
+		meshes[position] = std::move(meshes[last]);
+		materials[position] = std::move(materials[last]);
+		statics[position] = statics[last];
+		densePositions[handles[position].index] = (unsigned int)position;
+	}
+
+	handles.pop_back();
+	transforms.pop_back();
+	meshes.pop_back();
+	materials.pop_back();
+	statics.pop_back();
+
+	densePositions[entity.index] = NoPosition;
+	generations[entity.index]++;
+	freeIndices.push_back(entity.index);
+}
+
+// Despawns everything, keeping the capacity
+void EntityStore::Clear()
+{
+	for (const EntityHandle& entity : handles)
+	{
+		densePositions[entity.index] = NoPosition;
+		generations[entity.index]++;
+		freeIndices.push_back(entity.index);
+	}
+
+	handles.clear();
+	transforms.clear();
+	meshes.clear();
+	materials.clear();
+	statics.clear();
+}
+
+void EntityStore::Reserve(size_t count)
+{
+	handles.reserve(count);
+	transforms.reserve(count);
+	meshes.reserve(count);
+	materials.reserve(count);
+	statics.reserve(count);
+}
+
+bool EntityStore::IsAlive(EntityHandle entity) const
+{
+	return entity.index < generations.size() &&
+		generations[entity.index] == entity.generation &&
+		densePositions[entity.index] != NoPosition;
+}
+
+size_t EntityStore::Count() const
+{
+	return handles.size();
+}
+
+size_t EntityStore::PositionOf(EntityHandle entity) const
+{
+	if (!IsAlive(entity))
+		throw std::out_of_range("Entity handle is stale or was never spawned");
+
+	return densePositions[entity.index];
+}
+
+
+// --------------------------------------------------------
+// Components
+// --------------------------------------------------------
+Transform& EntityStore::GetTransform(EntityHandle entity) { return transforms[PositionOf(entity)]; }
+std::shared_ptr<Mesh> EntityStore::GetMesh(EntityHandle entity) { return meshes[PositionOf(entity)]; }
+std::shared_ptr<Material> EntityStore::GetMaterial(EntityHandle entity) { return materials[PositionOf(entity)]; }
+bool EntityStore::IsStatic(EntityHandle entity) { return statics[PositionOf(entity)] != 0; }
+
+void EntityStore::SetMaterial(EntityHandle entity, std::shared_ptr<Material> material) { materials[PositionOf(entity)] = material; }
+void EntityStore::SetStatic(EntityHandle entity, bool isStatic) { statics[PositionOf(entity)] = isStatic ? 1 : 0; }
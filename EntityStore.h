@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Transform.h"
+
+class Mesh;
+class Material;
+
+// --------------------------------------------------------
+// Names an entity in an EntityStore
+//
+// - The generation tells a live entity from an earlier one
+//   that had the same index, so handles to despawned
+//   entities never reach whatever replaced them
+// --------------------------------------------------------
+struct EntityHandle
+{
+	unsigned int index;
+	unsigned int generation;
+
+	bool operator==(const EntityHandle& other) const { return index == other.index && generation == other.generation; }
+	bool operator!=(const EntityHandle& other) const { return !(*this == other); }
+};
+
+// --------------------------------------------------------
+// Entities as a sparse set of contiguous component arrays
+// - Despawning moves the last entity into the hole, so hold
+//   on to handles, not positions (the "At" accessors)
+// --------------------------------------------------------
+class EntityStore
+{
+
+private:
+
+	// Sparse: by handle index
+	std::vector<unsigned int> densePositions;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> freeIndices;
+
+	// Dense: by position, all the same length
+	std::vector<EntityHandle> handles;
+	std::vector<Transform> transforms;
+	std::vector<std::shared_ptr<Mesh>> meshes;
+	std::vector<std::shared_ptr<Material>> materials;
+	std::vector<uint8_t> statics;
+
+public:
+
+	// Entities
+	EntityHandle Spawn(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
+	void Despawn(EntityHandle entity);
+	void Clear();
+	void Reserve(size_t count);
+	bool IsAlive(EntityHandle entity) const;
+	size_t Count() const;
+
+	// Where a live entity currently sits in the dense arrays
+	size_t PositionOf(EntityHandle entity) const;
+
+	// Components, by handle
+	Transform& GetTransform(EntityHandle entity);
+	std::shared_ptr<Mesh> GetMesh(EntityHandle entity);
+	std::shared_ptr<Material> GetMaterial(EntityHandle entity);
+	bool IsStatic(EntityHandle entity);
+	void SetMaterial(EntityHandle entity, std::shared_ptr<Material> material);
+	void SetStatic(EntityHandle entity, bool isStatic);
+
+	// Components, by dense position, for loops over every entity
+	EntityHandle HandleAt(size_t position) const { return handles[position]; }
+	Transform& TransformAt(size_t position) { return transforms[position]; }
+	const std::shared_ptr<Mesh>& MeshAt(size_t position) const { return meshes[position]; }
+	const std::shared_ptr<Material>& MaterialAt(size_t position) const { return materials[position]; }
+	bool IsStaticAt(size_t position) const { return statics[position] != 0; }
+
+};
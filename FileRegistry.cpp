@@ -0,0 +1,106 @@
+#include "FileRegistry.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include <chrono>
+#include <filesystem>
+#include <tuple>
+
+bool FileRegistry::Key::operator<(const Key& other) const
+{
+	return std::tie(path, contentHash, options) < std::tie(other.path, other.contentHash, other.options);
+}
+
+// --------------------------------------------------------
+// Finds or loads the result for a file
+// - Later requests for a key wait on the first one's load,
+//   and a failed load is removed so the next request retries
+// --------------------------------------------------------
+std::shared_ptr<void> FileRegistry::Load(const std::string& filename, uint32_t options, const LoadFunction& load)
+{
+	// Throws if the file doesn't exist
+	std::string path = std::filesystem::canonical(filename).string();
+
+	uint64_t contentHash;
+	{
+		MappedFile source(path.c_str());
+		contentHash = MeshCache::HashContents(source.GetData(), source.GetSize());
+	}
+
+	Key key = { path, contentHash, options };
+	std::promise<std::shared_ptr<void>> promise;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		auto found = slots.find(key);
+		if (found != slots.end())
+		{
+			found->second.requestCount++;
+			hits++;
+
+			// Wait (if it's still loading) without holding up other requests
+			std::shared_future<std::shared_ptr<void>> resource = found->second.resource;
+			lock.unlock();
+			return resource.get();
+		}
+
+		// Older versions of the file (with the same options) are stale now
+		for (auto it = slots.begin(); it != slots.end();)
+		{
+			bool stale = it->first.path == path && it->first.options == options;
+			it = stale ? slots.erase(it) : std::next(it);
+		}
+
+		slots[key] = { promise.get_future().share(), 1 };
+		misses++;
+	}
+
+	try
+	{
+		std::shared_ptr<void> resource = load(path);
+		promise.set_value(resource);
+		return resource;
+	}
+	catch (...)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			slots.erase(key);
+		}
+
+		promise.set_exception(std::current_exception());
+		throw;
+	}
+}
+
+FileRegistry::Stats FileRegistry::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return { hits, misses };
+}
+
+// --------------------------------------------------------
+// Every finished result in the registry, sorted by path
+// - Results still loading on another thread are left out
+// --------------------------------------------------------
+std::vector<FileRegistry::Entry> FileRegistry::GetEntries()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<Entry> entries;
+	for (const auto& [key, slot] : slots)
+	{
+		if (slot.resource.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			continue;
+
+		entries.push_back({ key.path, key.contentHash, key.options, slot.resource.get(), slot.requestCount });
+	}
+
+	return entries;
+}
+
+void FileRegistry::Clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	slots.clear();
+	hits = 0;
+	misses = 0;
+}
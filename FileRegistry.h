@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Shared, deduplicated loading of anything made from a file,
+// keyed by canonical path, file contents and option bits
+// - Safe to call from several threads
+// - Holds on to every result until Clear()
+// - Knows nothing about what it loads (see MeshRegistry for
+//   meshes), so it runs without a device
+// --------------------------------------------------------
+class FileRegistry
+{
+public:
+
+	// One loaded result and how often it's been asked for
+	struct Entry
+	{
+		std::string path;			// Canonical path of the source file
+		uint64_t contentHash;		// MeshCache::HashContents() of the source file
+		uint32_t options;
+		std::shared_ptr<void> resource;
+		unsigned int requestCount;
+	};
+
+	// Totals across every request since the last Clear()
+	struct Stats
+	{
+		unsigned int hits;			// Requests that shared an already loaded (or loading) result
+		unsigned int misses;		// Requests that loaded a result
+	};
+
+	// Makes a result from the canonical path of its file
+	using LoadFunction = std::function<std::shared_ptr<void>(const std::string& path)>;
+
+	// Returns the result for a file and options, calling load() if
+	// this is the first request for them
+	// - Throws if the file can't be opened, or whatever load() throws
+	std::shared_ptr<void> Load(const std::string& filename, uint32_t options, const LoadFunction& load);
+
+	template<typename Resource, typename Function>
+	std::shared_ptr<Resource> Load(const std::string& filename, uint32_t options, Function load)
+	{
+		return std::static_pointer_cast<Resource>(Load(filename, options,
+			LoadFunction([&](const std::string& path) { return std::shared_ptr<void>(load(path)); })));
+	}
+
+	// Reporting
+	Stats GetStats();
+	std::vector<Entry> GetEntries();
+
+	// Forgets every result and resets the stats (results still in
+	// use elsewhere stay alive until their last owner lets go)
+	void Clear();
+
+private:
+
+	// Everything that makes two requests share a result
+	struct Key
+	{
+		std::string path;
+		uint64_t contentHash;
+		uint32_t options;
+
+		bool operator<(const Key& other) const;
+	};
+
+	// A result that's loaded, or still being loaded by some thread
+	struct Slot
+	{
+		std::shared_future<std::shared_ptr<void>> resource;
+		unsigned int requestCount;
+	};
+
+	// Guarded by the mutex
+	// - Loading itself happens outside the lock, so different
+	//   files load in parallel
+	std::mutex mutex;
+	std::map<Key, Slot> slots;
+	unsigned int hits = 0;
+	unsigned int misses = 0;
+};
@@ -0,0 +1,93 @@
+#include "Frustum.h"
+#include <cmath>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Pulls the planes straight out of a projection matrix
+// - See Gribb & Hartmann, "Fast Extraction of Viewing Frustum
+//   Planes from the World-View-Projection Matrix"
+//
+// - Uses D3D's 0 to 1 depth range for the near plane
+// --------------------------------------------------------
+Frustum Frustum::FromMatrix(const XMFLOAT4X4& matrix)
+{
+	// Columns of the (row vector) matrix
+	XMVECTOR column1 = XMVectorSet(matrix._11, matrix._21, matrix._31, matrix._41);
+	XMVECTOR column2 = XMVectorSet(matrix._12, matrix._22, matrix._32, matrix._42);
+	XMVECTOR column3 = XMVectorSet(matrix._13, matrix._23, matrix._33, matrix._43);
+	XMVECTOR column4 = XMVectorSet(matrix._14, matrix._24, matrix._34, matrix._44);
+
+	XMVECTOR planes[6] =
+	{
+		column4 + column1,	// Left
+		column4 - column1,	// Right
+		column4 + column2,	// Bottom
+		column4 - column2,	// Top
+		column3,			// Near
+		column4 - column3	// Far
+	};
+
+	Frustum frustum;
+	for (int i = 0; i < 6; i++)
+		XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+
+	return frustum;
+}
+
+// --------------------------------------------------------
+// Whether a sphere is at least partly inside all six planes
+//
+// - Conservative: spheres just outside a corner can pass
+// --------------------------------------------------------
+bool Frustum::IntersectsSphere(const XMFLOAT3& center, float radius) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& plane = planes[i];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		if (distance < -radius)
+			return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Whether a box is at least partly inside all six planes
+//
+// - Each plane is tested against the box's corner furthest
+//   along its normal, which is the center pushed out by the
+//   extents along the normal's absolute value
+// - Conservative like IntersectsSphere()
+// --------------------------------------------------------
+bool Frustum::IntersectsBox(const XMFLOAT3& center, const XMFLOAT3& extents) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& plane = planes[i];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float reach = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+		if (distance < -reach)
+			return false;
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Whether a box is entirely inside, so everything in it is too
+// --------------------------------------------------------
+bool Frustum::ContainsBox(const XMFLOAT3& center, const XMFLOAT3& extents) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const XMFLOAT4& plane = planes[i];
+		float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+		float reach = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+		if (distance < reach)
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// --------------------------------------------------------
+// The six planes of a view frustum, for culling on the CPU
+// - Planes point inward and are normalized, in the space the
+//   matrix they're built from transforms from
+// --------------------------------------------------------
+struct Frustum
+{
+	DirectX::XMFLOAT4 planes[6]; // Left, right, bottom, top, near, far
+
+	static Frustum FromMatrix(const DirectX::XMFLOAT4X4& matrix);
+
+	bool IntersectsSphere(const DirectX::XMFLOAT3& center, float radius) const;
+
+	// Boxes as a center and half extents, like Aabb
+	bool IntersectsBox(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents) const;
+	bool ContainsBox(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents) const;
+};
@@ -12,6 +12,13 @@
 #include "ImGui/imgui_impl_win32.h"
 
 #include "Mesh.h"
+#include "MeshRegistry.h"
+#include "GeometryPool.h"
+#include "StaticBatching.h"
+#include "Culling.h"
+#include "Instancing.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
 #include <memory>
 #include <vector>
 #include "BufferStructs.h"
@@ -22,6 +29,13 @@
 // Needed for a helper function to load pre-compiled shader files
 #pragma comment(lib, "d3dcompiler.lib")
 #include <d3dcompiler.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <stdexcept>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -35,6 +49,7 @@ void Game::Initialize()
 	// Helper methods for loading shaders, creating some basic
 	// geometry to draw and some simple camera matrices.
 	//  - You'll be expanding and/or replacing these later
+	JobSystem::Initialize();
 	CreateGeometry();
 
 
@@ -111,6 +126,13 @@ Game::~Game()
 	ImGui_ImplDX11_Shutdown();
 	ImGui_ImplWin32_Shutdown();
 	ImGui::DestroyContext();
+
+	// Let go of the registry's meshes and the geometry pools while
+	// the device is still alive
+	MeshRegistry::Clear();
+	GeometryPool::ReleaseAll();
+
+	JobSystem::Shutdown();
 }
 
 
@@ -340,6 +362,28 @@ void Game::CreateGeometry()
 	shadowVS = std::make_shared<SimpleVertexShader>(
 		Graphics::Device, Graphics::Context, FixPath(L"ShadowMapVertexShader.cso").c_str());
 
+	// Packed meshes need their own vertex shaders, with input layouts
+	// describing the packed formats
+	std::shared_ptr<SimpleVertexShader> packedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"VertexShaderPacked.cso").c_str(),
+		CreatePackedInputLayout(FixPath(L"VertexShaderPacked.cso")), false);
+	shadowPackedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"ShadowMapVertexShaderPacked.cso").c_str(),
+		CreatePackedInputLayout(FixPath(L"ShadowMapVertexShaderPacked.cso")), false);
+
+	// Instanced versions of all of the above, reading world matrices
+	// from the object cache at the index in the instance buffer (input slot 1)
+	std::shared_ptr<SimpleVertexShader> instancedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"VertexShaderInstanced.cso").c_str());
+	std::shared_ptr<SimpleVertexShader> packedInstancedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"VertexShaderPackedInstanced.cso").c_str(),
+		CreatePackedInputLayout(FixPath(L"VertexShaderPackedInstanced.cso"), true), true);
+	shadowInstancedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"ShadowMapVertexShaderInstanced.cso").c_str());
+	shadowPackedInstancedVS = std::make_shared<SimpleVertexShader>(
+		Graphics::Device, Graphics::Context, FixPath(L"ShadowMapVertexShaderPackedInstanced.cso").c_str(),
+		CreatePackedInputLayout(FixPath(L"ShadowMapVertexShaderPackedInstanced.cso"), true), true);
+
 	// Creating materials with different tints
 	std::shared_ptr<Material> basicMaterial = std::make_shared<Material>(
 		XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vs, ps, XMFLOAT2(1, 1), XMFLOAT2(0, 0), 1.0f, 0.0f);
@@ -417,20 +461,32 @@ void Game::CreateGeometry()
 	materials.push_back(roughMaterial);
 	materials.push_back(woodMaterial);
 
+	// All of these can draw packed meshes too, and draw instanced
+	for (auto& material : materials)
+	{
+		material->SetPackedVertexShader(packedVS);
+		material->SetInstancedVertexShaders(instancedVS, packedInstancedVS);
+	}
+
+	// Props for the instancing stress test (see the Instancing UI)
+	propMaterial = bronzeMaterial;
+
 
 
 
 	//-----------------------
 	// Initializing 3D meshes
 	//-----------------------
-	
-	std::shared_ptr<Mesh> cube = std::make_shared<Mesh>(FixPath("../../Assets/Models/cube.obj").c_str());
-	std::shared_ptr<Mesh> cylinder = std::make_shared<Mesh>(FixPath("../../Assets/Models/cylinder.obj").c_str());
-	std::shared_ptr<Mesh> helix = std::make_shared<Mesh>(FixPath("../../Assets/Models/helix.obj").c_str());
-	std::shared_ptr<Mesh> sphere = std::make_shared<Mesh>(FixPath("../../Assets/Models/sphere.obj").c_str());
-	std::shared_ptr<Mesh> torus = std::make_shared<Mesh>(FixPath("../../Assets/Models/torus.obj").c_str());
-	std::shared_ptr<Mesh> quad = std::make_shared<Mesh>(FixPath("../../Assets/Models/quad.obj").c_str());
-	std::shared_ptr<Mesh> quadDoubleSided = std::make_shared<Mesh>(FixPath("../../Assets/Models/quad_double_sided.obj").c_str());
+
+	// Meshes come from the registry, so a file used in several
+	// places is only loaded and uploaded once
+	std::shared_ptr<Mesh> cube = MeshRegistry::Load(FixPath("../../Assets/Models/cube.obj"));
+	std::shared_ptr<Mesh> cylinder = MeshRegistry::Load(FixPath("../../Assets/Models/cylinder.obj"));
+	std::shared_ptr<Mesh> helix = MeshRegistry::Load(FixPath("../../Assets/Models/helix.obj"), true, VertexLayout::Packed);
+	std::shared_ptr<Mesh> sphere = MeshRegistry::Load(FixPath("../../Assets/Models/sphere.obj"), false, VertexLayout::Packed);
+	std::shared_ptr<Mesh> torus = MeshRegistry::Load(FixPath("../../Assets/Models/torus.obj"), true, VertexLayout::Packed);
+	std::shared_ptr<Mesh> quad = MeshRegistry::Load(FixPath("../../Assets/Models/quad.obj"));
+	std::shared_ptr<Mesh> quadDoubleSided = MeshRegistry::Load(FixPath("../../Assets/Models/quad_double_sided.obj"));
 
 
 	//// Add meshes to entitty list with normal material
@@ -486,15 +542,26 @@ void Game::CreateGeometry()
 	//------------------------------
 	// Meshs for shadow mapping test
 	//------------------------------
-	entities.push_back(Entity(cube, woodMaterial));
-	entities.push_back(Entity(torus, floorMaterial));
-	entities.push_back(Entity(sphere, paintMaterial));
-	entities.push_back(Entity(helix, roughMaterial));
+	EntityHandle floor = entities.Spawn(cube, woodMaterial);
+	entities.Spawn(torus, floorMaterial);
+	entities.Spawn(sphere, paintMaterial);
+	entities.Spawn(helix, roughMaterial);
+	entities.Spawn(sphere, bronzeMaterial);
+
+	entities.TransformAt(0).SetScale(XMFLOAT3(20.0f, 0.01f, 20.0f));
+	entities.TransformAt(1).SetPosition(XMFLOAT3(0.0f, 2.0f, 0.0f));
+	entities.TransformAt(2).SetPosition(XMFLOAT3(-3.0f, 2.0f, 0.0f));
+	entities.TransformAt(3).SetPosition(XMFLOAT3(3.0f, 2.0f, 0.0f));
+
+	// A small sphere attached to the spinning torus, which carries it around
+	entities.TransformAt(4).SetParent(&entities.TransformAt(1));
+	entities.TransformAt(4).SetPosition(XMFLOAT3(0.0f, 0.0f, 1.5f));
+	entities.TransformAt(4).SetScale(XMFLOAT3(0.25f, 0.25f, 0.25f));
 
-	entities[0].GetTransform()->SetScale(XMFLOAT3(20.0f, 0.01f, 20.0f));
-	entities[1].GetTransform()->SetPosition(XMFLOAT3(0.0f, 2.0f, 0.0f));
-	entities[2].GetTransform()->SetPosition(XMFLOAT3(-3.0f, 2.0f, 0.0f));
-	entities[3].GetTransform()->SetPosition(XMFLOAT3(3.0f, 2.0f, 0.0f));
+	// The floor never moves
+	entities.SetStatic(floor, true);
+
+	propMesh = sphere;
 
 
 
@@ -699,6 +766,41 @@ void Game::CreateGeometry()
 		FixPath(L"../../Assets/Textures/back.png").c_str());
 }
 
+// --------------------------------------------------------
+// Creates an input layout matching PackedVertex for the given
+// compiled vertex shader
+//
+// - Reflection only ever sees floats in the shader's input, so
+//   it can't work out the UNORM/SNORM/FLOAT16 formats itself
+// - Instanced shaders also read an object index from slot 1
+// --------------------------------------------------------
+Microsoft::WRL::ComPtr<ID3D11InputLayout> Game::CreatePackedInputLayout(const std::wstring& shaderFile, bool instanced)
+{
+	Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+	if (FAILED(D3DReadFileToBlob(shaderFile.c_str(), shaderBlob.GetAddressOf())))
+		throw std::runtime_error("Couldn't read packed vertex shader");
+
+	std::vector<D3D11_INPUT_ELEMENT_DESC> inputElements =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, offsetof(PackedVertex, position), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, offsetof(PackedVertex, uv), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, normal), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, offsetof(PackedVertex, tangent), D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+
+	if (instanced)
+		inputElements.push_back({ "OBJECT_INDEX_PER_INSTANCE", 0, DXGI_FORMAT_R32_UINT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 });
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	Graphics::Device->CreateInputLayout(
+		inputElements.data(),
+		(UINT)inputElements.size(),
+		shaderBlob->GetBufferPointer(),
+		shaderBlob->GetBufferSize(),
+		inputLayout.GetAddressOf());
+	return inputLayout;
+}
+
 
 // --------------------------------------------------------
 // Handle resizing to match the new window size
@@ -791,13 +893,13 @@ void Game::Update(float deltaTime, float totalTime)
 
 
 	// Move meshes for shadow mapping test
-	entities[1].GetTransform()->SetRotation(XMFLOAT3(totalTime, totalTime, 0.0f));
+	entities.TransformAt(1).SetRotation(XMFLOAT3(totalTime, totalTime, 0.0f));
 
 	float move = (float)(sin(totalTime) * 10.0f);
 
-	entities[2].GetTransform()->SetPosition(XMFLOAT3(-3.0f, 2.0f, move));
+	entities.TransformAt(2).SetPosition(XMFLOAT3(-3.0f, 2.0f, move));
 
-	entities[3].GetTransform()->SetPosition(XMFLOAT3(3.0f, move / 5.0f + 3.0f, 0.0f));
+	entities.TransformAt(3).SetPosition(XMFLOAT3(3.0f, move / 5.0f + 3.0f, 0.0f));
 
 
 
@@ -809,6 +911,186 @@ void Game::Update(float deltaTime, float totalTime)
 }
 
 
+// --------------------------------------------------------
+// Fills a square grid on the floor with propCount copies of
+// the same mesh and material, which all draw instanced
+// --------------------------------------------------------
+void Game::CreateProps()
+{
+	props.Reserve(propCount);
+	while (props.Count() < (size_t)propCount)
+		props.Spawn(propMesh, propMaterial);
+	while (props.Count() > (size_t)propCount)
+		props.Despawn(props.HandleAt(props.Count() - 1));
+
+	const float spacing = 0.5f;
+	int gridSize = (int)ceilf(sqrtf((float)propCount));
+	float start = -(gridSize - 1) * spacing * 0.5f;
+	std::vector<Aabb> bounds(propCount);
+	for (int i = 0; i < propCount; i++)
+	{
+		Transform& transform = props.TransformAt(i);
+		transform.SetScale(0.2f, 0.2f, 0.2f);
+		transform.SetPosition(start + (i % gridSize) * spacing, 0.2f, start + (i / gridSize) * spacing);
+		bounds[i] = propMesh->GetWorldBounds(transform.GetWorldMatrix());
+	}
+
+	// Props stay put, so their hierarchy is worth a full build
+	propBvh.Build(bounds);
+}
+
+// --------------------------------------------------------
+// Refits the scene entities' hierarchy to their current
+// world bounds, or rebuilds it when the entity count has
+// changed or refits have made it too much worse than new
+// - Does neither when no entity's transform changed
+// --------------------------------------------------------
+void Game::UpdateEntityBvh()
+{
+	size_t count = entities.Count();
+	entityBounds.resize(count);
+	entityBoundsSlots.resize(count, TransformSystem::NoSlot);
+	entityBoundsVersions.resize(count, 0);
+
+	// The object cache only recomputes bounds for transforms with a
+	// new version, and each position notes which transform and
+	// version its box came from
+	std::vector<uint8_t> changed(count, 0);
+	objectCache.Reserve(TransformSystem::GetStats().capacity);
+	JobSystem::ParallelFor(count, 64, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			unsigned int slot = entities.TransformAt(i).GetSlot();
+			unsigned int version = TransformSystem::GetVersion(slot);
+			if (slot == entityBoundsSlots[i] && version == entityBoundsVersions[i])
+				continue;
+
+			unsigned int object = objectCache.Prepare(slot, entities.MeshAt(i).get());
+			entityBounds[i] = objectCache.GetWorldBounds(object);
+			entityBoundsSlots[i] = slot;
+			entityBoundsVersions[i] = version;
+			changed[i] = 1;
+		}
+	});
+
+	if (entityBvh.GetItemCount() == count)
+	{
+		if (std::find(changed.begin(), changed.end(), 1) == changed.end())
+			return;
+
+		entityBvh.Refit(entityBounds);
+		entityBvhRefits++;
+		if (!entityBvh.NeedsRebuild())
+			return;
+	}
+
+	entityBvh.Build(entityBounds);
+	entityBvhRebuilds++;
+}
+
+// --------------------------------------------------------
+// Sets the per-frame lighting, shadow and fog data on a
+// material's shaders, ahead of preparing the material itself
+// --------------------------------------------------------
+void Game::SetLightingData(std::shared_ptr<SimpleVertexShader> vs, Material* material)
+{
+	// Setting shadowmap vertex shader data
+	vs->SetMatrix4x4("lightView", lightViewMatrix);
+	vs->SetMatrix4x4("lightProjection", lightProjectionMatrix);
+
+	// Pass in values to the shader for lighting
+	std::shared_ptr<SimplePixelShader> ps = material->PixelShader();
+	ps->SetFloat3("ambient", ambientColor);
+	ps->SetInt("lightsCount", (int)lights.size());
+
+	ps->SetShaderResourceView("ShadowMap", shadowSRV);
+	ps->SetSamplerState("ShadowSampler", shadowSampler);
+
+	// Add the lights to the pixel shader
+	ps->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
+
+	// Set up fog parameters
+	ps->SetFloat("fogStartDistance", fogStartDistance);
+	ps->SetFloat("fogEndDistance", fogEndDistance);
+}
+
+// --------------------------------------------------------
+// Rebuilds the static batches when any static entity has
+// changed since they were last built
+// - Two or more static entities sharing a material merge into
+//   one world space mesh; a lone one keeps drawing on its own
+// --------------------------------------------------------
+void Game::UpdateStaticBatches()
+{
+	std::vector<StaticBatchMember> members;
+	for (int i = 0; i < (int)entities.Count(); i++)
+	{
+		if (entities.IsStaticAt(i))
+		{
+			members.push_back({ i,
+				entities.MeshAt(i).get(),
+				entities.MaterialAt(i).get(),
+				entities.TransformAt(i).GetWorldMatrix() });
+		}
+	}
+
+	bool unchanged =
+		entityBatched.size() == entities.Count() &&
+		members.size() == staticBatchMembers.size() &&
+		std::equal(members.begin(), members.end(), staticBatchMembers.begin(),
+			[](const StaticBatchMember& a, const StaticBatchMember& b)
+			{
+				return
+					a.entityIndex == b.entityIndex &&
+					a.mesh == b.mesh &&
+					a.material == b.material &&
+					memcmp(&a.world, &b.world, sizeof(a.world)) == 0;
+			});
+	if (unchanged)
+		return;
+
+	staticBatchMembers = members;
+	staticBatches.Clear();
+	entityBatched.assign(entities.Count(), false);
+	staticBatchRebuilds++;
+
+	// Group by material, in the order the materials first appear
+	std::vector<std::vector<StaticBatchMember>> groups;
+	for (const StaticBatchMember& member : members)
+	{
+		auto group = std::find_if(groups.begin(), groups.end(),
+			[&](const std::vector<StaticBatchMember>& g) { return g[0].material == member.material; });
+
+		if (group == groups.end())
+			groups.push_back({ member });
+		else
+			group->push_back(member);
+	}
+
+	for (const std::vector<StaticBatchMember>& group : groups)
+	{
+		if (group.size() < 2)
+			continue;
+
+		std::vector<StaticBatching::Instance> instances;
+		for (const StaticBatchMember& member : group)
+		{
+			const std::vector<Vertex>& vertices = member.mesh->GetSourceVertices();
+			const std::vector<unsigned int>& indices = member.mesh->GetSourceIndices();
+			instances.push_back({ vertices.data(), vertices.size(), indices.data(), indices.size(), member.world });
+			entityBatched[member.entityIndex] = true;
+		}
+
+		MeshData batch = StaticBatching::Merge(instances);
+		std::shared_ptr<Mesh> batchMesh = std::make_shared<Mesh>(
+			batch.vertices.data(), (int)batch.vertices.size(),
+			batch.indices.data(), (int)batch.indices.size(), false);
+		staticBatches.Spawn(batchMesh, entities.MaterialAt(group[0].entityIndex));
+	}
+}
+
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
@@ -823,8 +1105,26 @@ void Game::Draw(float deltaTime, float totalTime)
 		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	bgColor);
 		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 
+		// Last frame's UI may have left other buffers bound
+		GeometryPool::ForgetBindings();
+
+		// Recompute every transform that changed this frame in one pass
+		TransformSystem::UpdateDirty();
 	}
 
+	// Everything to draw this frame, with static batches standing
+	// in for the entities they cover
+	UpdateStaticBatches();
+	UpdateEntityBvh();
+	drawList.Clear();
+	for (size_t i = 0; i < entities.Count(); i++)
+	{
+		if (!entityBatched[i])
+			drawList.Add(entities.TransformAt(i).GetSlot(), entities.MeshAt(i).get(), entities.MaterialAt(i).get());
+	}
+	drawList.Add(staticBatches);
+	drawList.Add(props);
+
 	// Clear shadow map
 	Graphics::Context->ClearDepthStencilView(shadowDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
 
@@ -846,20 +1146,71 @@ void Game::Draw(float deltaTime, float totalTime)
 	viewport.MaxDepth = 1.0f;
 	Graphics::Context->RSSetViewports(1, &viewport);
 
-	shadowVS->SetShader();
 	shadowVS->SetMatrix4x4("view", lightViewMatrix);
 	shadowVS->SetMatrix4x4("projection", lightProjectionMatrix);
+	shadowPackedVS->SetMatrix4x4("view", lightViewMatrix);
+	shadowPackedVS->SetMatrix4x4("projection", lightProjectionMatrix);
+
 
 
+	// Entities sharing a mesh draw together with one instanced call
+	std::vector<InstanceGroup> groups;
+	std::vector<unsigned int> instances;
+	std::vector<unsigned int> singles;
+	Instancing::GroupForShadows(drawList, objectCache, groups, instances, singles);
+	instanceBuffer.Upload(instances);
+	shadowDrawCalls = (int)(singles.size() + groups.size());
+
+	// Every entity is in the cache now, so this is the frame's only
+	// upload of object data
+	objectCache.Upload();
+	objectUploadBytes = objectCache.GetLastUploadBytes();
+	instanceUploadBytes = instances.size() * sizeof(unsigned int);
+	singleUploadBytes = singles.size() * sizeof(unsigned int);
+	uncachedUploadBytes = instances.size() * sizeof(InstanceData) + singles.size() * sizeof(XMFLOAT4X4);
 
 	// Loop and draw all entities
-	for (int i = 0; i < entities.size(); i++)
+	for (int i = 0; i < singles.size(); i++)
 	{
-		shadowVS->SetMatrix4x4("world", entities[i].GetTransform()->GetWorldMatrix());
-		shadowVS->CopyAllBufferData();
+		// Packed meshes need the packed shader and their dequantization values
+		Mesh* mesh = drawList.meshes[singles[i]];
+		std::shared_ptr<SimpleVertexShader> vs = shadowVS;
+		if (mesh->GetVertexLayout() == VertexLayout::Packed)
+		{
+			vs = shadowPackedVS;
+			PositionQuantization quantization = mesh->GetPositionQuantization();
+			vs->SetFloat3("positionOffset", quantization.offset);
+			vs->SetFloat3("positionScale", quantization.scale);
+		}
+
+		unsigned int objectIndex = drawList.transformSlots[singles[i]];
+		vs->SetShader();
+		vs->SetShaderResourceView("Objects", objectCache.GetShaderResourceView());
+		vs->SetData("objectIndex", &objectIndex, sizeof(unsigned int));
+		vs->CopyAllBufferData();
 
 		// Draw the mesh directly to avoid the entity's material
-		entities[i].GetMesh()->Draw();
+		mesh->Draw();
+	}
+
+	for (const InstanceGroup& group : groups)
+	{
+		std::shared_ptr<SimpleVertexShader> vs = shadowInstancedVS;
+		if (group.mesh->GetVertexLayout() == VertexLayout::Packed)
+		{
+			vs = shadowPackedInstancedVS;
+			PositionQuantization quantization = group.mesh->GetPositionQuantization();
+			vs->SetFloat3("positionOffset", quantization.offset);
+			vs->SetFloat3("positionScale", quantization.scale);
+		}
+
+		vs->SetShader();
+		vs->SetShaderResourceView("Objects", objectCache.GetShaderResourceView());
+		vs->SetMatrix4x4("view", lightViewMatrix);
+		vs->SetMatrix4x4("projection", lightProjectionMatrix);
+		vs->CopyAllBufferData();
+
+		group.mesh->DrawInstanced(0, group.instanceCount, group.firstInstance);
 	}
 
 
@@ -878,30 +1229,49 @@ void Game::Draw(float deltaTime, float totalTime)
 	Graphics::Context->ClearRenderTargetView(ppRTV.Get(), bgColor);
 	Graphics::Context->OMSetRenderTargets(1, ppRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
 
+	// Group again for the camera, which also culls and picks
+	// a level of detail for each instance
+	Instancing::GroupForCamera(drawList, currentCamera, objectCache, groups, instances, singles);
+	instanceBuffer.Upload(instances);
+	mainDrawCalls = (int)(singles.size() + groups.size());
+	mainInstanceCount = (int)instances.size();
+	mainVisibleCount = (int)(instances.size() + singles.size());
+	mainCulledCount = (int)drawList.Size() - mainVisibleCount;
+	mainInstanceGroupCount = (int)groups.size();
+
+	// Singles read their matrices from the object buffer too, and
+	// only send its index with each draw
+	instanceUploadBytes += instances.size() * sizeof(unsigned int);
+	singleUploadBytes += singles.size() * sizeof(unsigned int);
+	uncachedUploadBytes += instances.size() * sizeof(InstanceData) + singles.size() * sizeof(InstanceData);
+
 	// Draw Geometry
-	for (int i = 0; i < entities.size(); i++)
+	for (int i = 0; i < singles.size(); i++)
 	{
-		// Setting shadowmap vertex shader data
-		entities[i].GetMaterial()->VertexShader()->SetMatrix4x4("lightView", lightViewMatrix);
-		entities[i].GetMaterial()->VertexShader()->SetMatrix4x4("lightProjection", lightProjectionMatrix);
-
-
-		// Pass in values to the shader for lighting
-		entities[i].GetMaterial()->PixelShader()->SetFloat3("ambient", ambientColor);
-		entities[i].GetMaterial()->PixelShader()->SetInt("lightsCount", (int)lights.size());
-
-		entities[i].GetMaterial()->PixelShader()->SetShaderResourceView("ShadowMap", shadowSRV);
-		entities[i].GetMaterial()->PixelShader()->SetSamplerState("ShadowSampler", shadowSampler);
-
-
-		// Add the lights to the pixel shader
-		entities[i].GetMaterial()->PixelShader()->SetData("lights", &lights[0], sizeof(Light) * (int)lights.size());
+		Mesh* mesh = drawList.meshes[singles[i]];
+		Material* material = drawList.materials[singles[i]];
+		unsigned int objectIndex = drawList.transformSlots[singles[i]];
+		const InstanceData& object = objectCache.GetObjectData(objectIndex);
+		SetLightingData(material->VertexShaderFor(mesh->GetVertexLayout()), material);
+		material->PrepareMaterial(currentCamera, objectIndex, mesh, totalTime);
+		material->VertexShaderFor(mesh->GetVertexLayout())->SetShaderResourceView("Objects", objectCache.GetShaderResourceView());
+
+		// Distant meshes draw a simpler level of detail, and
+		// full detail ones draw whatever parts the camera might see
+		int lod = mesh->SelectLod(object.world, currentCamera);
+		if (lod == 0)
+			mesh->DrawCulled(object.world, currentCamera);
+		else
+			mesh->DrawLod(lod);
+	}
 
-		// Set up fog parameters
-		entities[i].GetMaterial()->PixelShader()->SetFloat("fogStartDistance", fogStartDistance);
-		entities[i].GetMaterial()->PixelShader()->SetFloat("fogEndDistance", fogEndDistance);
+	for (const InstanceGroup& group : groups)
+	{
+		SetLightingData(group.material->VertexShaderFor(group.mesh->GetVertexLayout(), true), group.material);
 
-		entities[i].Draw(currentCamera, totalTime);
+		group.material->PrepareMaterialInstanced(currentCamera, group.mesh, totalTime);
+		group.material->VertexShaderFor(group.mesh->GetVertexLayout(), true)->SetShaderResourceView("Objects", objectCache.GetShaderResourceView());
+		group.mesh->DrawInstanced(group.lod, group.instanceCount, group.firstInstance);
 	}
 
 	skybox->Draw(currentCamera);
@@ -1129,7 +1499,7 @@ void Game::CreateUI()
 	if (ImGui::CollapsingHeader("Mesh Information"))
 	{
 		ImGui::Indent(20.0f); // Indent to make the data more organized
-		for (int i = 0; i < entities.size(); i++)
+		for (int i = 0; i < (int)entities.Count(); i++)
 		{
 			// Creating a mesh label because I don't have names for my meshes
 			std::string meshLabel = "Mesh " + std::to_string(i + 1);
@@ -1137,9 +1507,66 @@ void Game::CreateUI()
 			// Shows the basic mesh info for each mesh displayed on screen
 			if (ImGui::CollapsingHeader(meshLabel.c_str()))
 			{
-				ImGui::Text("Triangles - %d", entities[i].GetMesh()->GetIndexCount() / 3);
-				ImGui::Text("Vertices - %d", entities[i].GetMesh()->GetVertexCount());
-				ImGui::Text("Indices - %d", entities[i].GetMesh()->GetIndexCount());
+				std::shared_ptr<Mesh> mesh = entities.MeshAt(i);
+				XMFLOAT4X4 world = entities.TransformAt(i).GetWorldMatrix();
+				ImGui::Text("Triangles - %d", mesh->GetIndexCount() / 3);
+				ImGui::Text("Vertices - %d", mesh->GetVertexCount());
+				ImGui::Text("Indices - %d", mesh->GetIndexCount());
+
+				// Vertex cache efficiency before and after import optimization
+				VertexCacheStats before = mesh->GetUnoptimizedVertexCacheStats();
+				VertexCacheStats after = mesh->GetVertexCacheStats();
+				ImGui::Text("ACMR - %.3f -> %.3f", before.acmr, after.acmr);
+				ImGui::Text("ATVR - %.3f -> %.3f", before.atvr, after.atvr);
+
+				// Vertex format and what packing cost in accuracy
+				bool packed = mesh->GetVertexLayout() == VertexLayout::Packed;
+				ImGui::Text("Vertex Layout - %s (%d bytes)", packed ? "Packed" : "Standard", mesh->GetVertexStride());
+				ImGui::Text("Vertex Buffer - %.1f KB (%.1f KB unpacked)",
+					mesh->GetVertexBufferSize() / 1024.0f,
+					sizeof(Vertex) * mesh->GetVertexCount() / 1024.0f);
+				ImGui::Text("Index Buffer - %.1f KB, %d-bit indices",
+					mesh->GetIndexBufferSize() / 1024.0f,
+					mesh->GetIndexStride() * 8);
+				if (packed)
+				{
+					PackingError error = mesh->GetPackingError();
+					ImGui::Text("Max Error - position %.6f, uv %.6f", error.position, error.uv);
+					ImGui::Text("Max Error - normal %.4f deg, tangent %.4f deg", error.normalDegrees, error.tangentDegrees);
+				}
+
+				// How much of the mesh survived meshlet culling last frame
+				ImGui::Text("Meshlets - %d visible of %d", mesh->GetVisibleMeshletCount(), (int)mesh->GetMeshlets().size());
+
+				// Each level of detail and how far it strays from the full mesh
+				const std::vector<MeshLod>& lods = mesh->GetLods();
+				ImGui::Text("Current LOD - %d of %d", mesh->GetCurrentLod(), (int)lods.size());
+				for (int l = 0; l < lods.size(); l++)
+				{
+					ImGui::Text("LOD %d - %d triangles, error %.4f, hausdorff %.4f",
+						l, lods[l].indexCount / 3, lods[l].error, lods[l].hausdorffError);
+				}
+
+				// Local and world bounds (the world box fits the transformed
+				// local box, so it's looser than a box around the vertices)
+				Aabb bounds = mesh->GetBounds();
+				Sphere sphere = mesh->GetBoundingSphere();
+				Aabb worldBounds = mesh->GetWorldBounds(world);
+				Sphere worldSphere = mesh->GetWorldSphere(world);
+				ImGui::Text("Bounds - center (%.3f, %.3f, %.3f), extents (%.3f, %.3f, %.3f)",
+					bounds.center.x, bounds.center.y, bounds.center.z,
+					bounds.extents.x, bounds.extents.y, bounds.extents.z);
+				ImGui::Text("Sphere - center (%.3f, %.3f, %.3f), radius %.3f",
+					sphere.center.x, sphere.center.y, sphere.center.z, sphere.radius);
+				ImGui::Text("World Bounds - center (%.3f, %.3f, %.3f), extents (%.3f, %.3f, %.3f)",
+					worldBounds.center.x, worldBounds.center.y, worldBounds.center.z,
+					worldBounds.extents.x, worldBounds.extents.y, worldBounds.extents.z);
+				ImGui::Text("World Sphere - center (%.3f, %.3f, %.3f), radius %.3f",
+					worldSphere.center.x, worldSphere.center.y, worldSphere.center.z, worldSphere.radius);
+
+				// Only meshes imported with overdraw optimization have these
+				if (mesh->GetOverdraw() > 0.0f)
+					ImGui::Text("Overdraw - %.3f -> %.3f", mesh->GetUnoptimizedOverdraw(), mesh->GetOverdraw());
 
 			}
 		}
@@ -1147,12 +1574,260 @@ void Game::CreateUI()
 
 	}
 
+	// Totals GPU buffer memory for every mesh in the scene, against
+	// what the same meshes would take with 32-bit indices and full
+	// precision vertices
+	if (ImGui::CollapsingHeader("Memory Report"))
+	{
+		ImGui::Indent(20.0f);
+
+		std::set<Mesh*> countedMeshes;
+		int vertexBytes = 0, indexBytes = 0;
+		int unpackedVertexBytes = 0, wideIndexBytes = 0;
+		for (int i = 0; i < (int)entities.Count(); i++)
+		{
+			const std::shared_ptr<Mesh>& mesh = entities.MeshAt(i);
+			if (!countedMeshes.insert(mesh.get()).second)
+				continue;
+
+			vertexBytes += mesh->GetVertexBufferSize();
+			indexBytes += mesh->GetIndexBufferSize();
+			unpackedVertexBytes += (int)sizeof(Vertex) * mesh->GetVertexCount();
+			wideIndexBytes += (int)sizeof(unsigned int) * (mesh->GetIndexBufferSize() / mesh->GetIndexStride());
+		}
+
+		ImGui::Text("Meshes - %d", (int)countedMeshes.size());
+		ImGui::Text("Vertex Buffers - %.1f KB (%.1f KB unpacked)", vertexBytes / 1024.0f, unpackedVertexBytes / 1024.0f);
+		ImGui::Text("Index Buffers - %.1f KB (%.1f KB as 32-bit)", indexBytes / 1024.0f, wideIndexBytes / 1024.0f);
+		ImGui::Text("Total - %.1f KB, saving %.1f KB",
+			(vertexBytes + indexBytes) / 1024.0f,
+			(unpackedVertexBytes + wideIndexBytes - vertexBytes - indexBytes) / 1024.0f);
+
+		// How full each geometry pool is, and how scattered its free space
+		std::set<GeometryPool*> countedPools;
+		for (int i = 0; i < (int)entities.Count(); i++)
+		{
+			std::shared_ptr<GeometryPool> pool = entities.MeshAt(i)->GetPool();
+			if (!countedPools.insert(pool.get()).second)
+				continue;
+
+			const RangeAllocator& vertices = pool->GetVertexAllocator();
+			const RangeAllocator& indices = pool->GetIndexAllocator();
+			ImGui::Text("Pool %d (%d-byte vertices, %d-bit indices)",
+				(int)countedPools.size(), pool->GetVertexStride(), pool->GetIndexStride() * 8);
+			ImGui::Text("  Vertices - %d of %d used, %d free ranges",
+				(int)vertices.GetUsed(), (int)vertices.GetCapacity(), (int)vertices.GetFreeRangeCount());
+			ImGui::Text("  Indices - %d of %d used, %d free ranges",
+				(int)indices.GetUsed(), (int)indices.GetCapacity(), (int)indices.GetFreeRangeCount());
+		}
+
+		ImGui::Unindent(20.0f);
+	}
+
+	// What the mesh registry has loaded, and how often loads were
+	// shared instead of repeated
+	if (ImGui::CollapsingHeader("Mesh Registry"))
+	{
+		ImGui::Indent(20.0f);
+
+		MeshRegistry::Stats stats = MeshRegistry::GetStats();
+		ImGui::Text("Requests - %u (%u hits, %u misses)", stats.hits + stats.misses, stats.hits, stats.misses);
+		ImGui::Text("Meshes - %d, %.1f KB", (int)stats.meshCount, (stats.vertexBufferBytes + stats.indexBufferBytes) / 1024.0f);
+
+		for (const MeshRegistry::Entry& entry : MeshRegistry::GetEntries())
+		{
+			std::string name = std::filesystem::path(entry.path).filename().string();
+			ImGui::Text("%s - %u requests, %.1f KB (%.1f KB vertices, %.1f KB indices)",
+				name.c_str(), entry.requestCount,
+				(entry.vertexBufferSize + entry.indexBufferSize) / 1024.0f,
+				entry.vertexBufferSize / 1024.0f,
+				entry.indexBufferSize / 1024.0f);
+		}
+
+		ImGui::Unindent(20.0f);
+	}
+
+	// How many draws static batching saves in each pass
+	if (ImGui::CollapsingHeader("Static Batching"))
+	{
+		ImGui::Indent(20.0f);
+
+		int batchedCount = (int)std::count(entityBatched.begin(), entityBatched.end(), true);
+		int drawCount = (int)entities.Count() - batchedCount + (int)staticBatches.Count();
+		ImGui::Text("Static Entities - %d (%d batched)", (int)staticBatchMembers.size(), batchedCount);
+		ImGui::Text("Batches - %d", (int)staticBatches.Count());
+		ImGui::Text("Draw Calls - %d -> %d per pass", (int)entities.Count(), drawCount);
+		ImGui::Text("Rebuilds - %d", staticBatchRebuilds);
+
+		for (int i = 0; i < (int)staticBatches.Count(); i++)
+		{
+			const std::shared_ptr<Mesh>& mesh = staticBatches.MeshAt(i);
+			ImGui::Text("Batch %d - %d triangles, %.1f KB", i + 1, mesh->GetIndexCount() / 3,
+				(mesh->GetVertexBufferSize() + mesh->GetIndexBufferSize()) / 1024.0f);
+		}
+
+		ImGui::Unindent(20.0f);
+	}
+
+	// Instanced draws, and a grid of identical props to stress them
+	if (ImGui::CollapsingHeader("Instancing"))
+	{
+		ImGui::Indent(20.0f);
+
+		if (ImGui::SliderInt("Props", &propCount, 0, 20000))
+			CreateProps();
+
+		ImGui::Text("Main Pass - %d draw calls, %d instances in %d groups", mainDrawCalls, mainInstanceCount, mainInstanceGroupCount);
+		ImGui::Text("Shadow Pass - %d draw calls", shadowDrawCalls);
+		ImGui::Text("Frustum Culling - %d visible, %d culled (%s)",
+			mainVisibleCount, mainCulledCount, Culling::GetName(Culling::GetBestKernel()));
+
+		if (ImGui::Button("Run Culling Benchmark (100k spheres)"))
+			cullingBenchmarkResults = SceneBenchmark::RunCulling(100000, 30);
+
+		for (const SceneBenchmark::CullingResult& result : cullingBenchmarkResults)
+		{
+			ImGui::Text("%s - %.3f ms, %d visible", result.kernel, result.cullMs, (int)result.visibleCount);
+		}
+		ImGui::Text("Instance Buffer - %.1f KB", instanceBuffer.GetCapacity() * sizeof(unsigned int) / 1024.0f);
+		ImGui::Text("Object Buffer - %.1f KB", objectCache.GetCapacity() * sizeof(InstanceData) / 1024.0f);
+
+		// What moving only the changed objects saves
+		ImGui::Text("Uploaded Last Frame - %.1f KB", (objectUploadBytes + instanceUploadBytes + singleUploadBytes) / 1024.0f);
+		ImGui::Text("  Object Data - %.1f KB (%zu objects)", objectUploadBytes / 1024.0f, objectCache.GetLastUploadCount());
+		ImGui::Text("  Instance Indices - %.1f KB", instanceUploadBytes / 1024.0f);
+		ImGui::Text("  Single Draw Indices - %.1f KB", singleUploadBytes / 1024.0f);
+		ImGui::Text("Without Caching - %.1f KB", uncachedUploadBytes / 1024.0f);
+
+		ImGui::Unindent(20.0f);
+	}
+
+	// Storage and update cost of every transform
+	if (ImGui::CollapsingHeader("Transforms"))
+	{
+		ImGui::Indent(20.0f);
+
+		TransformSystem::Stats stats = TransformSystem::GetStats();
+		ImGui::Text("Transforms - %zu (%zu slots)", stats.transformCount, stats.capacity);
+		ImGui::Text("Hierarchy - %zu children, %u levels deep", stats.childCount, stats.hierarchyDepth);
+		ImGui::Text("Last Update - %zu recomputed, %zu composed in %.3f ms", stats.lastUpdateCount, stats.lastComposeCount, stats.lastUpdateMs);
+
+		ImGui::Unindent(20.0f);
+	}
+
+	// Worker threads, and how the frame's scene work scales across them
+	if (ImGui::CollapsingHeader("Job System"))
+	{
+		ImGui::Indent(20.0f);
+
+		ImGui::Text("Threads - %u (%u workers)", JobSystem::GetThreadCount(), JobSystem::GetThreadCount() - 1);
+
+		// Stalls the frame for a few seconds while it runs
+		if (ImGui::Button("Run Scene Benchmark (50k entities)"))
+			sceneBenchmarkResults = SceneBenchmark::Run(50000, 30);
+
+		for (const SceneBenchmark::Result& result : sceneBenchmarkResults)
+		{
+			double total = result.transformMs + result.prepareMs;
+			double baseline = sceneBenchmarkResults[0].transformMs + sceneBenchmarkResults[0].prepareMs;
+			ImGui::Text("%u threads - transforms %.2f ms, prepare %.2f ms, %.2fx", result.threadCount,
+				result.transformMs, result.prepareMs, total > 0.0 ? baseline / total : 0.0);
+		}
+
+		ImGui::Unindent(20.0f);
+	}
+
+	// Entity stores, and what their dense arrays save over separate
+	// heap objects
+	if (ImGui::CollapsingHeader("Entity Storage"))
+	{
+		ImGui::Indent(20.0f);
+
+		ImGui::Text("Scene - %d entities", (int)entities.Count());
+		ImGui::Text("Static Batches - %d entities", (int)staticBatches.Count());
+		ImGui::Text("Props - %d entities", (int)props.Count());
+
+		// Stalls the frame for a moment while it runs
+		if (ImGui::Button("Run Entity Benchmark (50k entities)"))
+			entityBenchmarkResults = SceneBenchmark::RunEntities(50000, 5000, 30);
+
+		for (const SceneBenchmark::EntityResult& result : entityBenchmarkResults)
+		{
+			ImGui::Text("%s - spawn %.2f ms, churn %.2f ms, iterate %.2f ms",
+				result.storage, result.spawnMs, result.churnMs, result.iterateMs);
+		}
+
+		ImGui::Unindent(20.0f);
+	}
+
+	// Bounding volume hierarchies, and a few queries through them
+	// from the current camera
+	if (ImGui::CollapsingHeader("Scene BVH"))
+	{
+		ImGui::Indent(20.0f);
+
+		ImGui::Text("Entities - %d items, %d nodes, cost %.2f (%.2f when built)", (int)entityBvh.GetItemCount(),
+			(int)entityBvh.GetNodeCount(), entityBvh.GetCost(), entityBvh.GetBuiltCost());
+		ImGui::Text("  %d refits, %d rebuilds", entityBvhRefits, entityBvhRebuilds);
+		ImGui::Text("Props - %d items, %d nodes, cost %.2f", (int)propBvh.GetItemCount(),
+			(int)propBvh.GetNodeCount(), propBvh.GetCost());
+
+		// Everything in view
+		XMFLOAT4X4 view = currentCamera->ViewMatrix();
+		XMFLOAT4X4 projection = currentCamera->ProjectionMatrix();
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+		Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+		std::vector<unsigned int> entityHits, propHits;
+		entityBvh.QueryFrustum(frustum, entityHits);
+		propBvh.QueryFrustum(frustum, propHits);
+		ImGui::Text("In View - %d entities, %d props", (int)entityHits.size(), (int)propHits.size());
+
+		// Everything near the camera
+		XMFLOAT3 cameraPosition = currentCamera->GetTransform().GetPosition();
+		ImGui::SliderFloat("Query Radius", &bvhQueryRadius, 0.5f, 50.0f);
+		Sphere nearby = { cameraPosition, bvhQueryRadius };
+		entityHits.clear();
+		propHits.clear();
+		entityBvh.QuerySphere(nearby, entityHits);
+		propBvh.QuerySphere(nearby, propHits);
+		ImGui::Text("Nearby - %d entities, %d props", (int)entityHits.size(), (int)propHits.size());
+
+		// Whatever is straight ahead
+		XMFLOAT3 forward = currentCamera->GetTransform().GetForward();
+		Bvh::RayHit entityHit, propHit;
+		bool hitEntity = entityBvh.Raycast(cameraPosition, forward, 1000.0f, entityHit);
+		bool hitProp = propBvh.Raycast(cameraPosition, forward, 1000.0f, propHit);
+		if (hitEntity && (!hitProp || entityHit.distance <= propHit.distance))
+			ImGui::Text("Looking At - Entity %d, %.2f away", (int)entityHit.item + 1, entityHit.distance);
+		else if (hitProp)
+			ImGui::Text("Looking At - Prop %d, %.2f away", (int)propHit.item + 1, propHit.distance);
+		else
+			ImGui::Text("Looking At - Nothing");
+
+		// Stalls the frame for a few seconds while it runs
+		if (ImGui::Button("Run BVH Benchmark (100k boxes)"))
+			bvhBenchmarkResults = SceneBenchmark::RunBvh(100000, 30);
+
+		if (!bvhBenchmarkResults.queries.empty())
+		{
+			ImGui::Text("Build %.2f ms, refit %.2f ms", bvhBenchmarkResults.buildMs, bvhBenchmarkResults.refitMs);
+			for (const SceneBenchmark::BvhQueryResult& result : bvhBenchmarkResults.queries)
+			{
+				ImGui::Text("%s - %.4f ms, brute force %.4f ms", result.query, result.bvhMs, result.bruteForceMs);
+			}
+		}
+
+		ImGui::Unindent(20.0f);
+	}
+
 	// Shows individual entities position, rotation, and scale and allows user to edit them
 	if (ImGui::CollapsingHeader("Scene Entities"))
 	{
 		ImGui::Indent(20.0f); // Indent to make the data more organized
 
-		for (int i = 0; i < entities.size(); i++)
+		for (int i = 0; i < (int)entities.Count(); i++)
 		{
 			ImGui::PushID(i);
 
@@ -1162,21 +1837,56 @@ void Game::CreateUI()
 			if (ImGui::CollapsingHeader(entityLabel.c_str()))
 			{
 				// Get current transform data
-				DirectX::XMFLOAT3 pos = entities[i].GetTransform()->GetPosition();
-				DirectX::XMFLOAT3 rot = entities[i].GetTransform()->GetPitchYawRoll();
-				DirectX::XMFLOAT3 scale = entities[i].GetTransform()->GetScale();
+				Transform& transform = entities.TransformAt(i);
+				DirectX::XMFLOAT3 pos = transform.GetPosition();
+				DirectX::XMFLOAT3 rot = transform.GetPitchYawRoll();
+				DirectX::XMFLOAT3 scale = transform.GetScale();
 
 				// Position
 				if (ImGui::DragFloat3("Position", &pos.x, 0.01f))
-					entities[i].GetTransform()->SetPosition(pos);
+					transform.SetPosition(pos);
 
 				// Rotation
 				if (ImGui::DragFloat3("Rotation", &rot.x, 0.01f))
-					entities[i].GetTransform()->SetRotation(rot);
+					transform.SetRotation(rot);
 
 				// Scale
 				if (ImGui::DragFloat3("Scale", &scale.x, 0.01f))
-					entities[i].GetTransform()->SetScale(scale);
+					transform.SetScale(scale);
+
+				// Parent, which the values above are relative to
+				Transform* parent = transform.GetParent();
+				int parentIndex = -1;
+				for (int j = 0; j < (int)entities.Count(); j++)
+				{
+					if (&entities.TransformAt(j) == parent)
+						parentIndex = j;
+				}
+
+				std::string parentLabel = parentIndex < 0 ? "None" : "Entity " + std::to_string(parentIndex + 1);
+				if (ImGui::BeginCombo("Parent", parentLabel.c_str()))
+				{
+					if (ImGui::Selectable("None", parentIndex < 0))
+						transform.SetParent(nullptr);
+
+					for (int j = 0; j < (int)entities.Count(); j++)
+					{
+						std::string label = "Entity " + std::to_string(j + 1);
+						if (j == i || !ImGui::Selectable(label.c_str(), j == parentIndex))
+							continue;
+
+						// Parenting to a descendant would make a cycle, which is refused
+						try { transform.SetParent(&entities.TransformAt(j)); }
+						catch (const std::invalid_argument&) {}
+					}
+
+					ImGui::EndCombo();
+				}
+
+				// Static entities can be merged into batches
+				bool isStatic = entities.IsStaticAt(i);
+				if (ImGui::Checkbox("Static", &isStatic))
+					entities.SetStatic(entities.HandleAt(i), isStatic);
 
 			}
 
@@ -5,12 +5,15 @@
 #include <memory>
 
 #include "Mesh.h"
-#include "Entity.h"
+#include "Bvh.h"
+#include "EntityStore.h"
 #include <vector>
 #include <DirectXMath.h>
 #include "Camera.h"
 #include "Lights.h"
 #include "Skybox.h"
+#include "Instancing.h"
+#include "SceneBenchmark.h"
 
 
 
@@ -51,8 +54,10 @@ public:
 	float time;
 	bool stopwatch = false;
 
-	// Declaration for Mesh class objects
-	std::vector<Entity> entities;
+	// The scene's entities
+	// - Never despawned, so their dense positions double as the
+	//   numbers the UI shows
+	EntityStore entities;
 
 	DirectX::XMFLOAT4 colorTint;
 	DirectX::XMFLOAT3 translation;
@@ -73,6 +78,19 @@ private:
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	void CreateGeometry();
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> CreatePackedInputLayout(const std::wstring& shaderFile, bool instanced = false);
+
+	// Merges static entities that share a material (see StaticBatching)
+	void UpdateStaticBatches();
+
+	// Rebuilds the grid of instanced props
+	void CreateProps();
+
+	// Keeps the scene entities' hierarchy fitted to where they are now
+	void UpdateEntityBvh();
+
+	// Per-frame lighting data shared by regular and instanced draws
+	void SetLightingData(std::shared_ptr<SimpleVertexShader> vs, Material* material);
 
 	// Note the usage of ComPtr below
 	//  - This is a smart pointer for objects that abide by the
@@ -92,6 +110,76 @@ private:
 	// Sky box pointer
 	std::shared_ptr<Skybox> skybox;
 
+	// Static batching
+	// - What the current batches were built from, so they're only
+	//   rebuilt when static entities come, go or change
+	// - One merged entity per material shared by two or more static
+	//   entities, drawn in place of the entities it covers
+	struct StaticBatchMember
+	{
+		int entityIndex;	// Dense position in entities
+		Mesh* mesh;
+		Material* material;
+		DirectX::XMFLOAT4X4 world;
+	};
+	std::vector<StaticBatchMember> staticBatchMembers;
+	EntityStore staticBatches;
+	std::vector<bool> entityBatched;
+	int staticBatchRebuilds = 0;
+
+	// Instancing
+	// - Object data is cached and only sent when it changes
+	// - Props are copies of one mesh and material, for testing
+	//   large instance counts
+	ObjectCache objectCache;
+	InstanceBuffer instanceBuffer;
+	DrawList drawList;
+	EntityStore props;
+	std::shared_ptr<Mesh> propMesh;
+	std::shared_ptr<Material> propMaterial;
+	int propCount = 0;
+	int mainDrawCalls = 0;
+	int mainInstanceCount = 0;
+	int mainVisibleCount = 0;
+	int mainCulledCount = 0;
+	int mainInstanceGroupCount = 0;
+	int shadowDrawCalls = 0;
+
+	// Bytes of per-object data sent to the GPU last frame, and what
+	// sending every instance's matrices (as before the cache) would take
+	size_t objectUploadBytes = 0;
+	size_t instanceUploadBytes = 0;
+	size_t singleUploadBytes = 0;
+	size_t uncachedUploadBytes = 0;
+
+	// Job system
+	// - Results of the last headless scene benchmark run from the UI
+	std::vector<SceneBenchmark::Result> sceneBenchmarkResults;
+
+	// Entity storage
+	// - Results of the last entity storage benchmark run from the UI
+	std::vector<SceneBenchmark::EntityResult> entityBenchmarkResults;
+
+	// Culling
+	// - Results of the last culling kernel benchmark run from the UI
+	std::vector<SceneBenchmark::CullingResult> cullingBenchmarkResults;
+
+	// Bounding volume hierarchies over world bounds, for queries
+	// - Props never move, so theirs is built once per CreateProps()
+	// - Scene entities move, so theirs is refitted every frame, and
+	//   only rebuilt when refitting has worn it down or entities
+	//   come or go
+	// - Items are dense positions in the stores
+	Bvh propBvh;
+	Bvh entityBvh;
+	std::vector<Aabb> entityBounds;
+	std::vector<unsigned int> entityBoundsSlots;	// Transform and version each box is for
+	std::vector<unsigned int> entityBoundsVersions;
+	int entityBvhRefits = 0;
+	int entityBvhRebuilds = 0;
+	float bvhQueryRadius = 5.0f;
+	SceneBenchmark::BvhResults bvhBenchmarkResults = {};
+
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState > samplerState;
 
@@ -103,6 +191,9 @@ private:
 	DirectX::XMFLOAT4X4 lightViewMatrix;
 	DirectX::XMFLOAT4X4 lightProjectionMatrix;
 	std::shared_ptr<SimpleVertexShader> shadowVS;
+	std::shared_ptr<SimpleVertexShader> shadowPackedVS; // For meshes using PackedVertex
+	std::shared_ptr<SimpleVertexShader> shadowInstancedVS;
+	std::shared_ptr<SimpleVertexShader> shadowPackedInstancedVS;
 	int shadowMapResolution = 1024; // Ideally a power of 2
 
 
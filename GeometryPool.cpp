@@ -0,0 +1,195 @@
+#include "GeometryPool.h"
+#include "Graphics.h"
+#include "VertexPacking.h"
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+	// One pool per vertex layout and index format
+	std::mutex poolsMutex;
+	std::map<std::pair<VertexLayout, DXGI_FORMAT>, std::shared_ptr<GeometryPool>> pools;
+
+	// The pool whose buffers are bound to the input assembler
+	GeometryPool* boundPool = nullptr;
+}
+
+
+std::shared_ptr<GeometryPool> GeometryPool::For(VertexLayout vertexLayout, DXGI_FORMAT indexFormat)
+{
+	std::lock_guard<std::mutex> lock(poolsMutex);
+
+	std::shared_ptr<GeometryPool>& pool = pools[{ vertexLayout, indexFormat }];
+	if (!pool)
+		pool = std::make_shared<GeometryPool>((unsigned int)VertexPacking::StrideOf(vertexLayout), indexFormat);
+
+	return pool;
+}
+
+void GeometryPool::ForgetBindings()
+{
+	boundPool = nullptr;
+}
+
+void GeometryPool::ReleaseAll()
+{
+	std::lock_guard<std::mutex> lock(poolsMutex);
+	pools.clear();
+}
+
+GeometryPool::GeometryPool(unsigned int vertexStride, DXGI_FORMAT indexFormat)
+	: vertexStride(vertexStride), indexFormat(indexFormat),
+	indexStride(indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int))
+{
+	GrowBuffer(vertexBuffer, D3D11_BIND_VERTEX_BUFFER, 0, InitialVertexCapacity * vertexStride);
+	GrowBuffer(indexBuffer, D3D11_BIND_INDEX_BUFFER, 0, InitialIndexCapacity * indexStride);
+	vertexAllocator.Grow(InitialVertexCapacity);
+	indexAllocator.Grow(InitialIndexCapacity);
+}
+
+GeometryPool::~GeometryPool()
+{
+	if (boundPool == this)
+		boundPool = nullptr;
+}
+
+// --------------------------------------------------------
+// Replaces a buffer with a bigger one, copying the old
+// contents over on the GPU
+//
+// - Pool buffers use DEFAULT usage (not IMMUTABLE) so
+//   meshes can be copied in after they're created
+// --------------------------------------------------------
+void GeometryPool::GrowBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT bindFlags, unsigned int oldBytes, unsigned int newBytes)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.ByteWidth = newBytes;
+	desc.BindFlags = bindFlags;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = 0;
+	desc.StructureByteStride = 0;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> newBuffer;
+	if (FAILED(Graphics::Device->CreateBuffer(&desc, 0, newBuffer.GetAddressOf())))
+		throw std::runtime_error("GeometryPool couldn't create a buffer");
+
+	if (buffer && oldBytes > 0)
+	{
+		D3D11_BOX oldContents = { 0, 0, 0, oldBytes, 1, 1 };
+		Graphics::Context->CopySubresourceRegion(newBuffer.Get(), 0, 0, 0, 0, buffer.Get(), 0, &oldContents);
+	}
+
+	// The old buffer might be the one that's bound
+	if (boundPool == this)
+		boundPool = nullptr;
+
+	buffer = newBuffer;
+}
+
+unsigned int GeometryPool::AllocateRange(RangeAllocator& allocator, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT bindFlags, unsigned int stride, unsigned int count)
+{
+	size_t offset = allocator.Allocate(count);
+	while (offset == RangeAllocator::InvalidOffset)
+	{
+		size_t oldCapacity = allocator.GetCapacity();
+		size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + count);
+		if (newCapacity * stride > D3D11_REQ_RESOURCE_SIZE_IN_MEGABYTES_EXPRESSION_A_TERM * 1024ull * 1024ull)
+			throw std::runtime_error("GeometryPool is out of space");
+
+		GrowBuffer(buffer, bindFlags, (unsigned int)(oldCapacity * stride), (unsigned int)(newCapacity * stride));
+		allocator.Grow(newCapacity);
+		offset = allocator.Allocate(count);
+	}
+
+	return (unsigned int)offset;
+}
+
+// --------------------------------------------------------
+// Finds room for a mesh and copies it in
+// --------------------------------------------------------
+GeometryPool::Allocation GeometryPool::Allocate(const void* vertices, unsigned int vertexCount, const void* indices, unsigned int indexCount)
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	Allocation allocation = {};
+	allocation.vertexCount = vertexCount;
+	allocation.indexCount = indexCount;
+	allocation.baseVertex = AllocateRange(vertexAllocator, vertexBuffer, D3D11_BIND_VERTEX_BUFFER, vertexStride, vertexCount);
+	try
+	{
+		allocation.startIndex = AllocateRange(indexAllocator, indexBuffer, D3D11_BIND_INDEX_BUFFER, indexStride, indexCount);
+	}
+	catch (...)
+	{
+		vertexAllocator.Free(allocation.baseVertex);
+		throw;
+	}
+
+	D3D11_BOX vertexRange = { allocation.baseVertex * vertexStride, 0, 0, (allocation.baseVertex + vertexCount) * vertexStride, 1, 1 };
+	D3D11_BOX indexRange = { allocation.startIndex * indexStride, 0, 0, (allocation.startIndex + indexCount) * indexStride, 1, 1 };
+	Graphics::Context->UpdateSubresource(vertexBuffer.Get(), 0, &vertexRange, vertices, 0, 0);
+	Graphics::Context->UpdateSubresource(indexBuffer.Get(), 0, &indexRange, indices, 0, 0);
+
+	return allocation;
+}
+
+void GeometryPool::Free(const Allocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	vertexAllocator.Free(allocation.baseVertex);
+	indexAllocator.Free(allocation.startIndex);
+}
+
+void GeometryPool::Bind()
+{
+	if (boundPool == this)
+		return;
+
+	UINT stride = vertexStride;
+	UINT offset = 0;
+	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
+	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), indexFormat, 0);
+	boundPool = this;
+}
+
+//---------------
+// Getter Methods
+//---------------
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryPool::GetVertexBuffer()
+{
+	return vertexBuffer;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> GeometryPool::GetIndexBuffer()
+{
+	return indexBuffer;
+}
+
+unsigned int GeometryPool::GetVertexStride()
+{
+	return vertexStride;
+}
+
+unsigned int GeometryPool::GetIndexStride()
+{
+	return indexStride;
+}
+
+DXGI_FORMAT GeometryPool::GetIndexFormat()
+{
+	return indexFormat;
+}
+
+const RangeAllocator& GeometryPool::GetVertexAllocator()
+{
+	return vertexAllocator;
+}
+
+const RangeAllocator& GeometryPool::GetIndexAllocator()
+{
+	return indexAllocator;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <mutex>
+#include "RangeAllocator.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Large shared vertex and index buffers that many meshes
+// are sub-allocated from, one pool per vertex layout and
+// index format
+// - Meshes created while nothing else uses the immediate context
+// --------------------------------------------------------
+class GeometryPool
+{
+
+public:
+
+	// Where a mesh lives in its pool, in vertices and indices
+	struct Allocation
+	{
+		unsigned int baseVertex;
+		unsigned int vertexCount;
+		unsigned int startIndex;
+		unsigned int indexCount;
+	};
+
+	// Starting sizes of new pools, which double whenever they fill up
+	static const unsigned int InitialVertexCapacity = 64 * 1024;
+	static const unsigned int InitialIndexCapacity = 192 * 1024;
+
+	// The shared pool for a vertex layout and index format
+	static std::shared_ptr<GeometryPool> For(VertexLayout vertexLayout, DXGI_FORMAT indexFormat);
+
+	// Forgets what's bound, for when something else may have
+	// changed the input assembler's buffers
+	static void ForgetBindings();
+
+	// Lets go of the shared pools (each one is destroyed once
+	// the last mesh using it is)
+	static void ReleaseAll();
+
+	// Constructor
+	GeometryPool(unsigned int vertexStride, DXGI_FORMAT indexFormat);
+
+	// Destructor
+	~GeometryPool();
+
+	// Pools own the GPU buffers their meshes point into, so they can't be copied
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+
+	// Copies a mesh's vertices and indices (already in this pool's
+	// format) into the pool
+	// - Indices stay relative to the mesh's own first vertex
+	Allocation Allocate(const void* vertices, unsigned int vertexCount, const void* indices, unsigned int indexCount);
+	void Free(const Allocation& allocation);
+
+	// Binds this pool's buffers, unless they're bound already
+	void Bind();
+
+	// Getters for data
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
+	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
+	unsigned int GetVertexStride();
+	unsigned int GetIndexStride();
+	DXGI_FORMAT GetIndexFormat();
+	const RangeAllocator& GetVertexAllocator();
+	const RangeAllocator& GetIndexAllocator();
+
+private:
+
+	// Format of the pool's contents
+	unsigned int vertexStride;
+	DXGI_FORMAT indexFormat;
+	unsigned int indexStride;
+
+	// The shared buffers and which parts of them are in use
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	RangeAllocator vertexAllocator;
+	RangeAllocator indexAllocator;
+
+	// Meshes may be loaded from more than one thread
+	std::mutex poolMutex;
+
+	// Replaces a buffer with a bigger one holding the same contents
+	void GrowBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT bindFlags, unsigned int oldBytes, unsigned int newBytes);
+
+	// Allocates, growing the buffer until the range fits
+	unsigned int AllocateRange(RangeAllocator& allocator, Microsoft::WRL::ComPtr<ID3D11Buffer>& buffer, UINT bindFlags, unsigned int stride, unsigned int count);
+
+};
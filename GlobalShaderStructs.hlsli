@@ -21,6 +21,37 @@ struct VertexShaderInput
     float3 tangent : TANGENT;
 };
 
+// Quantized version of the vertex above
+// - Matches PackedVertex in our C++ code, and needs a custom
+//   input layout since reflection can't tell the formats apart
+struct VertexShaderInput_Packed
+{
+    float4 localPosition : POSITION; // R16G16B16A16_UNORM, xyz relative to the mesh bounds, w = handedness
+    float2 uv : TEXCOORD; // R16G16_FLOAT
+    float2 normal : NORMAL; // R16G16_SNORM, octahedral encoded
+    float2 tangent : TANGENT; // R16G16_SNORM, octahedral encoded
+};
+
+
+// Per-object data, kept on the GPU from frame to frame
+// - Matches InstanceData in our C++ code (see ObjectCache), and
+//   read from a structured buffer named Objects, whose matrices
+//   read the same way as those in constant buffers
+struct ObjectData
+{
+    matrix world;
+    matrix worldInvTranspose;
+};
+
+// Per-instance data for instanced draws
+// - Just the instance's index into Objects, read from input slot 1
+//   (SimpleShader treats any semantic ending in _PER_INSTANCE
+//   as instance data in that slot)
+struct InstanceInput
+{
+    uint objectIndex : OBJECT_INDEX_PER_INSTANCE;
+};
+
 
 // Struct representing the data we expect to receive from earlier pipeline stages
 // - Should match the output of our corresponding vertex shader
@@ -74,6 +105,26 @@ struct Light
 };
 
 
+//-----------------------
+// Vertex Packing Methods
+//-----------------------
+
+// Unit vector from its octahedral encoding (matches VertexPacking::DecodeOctahedral)
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 direction = float3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+    
+    // Unfold the lower half
+    if (direction.z < 0.0f)
+    {
+        float2 signNotZero = direction.xy >= 0.0f ? 1.0f : -1.0f;
+        direction.xy = (1.0f - abs(direction.yx)) * signNotZero;
+    }
+    
+    return normalize(direction);
+}
+
+
 //-----------------------
 // Normal Mapping Methods
 //-----------------------
@@ -0,0 +1,30 @@
+#include "SceneBenchmark.h"
+#include "SelfTest.h"
+
+#include <cstdio>
+#include <cstring>
+
+// --------------------------------------------------------
+// Entry point for the headless checks and benchmarks where
+// there's no WinMain() (see Main.cpp for the same switches)
+//
+// - Needs only the CPU-side files and DirectXMath's headers
+// - Models are read from Assets/Models/ under the working
+//   directory unless another directory follows -test
+// --------------------------------------------------------
+#if !defined(_WIN32)
+int main(int argc, char* argv[])
+{
+	if (argc >= 2 && strcmp(argv[1], "-test") == 0)
+		return SelfTest::Run(argc >= 3 ? argv[2] : "Assets/Models/");
+
+	if (argc >= 2 && strcmp(argv[1], "-benchmark") == 0)
+	{
+		SceneBenchmark::PrintAll();
+		return 0;
+	}
+
+	printf("Usage: %s -test [model directory] | -benchmark\n", argv[0]);
+	return 1;
+}
+#endif
@@ -0,0 +1,228 @@
+#include "Instancing.h"
+#include "Culling.h"
+#include "Graphics.h"
+#include "JobSystem.h"
+#include "TransformSystem.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+using namespace DirectX;
+
+namespace
+{
+	// What entities must share to draw together
+	typedef std::tuple<Mesh*, Material*, int> GroupKey;
+
+	// Entities per job when preparing them
+	const size_t PrepareGrain = 64;
+
+	// Everything grouping needs to know about one draw
+	struct PreparedEntity
+	{
+		unsigned int object;	// Index in the object cache
+		GroupKey key;
+		bool instanced;
+	};
+
+	// --------------------------------------------------------
+	// Buckets entities by key, then turns big enough buckets
+	// into groups
+	// - The per-entity work runs on the job system, so keyOf must
+	//   be safe to call from several threads
+	// --------------------------------------------------------
+	template<typename KeyOf>
+	void Group(const DrawList& draws, bool keepMaterial, ObjectCache& objects, KeyOf keyOf, const Frustum* frustum,
+		std::vector<InstanceGroup>& groups, std::vector<unsigned int>& instances, std::vector<unsigned int>& singles)
+	{
+		groups.clear();
+		instances.clear();
+		singles.clear();
+
+		objects.Reserve(TransformSystem::GetStats().capacity);
+
+		std::vector<PreparedEntity> prepared(draws.Size());
+		std::vector<uint8_t> visible(draws.Size(), 1);
+		SphereList spheres;
+		spheres.Resize(frustum ? draws.Size() : 0);
+		JobSystem::ParallelFor(draws.Size(), PrepareGrain, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				PreparedEntity& entry = prepared[i];
+				entry.object = objects.Prepare(draws.transformSlots[i], draws.meshes[i]);
+				entry.instanced = keyOf(draws.meshes[i], draws.materials[i], entry.object, entry.key);
+				if (frustum)
+					spheres.Set(i, objects.GetWorldSphere(entry.object));
+			}
+
+			if (frustum)
+				Culling::CullSpheres(*frustum, spheres, begin, end, visible.data());
+		});
+
+		std::map<GroupKey, size_t> bucketOfKey;
+		std::vector<std::vector<unsigned int>> buckets;
+		std::vector<GroupKey> bucketKeys;
+		for (size_t i = 0; i < draws.Size(); i++)
+		{
+			if (!visible[i])
+				continue;
+
+			if (!prepared[i].instanced)
+			{
+				singles.push_back((unsigned int)i);
+				continue;
+			}
+
+			auto [found, added] = bucketOfKey.insert({ prepared[i].key, buckets.size() });
+			if (added)
+			{
+				buckets.emplace_back();
+				bucketKeys.push_back(prepared[i].key);
+			}
+
+			buckets[found->second].push_back((unsigned int)i);
+		}
+
+		for (size_t b = 0; b < buckets.size(); b++)
+		{
+			if (buckets[b].size() < Instancing::MinGroupSize)
+			{
+				singles.insert(singles.end(), buckets[b].begin(), buckets[b].end());
+				continue;
+			}
+
+			InstanceGroup group = {};
+			group.mesh = draws.meshes[buckets[b][0]];
+			group.material = keepMaterial ? draws.materials[buckets[b][0]] : nullptr;
+			group.lod = std::get<2>(bucketKeys[b]);
+			group.firstInstance = (unsigned int)instances.size();
+
+			for (unsigned int i : buckets[b])
+				instances.push_back(prepared[i].object);
+
+			group.instanceCount = (unsigned int)instances.size() - group.firstInstance;
+			groups.push_back(group);
+		}
+	}
+}
+
+
+void DrawList::Clear()
+{
+	transformSlots.clear();
+	meshes.clear();
+	materials.clear();
+}
+
+void DrawList::Add(EntityStore& store)
+{
+	for (size_t i = 0; i < store.Count(); i++)
+		Add(store.TransformAt(i).GetSlot(), store.MeshAt(i).get(), store.MaterialAt(i).get());
+}
+
+void DrawList::Add(unsigned int transformSlot, Mesh* mesh, Material* material)
+{
+	transformSlots.push_back(transformSlot);
+	meshes.push_back(mesh);
+	materials.push_back(material);
+}
+
+size_t DrawList::Size() const
+{
+	return transformSlots.size();
+}
+
+
+// --------------------------------------------------------
+// Groups for the main pass
+//
+// - Each entity's level of detail is part of its key, so
+//   nearby and distant copies of a mesh draw as separate
+//   groups at their own detail
+// --------------------------------------------------------
+void Instancing::GroupForCamera(const DrawList& draws, std::shared_ptr<Camera> camera, ObjectCache& objects,
+	std::vector<InstanceGroup>& groups, std::vector<unsigned int>& instances, std::vector<unsigned int>& singles)
+{
+	XMFLOAT4X4 view = camera->ViewMatrix();
+	XMFLOAT4X4 projection = camera->ProjectionMatrix();
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+	Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+	auto keyOf = [&](Mesh* mesh, Material* material, unsigned int object, GroupKey& key)
+	{
+		if (!material->SupportsInstancing(mesh->GetVertexLayout()))
+			return false;
+
+		int lod = mesh->SelectLod(objects.GetObjectData(object).world, camera);
+		key = GroupKey(mesh, material, lod);
+		return true;
+	};
+
+	Group(draws, true, objects, keyOf, &frustum, groups, instances, singles);
+}
+
+// --------------------------------------------------------
+// Groups for the shadow pass, where only the mesh matters
+// --------------------------------------------------------
+void Instancing::GroupForShadows(const DrawList& draws, ObjectCache& objects,
+	std::vector<InstanceGroup>& groups, std::vector<unsigned int>& instances, std::vector<unsigned int>& singles)
+{
+	auto keyOf = [](Mesh* mesh, Material* material, unsigned int object, GroupKey& key)
+	{
+		key = GroupKey(mesh, nullptr, 0);
+		return true;
+	};
+
+	Group(draws, false, objects, keyOf, nullptr, groups, instances, singles);
+}
+
+
+InstanceBuffer::InstanceBuffer()
+	: capacity(0)
+{
+}
+
+// --------------------------------------------------------
+// Fills the buffer (growing it first if needed) and binds it
+// to input slot 1, leaving slot 0 to the geometry pools
+// --------------------------------------------------------
+void InstanceBuffer::Upload(const std::vector<unsigned int>& instances)
+{
+	if (instances.empty())
+		return;
+
+	if (instances.size() > capacity)
+	{
+		capacity = std::max((unsigned int)instances.size(), capacity * 2);
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DYNAMIC;
+		desc.ByteWidth = capacity * sizeof(unsigned int);
+		desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.MiscFlags = 0;
+		desc.StructureByteStride = 0;
+
+		buffer.Reset();
+		if (FAILED(Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+			throw std::runtime_error("Couldn't create the instance buffer");
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	Graphics::Context->Map(buffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, instances.data(), instances.size() * sizeof(unsigned int));
+	Graphics::Context->Unmap(buffer.Get(), 0);
+
+	UINT stride = sizeof(unsigned int);
+	UINT offset = 0;
+	Graphics::Context->IASetVertexBuffers(1, 1, buffer.GetAddressOf(), &stride, &offset);
+}
+
+unsigned int InstanceBuffer::GetCapacity()
+{
+	return capacity;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include <DirectXMath.h>
+#include "Camera.h"
+#include "EntityStore.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "ObjectCache.h"
+
+// --------------------------------------------------------
+// A frame's entities to draw, gathered from entity stores
+// into parallel dense arrays
+// - Only borrows the meshes and materials, which the stores
+//   keep alive
+// --------------------------------------------------------
+struct DrawList
+{
+	std::vector<unsigned int> transformSlots;
+	std::vector<Mesh*> meshes;
+	std::vector<Material*> materials;
+
+	void Clear();
+	void Add(EntityStore& store);	// Every entity in the store
+	void Add(unsigned int transformSlot, Mesh* mesh, Material* material);
+	size_t Size() const;
+};
+
+// --------------------------------------------------------
+// Entities that can be drawn with a single instanced call:
+// a run of instances sharing a mesh, material (unless it's
+// for the shadow map) and level of detail
+// --------------------------------------------------------
+struct InstanceGroup
+{
+	Mesh* mesh;
+	Material* material;
+	int lod;
+	unsigned int firstInstance;
+	unsigned int instanceCount;
+};
+
+// --------------------------------------------------------
+// Sorts entities into instanced groups and those that still
+// draw one at a time
+// - A group needs MinGroupSize entities sharing a mesh and
+//   material with an instanced shader
+// --------------------------------------------------------
+namespace Instancing
+{
+	// Fewer entities than this gain little from an instanced draw
+	const size_t MinGroupSize = 2;
+
+	// For the camera's view: groups by mesh, material and the level of
+	// detail each entity would pick, leaving out every entity (grouped or
+	// single) whose bounding sphere is outside the camera's frustum, so
+	// the ones left are exactly those visible
+	void GroupForCamera(const DrawList& draws, std::shared_ptr<Camera> camera, ObjectCache& objects,
+		std::vector<InstanceGroup>& groups, std::vector<unsigned int>& instances, std::vector<unsigned int>& singles);
+
+	// For the shadow map: groups by mesh only, at full detail and without
+	// culling, as the shadow pass draws everything
+	void GroupForShadows(const DrawList& draws, ObjectCache& objects,
+		std::vector<InstanceGroup>& groups, std::vector<unsigned int>& instances, std::vector<unsigned int>& singles);
+}
+
+// --------------------------------------------------------
+// A dynamic vertex buffer holding a frame's instances (object
+// cache indices), bound to input slot 1
+//
+// - Refilled with WRITE_DISCARD each time, so it can be
+//   uploaded more than once a frame (once per pass)
+// - Grows to the largest upload it has seen
+// --------------------------------------------------------
+class InstanceBuffer
+{
+
+private:
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	unsigned int capacity;
+
+public:
+
+	// Constructor
+	InstanceBuffer();
+
+	// Copies the instances in and binds the buffer
+	void Upload(const std::vector<unsigned int>& instances);
+
+	// Getters for data
+	unsigned int GetCapacity();
+
+};
@@ -0,0 +1,228 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// One ParallelFor() call, shared by all of its jobs
+	struct Loop
+	{
+		void (*function)(void* context, size_t begin, size_t end);
+		void* context;
+		size_t grain;
+		std::atomic<size_t> remaining;	// Indices not yet run
+
+		std::mutex errorMutex;
+		std::exception_ptr error;
+	};
+
+	// A range of a loop's indices
+	struct Job
+	{
+		Loop* loop;
+		size_t begin;
+		size_t end;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	// Queue 0 belongs to every thread outside the pool; worker i uses queue i + 1
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	std::vector<std::thread> workers;
+	thread_local unsigned int queueIndex = 0;
+
+	// Sleeping workers wait for jobs to be queued
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	// Signed, since a job can be taken before Push() counts it,
+	// which briefly takes the count below zero
+	std::atomic<ptrdiff_t> queuedJobs = 0;
+	bool quitting = false;
+
+	void Push(const Job& job)
+	{
+		WorkQueue& queue = *queues[queueIndex];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.jobs.push_back(job);
+		}
+
+		// Counted under the sleep lock, so a worker can't check for
+		// work and then miss this wake-up before it starts waiting
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+			queuedJobs++;
+		}
+		wake.notify_one();
+	}
+
+	// --------------------------------------------------------
+	// Takes the newest job from this thread's own queue, or
+	// failing that the oldest job from someone else's
+	// --------------------------------------------------------
+	bool PopOrSteal(Job& job)
+	{
+		for (size_t i = 0; i < queues.size(); i++)
+		{
+			WorkQueue& queue = *queues[(queueIndex + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.jobs.empty())
+				continue;
+
+			if (i == 0)
+			{
+				job = queue.jobs.back();
+				queue.jobs.pop_back();
+			}
+			else
+			{
+				job = queue.jobs.front();
+				queue.jobs.pop_front();
+			}
+
+			queuedJobs--;
+			return true;
+		}
+
+		return false;
+	}
+
+	// --------------------------------------------------------
+	// Halves the job until it's no bigger than the grain,
+	// queueing each upper half, then runs what's left
+	// --------------------------------------------------------
+	void Execute(Job job)
+	{
+		Loop& loop = *job.loop;
+		while (job.end - job.begin > loop.grain)
+		{
+			size_t middle = job.begin + (job.end - job.begin) / 2;
+			Push({ job.loop, middle, job.end });
+			job.end = middle;
+		}
+
+		try
+		{
+			loop.function(loop.context, job.begin, job.end);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(loop.errorMutex);
+			if (!loop.error)
+				loop.error = std::current_exception();
+		}
+
+		// The loop may be gone as soon as this reaches zero
+		loop.remaining.fetch_sub(job.end - job.begin, std::memory_order_acq_rel);
+	}
+
+	void WorkerMain(unsigned int index)
+	{
+		queueIndex = index;
+
+		while (true)
+		{
+			Job job;
+			if (PopOrSteal(job))
+			{
+				Execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [] { return quitting || queuedJobs > 0; });
+			if (quitting)
+				return;
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Pool lifetime
+// --------------------------------------------------------
+void JobSystem::Initialize(unsigned int workerCount)
+{
+	Shutdown();
+
+	if (workerCount == 0)
+		workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+
+	queues.push_back(std::make_unique<WorkQueue>());
+	for (unsigned int i = 0; i < workerCount; i++)
+		queues.push_back(std::make_unique<WorkQueue>());
+
+	quitting = false;
+	for (unsigned int i = 0; i < workerCount; i++)
+		workers.emplace_back(WorkerMain, i + 1);
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		quitting = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	workers.clear();
+	queues.clear();
+	queuedJobs = 0;
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+	return (unsigned int)workers.size() + 1;
+}
+
+
+// --------------------------------------------------------
+// Starts the loop as one job on the calling thread, which
+// then keeps taking (or stealing) jobs until every index has
+// run, so it never sits idle waiting on the workers
+// --------------------------------------------------------
+void JobSystem::ParallelForRanges(size_t count, size_t grain, void (*function)(void* context, size_t begin, size_t end), void* context)
+{
+	if (count == 0)
+		return;
+
+	grain = std::max<size_t>(grain, 1);
+	if (workers.empty() || count <= grain)
+	{
+		function(context, 0, count);
+		return;
+	}
+
+	Loop loop;
+	loop.function = function;
+	loop.context = context;
+	loop.grain = grain;
+	loop.remaining = count;
+
+	Execute({ &loop, 0, count });
+	while (loop.remaining.load(std::memory_order_acquire) > 0)
+	{
+		Job job;
+		if (PopOrSteal(job))
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+
+	if (loop.error)
+		std::rethrow_exception(loop.error);
+}
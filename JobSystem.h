@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// A fixed pool of worker threads that share work by stealing
+// - The calling thread works on each loop too, and rethrows
+//   the first exception from the body
+// - Without workers loops simply run on the calling thread
+// --------------------------------------------------------
+namespace JobSystem
+{
+	// Starts the pool
+	// - workerCount 0 picks one worker per hardware thread, less
+	//   the one the caller runs on
+	// - Calling it again restarts the pool with the new count
+	void Initialize(unsigned int workerCount = 0);
+	void Shutdown();
+
+	// Threads that run a loop: the workers plus the caller
+	unsigned int GetThreadCount();
+
+	// Runs function(context, begin, end) over [0, count) in ranges
+	// of at most grain indices (see ParallelFor() below)
+	void ParallelForRanges(size_t count, size_t grain, void (*function)(void* context, size_t begin, size_t end), void* context);
+
+	// Runs body(begin, end) over [0, count) in ranges of at most grain
+	// indices, on as many threads as will help
+	// - Ranges run in no particular order, so the body must only
+	//   write what its own indices own
+	template<typename Body>
+	void ParallelFor(size_t count, size_t grain, Body body)
+	{
+		ParallelForRanges(count, grain,
+			[](void* context, size_t begin, size_t end) { (*(Body*)context)(begin, end); },
+			&body);
+	}
+}
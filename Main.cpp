@@ -6,6 +6,12 @@
 #include "Graphics.h"
 #include "Game.h"
 #include "Input.h"
+#include "SceneBenchmark.h"
+#include "SelfTest.h"
+#include "PathHelpers.h"
+
+#include <cstdio>
+#include <cstring>
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -50,6 +56,32 @@ int WINAPI WinMain(
 	printf("Console window created successfully.  Feel free to printf() here.\n");
 #endif
 
+	// "-test" checks the CPU-side code headless, exiting with the failure count
+	if (strstr(lpCmdLine, "-test"))
+	{
+#if !defined(DEBUG) && !defined(_DEBUG)
+		Window::CreateConsoleWindow(500, 120, 32, 120);
+#endif
+		int failures = SelfTest::Run(FixPath("../../Assets/Models/"));
+
+		printf("Press Enter to exit.\n");
+		getchar();
+		return failures;
+	}
+
+	// "-benchmark" times the scene work headless, with no window or device
+	if (strstr(lpCmdLine, "-benchmark"))
+	{
+#if !defined(DEBUG) && !defined(_DEBUG)
+		Window::CreateConsoleWindow(500, 120, 32, 120);
+#endif
+		SceneBenchmark::PrintAll();
+
+		printf("Press Enter to exit.\n");
+		getchar();
+		return 0;
+	}
+
 	// Set up app initialization details
 	unsigned int windowWidth = 1280;
 	unsigned int windowHeight = 720;
@@ -0,0 +1,109 @@
+#include "MappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char* filename)
+	: data(nullptr), size(0), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+{
+	// Open the file for reading only
+	fileHandle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	// Check for successful open
+	if (fileHandle == INVALID_HANDLE_VALUE)
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(fileHandle, &fileSize);
+	size = (size_t)fileSize.QuadPart;
+
+	// Empty files can't be mapped, so just leave the view empty
+	if (size == 0)
+		return;
+
+	// Map the whole file as read only
+	mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle)
+		data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		if (mappingHandle) CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		throw std::runtime_error("Error mapping file into memory");
+	}
+}
+
+MappedFile::~MappedFile()
+{
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const char* filename)
+	: data(nullptr), size(0), fileDescriptor(-1)
+{
+	// Open the file for reading only
+	fileDescriptor = open(filename, O_RDONLY);
+
+	// Check for successful open
+	if (fileDescriptor < 0)
+		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+	struct stat fileInfo = {};
+	fstat(fileDescriptor, &fileInfo);
+	size = (size_t)fileInfo.st_size;
+
+	// Empty files can't be mapped, so just leave the view empty
+	if (size == 0)
+		return;
+
+	// Map the whole file as read only
+	void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		throw std::runtime_error("Error mapping file into memory");
+	}
+
+	// We walk files front to back, so let the OS read ahead
+	madvise(view, size, MADV_SEQUENTIAL);
+	data = (const char*)view;
+}
+
+MappedFile::~MappedFile()
+{
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+}
+
+#endif
+
+
+//---------------
+// Getter Methods
+//---------------
+
+const char* MappedFile::GetData()
+{
+	return data;
+}
+
+size_t MappedFile::GetSize()
+{
+	return size;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only view of an entire file mapped into memory
+//
+// - The file's bytes can be read straight from GetData()
+//   without copying them into a buffer first
+// - The view stays valid until this object is destroyed
+// --------------------------------------------------------
+class MappedFile
+{
+
+private:
+
+	// Start and size of the mapped view
+	const char* data;
+	size_t size;
+
+	// OS handles for the open file and its mapping
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+
+	// Constructor
+	MappedFile(const char* filename);
+
+	// Destructor
+	~MappedFile();
+
+	// Mappings own OS handles, so they can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Getters for data
+	const char* GetData();
+	size_t GetSize();
+
+};
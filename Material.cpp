@@ -1,4 +1,5 @@
 #include "Material.h"
+#include <stdexcept>
 
 
 Material::Material(DirectX::XMFLOAT4 tint, std::shared_ptr<SimpleVertexShader> vertexShader, 
@@ -17,6 +18,7 @@ DirectX::XMFLOAT2 Material::Offset() { return offset; }
 float Material::DistortionStrength() { return distortionStrength; }
 float Material::Time() { return time; }
 std::shared_ptr<SimpleVertexShader> Material::VertexShader() { return vertexShader; }
+std::shared_ptr<SimpleVertexShader> Material::PackedVertexShader() { return packedVertexShader; }
 std::shared_ptr<SimplePixelShader> Material::PixelShader() { return pixelShader; }
 
 Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Material::GetTextureSRV()
@@ -35,6 +37,31 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Material::GetTextureSRV()
 
 std::string Material::ShaderName() { return shaderName; }
 
+// --------------------------------------------------------
+// The vertex shader that can read a mesh with the given layout,
+// either for regular or instanced draws
+//
+// - Throws if this material has no shader for that layout
+// --------------------------------------------------------
+std::shared_ptr<SimpleVertexShader> Material::VertexShaderFor(VertexLayout layout, bool instanced)
+{
+	std::shared_ptr<SimpleVertexShader> vs;
+	if (instanced)
+		vs = layout == VertexLayout::Packed ? packedInstancedVertexShader : instancedVertexShader;
+	else
+		vs = layout == VertexLayout::Packed ? packedVertexShader : vertexShader;
+
+	if (!vs)
+		throw std::logic_error("Material has no vertex shader for this vertex layout and draw type");
+
+	return vs;
+}
+
+bool Material::SupportsInstancing(VertexLayout layout)
+{
+	return (layout == VertexLayout::Packed ? packedInstancedVertexShader : instancedVertexShader) != nullptr;
+}
+
 
 //--------
 // Setters
@@ -45,6 +72,12 @@ void Material::SetOffset(DirectX::XMFLOAT2 o) { offset = o; }
 void Material::SetDistortionStrength(float distortion) { distortionStrength = distortion; }
 void Material::SetTime(float t) { time = t; }
 void Material::SetVertexShader(std::shared_ptr<SimpleVertexShader> vs) { vertexShader = vs; }
+void Material::SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> vs) { packedVertexShader = vs; }
+void Material::SetInstancedVertexShaders(std::shared_ptr<SimpleVertexShader> vs, std::shared_ptr<SimpleVertexShader> packedVS)
+{
+	instancedVertexShader = vs;
+	packedInstancedVertexShader = packedVS;
+}
 void Material::SetPixelShader(std::shared_ptr<SimplePixelShader> ps) { pixelShader = ps; }
 
 void Material::AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv)
@@ -61,17 +94,32 @@ void Material::AddSampler(std::string shaderVariableName, Microsoft::WRL::ComPtr
 }
 
 
-void Material::PrepareMaterial(std::shared_ptr<Camera> camera, std::shared_ptr<Transform> transform, float totalTime)
+// --------------------------------------------------------
+// Sets up a regular draw of one object
+//
+// - Its matrices are read from the object buffer at objectIndex
+//   (see ObjectCache), which the caller binds as "Objects"
+// --------------------------------------------------------
+void Material::PrepareMaterial(std::shared_ptr<Camera> camera, unsigned int objectIndex, Mesh* mesh, float totalTime)
 {
+	// Use whichever vertex shader can read this mesh's vertices
+	std::shared_ptr<SimpleVertexShader> vs = VertexShaderFor(mesh->GetVertexLayout());
 
-	vertexShader->SetShader();
+	vs->SetShader();
 	pixelShader->SetShader();
 
-	vertexShader->SetFloat4("colorTint", tint); // Strings here MUST
-	vertexShader->SetMatrix4x4("world", transform->GetWorldMatrix()); // match variable
-	vertexShader->SetMatrix4x4("view", camera->ViewMatrix()); // names in your
-	vertexShader->SetMatrix4x4("projection", camera->ProjectionMatrix()); // shaders cbuffer!
-	vertexShader->SetMatrix4x4("worldInvTranspose", transform->GetWorldInverseTranspose());
+	vs->SetFloat4("colorTint", tint); // Strings here MUST
+	vs->SetData("objectIndex", &objectIndex, sizeof(unsigned int)); // match variable
+	vs->SetMatrix4x4("view", camera->ViewMatrix()); // names in your
+	vs->SetMatrix4x4("projection", camera->ProjectionMatrix()); // shaders cbuffer!
+
+	// Packed positions are relative to the mesh's bounds
+	if (mesh->GetVertexLayout() == VertexLayout::Packed)
+	{
+		PositionQuantization quantization = mesh->GetPositionQuantization();
+		vs->SetFloat3("positionOffset", quantization.offset);
+		vs->SetFloat3("positionScale", quantization.scale);
+	}
 
 	pixelShader->SetFloat4("colorTint", tint);
 	pixelShader->SetFloat2("scale", scale);
@@ -81,7 +129,7 @@ void Material::PrepareMaterial(std::shared_ptr<Camera> camera, std::shared_ptr<T
 	pixelShader->SetFloat("roughness", roughness);
 	pixelShader->SetFloat3("cameraPosition", camera->GetTransform().GetPosition());
 	pixelShader->CopyAllBufferData();
-	vertexShader->CopyAllBufferData();
+	vs->CopyAllBufferData();
 
 	for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.first.c_str(), t.second); }
 	for (auto& s : samplers) { pixelShader->SetSamplerState(s.first.c_str(), s.second); }
@@ -90,3 +138,41 @@ void Material::PrepareMaterial(std::shared_ptr<Camera> camera, std::shared_ptr<T
 
 }
 
+// --------------------------------------------------------
+// Same as PrepareMaterial(), for an instanced draw
+//
+// - World matrices come from the instance buffer, so only the
+//   camera and material data are set here
+// --------------------------------------------------------
+void Material::PrepareMaterialInstanced(std::shared_ptr<Camera> camera, Mesh* mesh, float totalTime)
+{
+	std::shared_ptr<SimpleVertexShader> vs = VertexShaderFor(mesh->GetVertexLayout(), true);
+
+	vs->SetShader();
+	pixelShader->SetShader();
+
+	vs->SetMatrix4x4("view", camera->ViewMatrix());
+	vs->SetMatrix4x4("projection", camera->ProjectionMatrix());
+
+	// Packed positions are relative to the mesh's bounds
+	if (mesh->GetVertexLayout() == VertexLayout::Packed)
+	{
+		PositionQuantization quantization = mesh->GetPositionQuantization();
+		vs->SetFloat3("positionOffset", quantization.offset);
+		vs->SetFloat3("positionScale", quantization.scale);
+	}
+
+	pixelShader->SetFloat4("colorTint", tint);
+	pixelShader->SetFloat2("scale", scale);
+	pixelShader->SetFloat2("offset", offset);
+	pixelShader->SetFloat("distortionStrength", distortionStrength);
+	pixelShader->SetFloat("time", totalTime);
+	pixelShader->SetFloat("roughness", roughness);
+	pixelShader->SetFloat3("cameraPosition", camera->GetTransform().GetPosition());
+	pixelShader->CopyAllBufferData();
+	vs->CopyAllBufferData();
+
+	for (auto& t : textureSRVs) { pixelShader->SetShaderResourceView(t.first.c_str(), t.second); }
+	for (auto& s : samplers) { pixelShader->SetSamplerState(s.first.c_str(), s.second); }
+}
+
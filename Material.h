@@ -6,6 +6,7 @@
 #include <unordered_map>
 #include "Camera.h"
 #include "Transform.h"
+#include "Mesh.h"
 
 class Material
 {
@@ -17,6 +18,9 @@ private:
 	float time;
 	float roughness;
 	std::shared_ptr<SimpleVertexShader> vertexShader;
+	std::shared_ptr<SimpleVertexShader> packedVertexShader; // Optional, for meshes using PackedVertex
+	std::shared_ptr<SimpleVertexShader> instancedVertexShader; // Optional, for instanced draws
+	std::shared_ptr<SimpleVertexShader> packedInstancedVertexShader;
 	std::shared_ptr<SimplePixelShader> pixelShader;
 
 	std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> textureSRVs;
@@ -46,6 +50,9 @@ public:
 	float Time();
 	float Roughness();
 	std::shared_ptr<SimpleVertexShader> VertexShader();
+	std::shared_ptr<SimpleVertexShader> PackedVertexShader();
+	std::shared_ptr<SimpleVertexShader> VertexShaderFor(VertexLayout layout, bool instanced = false);
+	bool SupportsInstancing(VertexLayout layout);
 	std::shared_ptr<SimplePixelShader> PixelShader();
 	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTextureSRV();
 	std::string ShaderName();
@@ -61,6 +68,8 @@ public:
 	void SetTime(float time);
 	void SetRoughness(float roughness);
 	void SetVertexShader(std::shared_ptr<SimpleVertexShader> vertexShader);
+	void SetPackedVertexShader(std::shared_ptr<SimpleVertexShader> packedVertexShader);
+	void SetInstancedVertexShaders(std::shared_ptr<SimpleVertexShader> instancedVertexShader, std::shared_ptr<SimpleVertexShader> packedInstancedVertexShader);
 	void SetPixelShader(std::shared_ptr<SimplePixelShader> pixelShader);
 
 	//--------
@@ -68,6 +77,7 @@ public:
 	//--------
 	void AddTextureSRV(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv);
 	void AddSampler(std::string shaderVariableName, Microsoft::WRL::ComPtr<ID3D11SamplerState> sampler);
-	void PrepareMaterial(std::shared_ptr<Camera> camera, std::shared_ptr<Transform> transform, float deltaTime);
+	void PrepareMaterial(std::shared_ptr<Camera> camera, unsigned int objectIndex, Mesh* mesh, float deltaTime);
+	void PrepareMaterialInstanced(std::shared_ptr<Camera> camera, Mesh* mesh, float totalTime);
 
 };
\ No newline at end of file
@@ -1,225 +1,158 @@
 #include "Mesh.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshSimplifier.h"
+#include "Frustum.h"
+#include "ObjLoader.h"
+#include "Tangents.h"
+#include "Window.h"
+#include <algorithm>
+#include <filesystem>
 #include <memory>
-#include <fstream>
-#include <stdexcept>
 #include <vector>
 
 using namespace DirectX;
 
 
 
-Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount)
-	: vertexCount(vertexCount), indexCount(indexCount)
+// --------------------------------------------------------
+// Creates a mesh from vertices and indices in memory
+// - calculateTangents can be turned off for vertices whose
+//   tangents are already right, like a static batch's
+// --------------------------------------------------------
+Mesh::Mesh(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount, bool calculateTangents)
+	: vertexCount(vertexCount), indexCount(indexCount), overdraw(0), unoptimizedOverdraw(0),
+	vertexLayout(VertexLayout::Standard), packingError(), visibleMeshletCount(0), currentLod(0)
 {
+	XMFLOAT3 boundsMin, boundsMax;
+	VertexPacking::ComputeBounds(vertices, vertexCount, boundsMin, boundsMax);
+	positionQuantization = VertexPacking::QuantizationFromBounds(boundsMin, boundsMax);
+	localBounds = Aabb::FromMinMax(boundsMin, boundsMax);
+	boundingSphere = Sphere::FromVertices(vertices, vertexCount);
+
+	if (calculateTangents)
+		CalculateTangents(vertices, vertexCount, indices, indexCount);
 	CreateBuffers(vertices, vertexCount, indices, indexCount);
+	sourceVertices.assign(vertices, vertices + vertexCount);
+	sourceIndices.assign(indices, indices + indexCount);
+	meshlets = Meshlets::Build(vertices, vertexCount, indices, indexCount);
+	lods.push_back({ 0, (unsigned int)indexCount, 0.0f, 0.0f });
+
+	// Hand-built meshes are drawn exactly as given
+	vertexCacheStats = MeshOptimizer::AnalyzeVertexCache(indices, indexCount, vertexCount);
+	unoptimizedVertexCacheStats = vertexCacheStats;
 }
 
-Mesh::Mesh(const char* filename)
+// --------------------------------------------------------
+// Loads a mesh from an OBJ file, or from its mesh cache
+// - Packed layouts need a vertex shader taking
+//   VertexShaderInput_Packed
+// --------------------------------------------------------
+Mesh::Mesh(const char* filename, bool optimizeOverdraw, VertexLayout vertexLayout)
+	: overdraw(0), unoptimizedOverdraw(0), vertexLayout(vertexLayout), packingError(), visibleMeshletCount(0), currentLod(0)
 {
+	// Map the source file and hash it, which tells us
+	// whether a cache built from it is still valid
+	// - Throws if the file can't be opened
+	MappedFile source(filename);
+	uint64_t sourceHash = MeshCache::HashContents(source.GetData(), source.GetSize());
+
+	// Use the cached import if there is one, creating the
+	// buffers straight from the cache's mapped pages
+	uint32_t cacheFlags = optimizeOverdraw ? MeshCache::FlagOverdrawOptimized : 0;
+	std::string cachePath = MeshCache::CachePathFor(filename, cacheFlags);
+	if (std::filesystem::exists(cachePath))
+	{
+		MappedFile cache(cachePath.c_str());
+		const MeshCache::Header* header = MeshCache::Validate(cache.GetData(), cache.GetSize(), sourceHash, cacheFlags);
+		if (header && header->lodCount > 0)
+		{
+			const MeshLod* cachedLods = MeshCache::GetLods(header);
+			lods.assign(cachedLods, cachedLods + header->lodCount);
+
+			vertexCount = (int)header->vertexCount;
+			indexCount = (int)lods[0].indexCount;
+			positionQuantization = VertexPacking::QuantizationFromBounds(header->boundsMin, header->boundsMax);
+			localBounds = Aabb::FromMinMax(header->boundsMin, header->boundsMax);
+			boundingSphere = { header->sphereCenter, header->sphereRadius };
+			if (vertexLayout == VertexLayout::Packed)
+				packingError = VertexPacking::MeasureError(MeshCache::GetVertices(header), vertexCount, positionQuantization);
+
+			CreateBuffers(MeshCache::GetVertices(header), vertexCount, MeshCache::GetIndices(header), (int)header->indexCount);
+
+			sourceVertices.assign(MeshCache::GetVertices(header), MeshCache::GetVertices(header) + vertexCount);
+			sourceIndices.assign(MeshCache::GetIndices(header), MeshCache::GetIndices(header) + indexCount);
+
+			const Meshlet* cachedMeshlets = MeshCache::GetMeshlets(header);
+			meshlets.assign(cachedMeshlets, cachedMeshlets + header->meshletCount);
+
+			vertexCacheStats = MeshOptimizer::AnalyzeVertexCache(MeshCache::GetIndices(header), indexCount, vertexCount);
+			unoptimizedVertexCacheStats = vertexCacheStats;
+			unoptimizedVertexCacheStats.acmr = header->unoptimizedACMR;
+			unoptimizedVertexCacheStats.atvr = header->unoptimizedATVR;
+			overdraw = header->overdraw;
+			unoptimizedOverdraw = header->unoptimizedOverdraw;
+			return;
+		}
+	}
 
+	// No usable cache, so read the file into welded vertices and indices
+	MeshData data = ObjLoader::Parse(source.GetData(), source.GetSize());
 
-	// File input object
-	std::ifstream obj(filename);
+	// Reorder triangles for the post-transform vertex cache, then
+	// reorder vertices to match so fetches stay close together
+	unoptimizedVertexCacheStats = MeshOptimizer::AnalyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+	MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
 
-	// Check for successful open
-	if (!obj.is_open())
-		throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+	// Optionally give up a little of that to draw occluders first
+	if (optimizeOverdraw)
+	{
+		unoptimizedOverdraw = MeshOptimizer::AnalyzeOverdraw(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size()).overdraw;
+		MeshOptimizer::OptimizeOverdraw(data.indices, data.vertices);
+		overdraw = MeshOptimizer::AnalyzeOverdraw(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size()).overdraw;
+	}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;	// Positions from the file
-	std::vector<XMFLOAT3> normals;		// Normals from the file
-	std::vector<XMFLOAT2> uvs;		// UVs from the file
-	std::vector<Vertex> verts;		// Verts we're assembling
-	std::vector<UINT> indices;		// Indices of these verts
-	int vertCounter = 0;			// Count of vertices
-	int indexCounter = 0;			// Count of indices
-	char chars[100];			// String for line reading
+	// Simpler levels of detail go after the full detail indices,
+	// reusing its vertices
+	MeshSimplifier::BuildLodChain(data);
+	lods = data.lods;
 
-	// Still have data left?
-	while (obj.good())
-	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+	MeshOptimizer::OptimizeVertexFetch(data);
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
-		{
-			// Read the face indices into an array
-			// NOTE: This assumes the given obj file contains
-			//  vertex positions, uv coordinates AND normals.
-			unsigned int i[12];
-			int numbersRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// If we only got the first number, chances are the OBJ
-			// file has no UV coordinates.  This isn't great, but we
-			// still want to load the model without crashing, so we
-			// need to re-read a different pattern (in which we assume
-			// there are no UVs denoted for any of the vertices)
-			if (numbersRead == 1)
-			{
-				// Re-read with a different pattern
-				numbersRead = sscanf_s(
-					chars,
-					"f %d//%d %d//%d %d//%d %d//%d",
-					&i[0], &i[2],
-					&i[3], &i[5],
-					&i[6], &i[8],
-					&i[9], &i[11]);
-
-				// The following indices are where the UVs should 
-				// have been, so give them a valid value
-				i[1] = 1;
-				i[4] = 1;
-				i[7] = 1;
-				i[10] = 1;
-
-				// If we have no UVs, create a single UV coordinate
-				// that will be used for all vertices
-				if (uvs.size() == 0)
-					uvs.push_back(XMFLOAT2(0, 0));
-			}
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.uv = uvs[i[1] - 1];
-			v1.normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.uv = uvs[i[4] - 1];
-			v2.normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.uv = uvs[i[7] - 1];
-			v3.normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.uv.y = 1.0f - v1.uv.y;
-			v2.uv.y = 1.0f - v2.uv.y;
-			v3.uv.y = 1.0f - v3.uv.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal's Z
-			v1.normal.z *= -1.0f;
-			v2.normal.z *= -1.0f;
-			v3.normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-			vertCounter += 3;
-
-			// Add three more indices
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-			indices.push_back(indexCounter); indexCounter += 1;
-
-			// Was there a 4th face?
-			// - 12 numbers read means 4 faces WITH uv's
-			// - 8 numbers read means 4 faces WITHOUT uv's
-			if (numbersRead == 12 || numbersRead == 8)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.uv = uvs[i[10] - 1];
-				v4.normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal's Z
-				v4.uv.y = 1.0f - v4.uv.y;
-				v4.Position.z *= -1.0f;
-				v4.normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-				vertCounter += 3;
-
-				// Add three more indices
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-				indices.push_back(indexCounter); indexCounter += 1;
-			}
-		}
-	}
+	vertexCount = (int)data.vertices.size();
+	indexCount = (int)lods[0].indexCount;
+	vertexCacheStats = MeshOptimizer::AnalyzeVertexCache(data.indices.data(), indexCount, vertexCount);
 
-	// Close the file and create the actual buffers
-	obj.close();
+	CalculateTangents(data.vertices.data(), vertexCount, data.indices.data(), indexCount);
 
-	vertexCount = vertCounter;
-	indexCount = indexCounter;
+	// Split the full detail level into meshlets now that the index
+	// order won't change again
+	data.meshlets = Meshlets::Build(data.vertices.data(), data.vertices.size(), data.indices.data(), indexCount);
+	meshlets = data.meshlets;
 
-	CreateBuffers(&verts[0], vertCounter, &indices[0], indexCounter);
+	XMFLOAT3 boundsMin, boundsMax;
+	VertexPacking::ComputeBounds(data.vertices.data(), vertexCount, boundsMin, boundsMax);
+	positionQuantization = VertexPacking::QuantizationFromBounds(boundsMin, boundsMax);
+	if (vertexLayout == VertexLayout::Packed)
+		packingError = VertexPacking::MeasureError(data.vertices.data(), vertexCount, positionQuantization);
+
+	localBounds = Aabb::FromMinMax(boundsMin, boundsMax);
+	boundingSphere = Sphere::FromVertices(data.vertices.data(), vertexCount);
+
+	// Save the finished import so the next load can skip all of the above
+	MeshCache::Write(cachePath.c_str(), data, sourceHash, cacheFlags, unoptimizedVertexCacheStats, unoptimizedOverdraw, overdraw, boundingSphere);
+
+	CreateBuffers(data.vertices.data(), vertexCount, data.indices.data(), (int)data.indices.size());
+	sourceVertices = data.vertices;
+	sourceIndices.assign(data.indices.begin(), data.indices.begin() + indexCount);
 }
 
 // Destructor
 Mesh::~Mesh()
 {
-
+	// Hands this mesh's part of the pool back for reuse
+	if (pool)
+		pool->Free(allocation);
 }
 
 //---------------
@@ -228,12 +161,12 @@ Mesh::~Mesh()
 
 Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer()
 {
-	return vertexBuffer;
+	return pool->GetVertexBuffer();
 }
 
 Microsoft::WRL::ComPtr<ID3D11Buffer>  Mesh::GetIndexBuffer()
 {
-	return indexBuffer;
+	return pool->GetIndexBuffer();
 }
 
 int Mesh::GetIndexCount()
@@ -246,132 +179,321 @@ int Mesh::GetVertexCount()
 	return vertexCount;
 }
 
+VertexCacheStats Mesh::GetVertexCacheStats()
+{
+	return vertexCacheStats;
+}
+
+VertexCacheStats Mesh::GetUnoptimizedVertexCacheStats()
+{
+	return unoptimizedVertexCacheStats;
+}
+
+float Mesh::GetOverdraw()
+{
+	return overdraw;
+}
+
+float Mesh::GetUnoptimizedOverdraw()
+{
+	return unoptimizedOverdraw;
+}
+
+VertexLayout Mesh::GetVertexLayout()
+{
+	return vertexLayout;
+}
+
+PositionQuantization Mesh::GetPositionQuantization()
+{
+	return positionQuantization;
+}
+
+PackingError Mesh::GetPackingError()
+{
+	return packingError;
+}
+
+int Mesh::GetVertexStride()
+{
+	return (int)VertexPacking::StrideOf(vertexLayout);
+}
+
+DXGI_FORMAT Mesh::GetIndexFormat()
+{
+	return indexFormat;
+}
+
+int Mesh::GetIndexStride()
+{
+	return indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(unsigned short) : sizeof(unsigned int);
+}
+
+int Mesh::GetVertexBufferSize()
+{
+	return vertexBufferSize;
+}
+
+int Mesh::GetIndexBufferSize()
+{
+	return indexBufferSize;
+}
+
+std::shared_ptr<GeometryPool> Mesh::GetPool()
+{
+	return pool;
+}
+
+int Mesh::GetBaseVertex()
+{
+	return (int)allocation.baseVertex;
+}
+
+int Mesh::GetStartIndex()
+{
+	return (int)allocation.startIndex;
+}
+
+const std::vector<Meshlet>& Mesh::GetMeshlets()
+{
+	return meshlets;
+}
+
+int Mesh::GetVisibleMeshletCount()
+{
+	return visibleMeshletCount;
+}
+
+const std::vector<MeshLod>& Mesh::GetLods()
+{
+	return lods;
+}
+
+const std::vector<Vertex>& Mesh::GetSourceVertices()
+{
+	return sourceVertices;
+}
+
+const std::vector<unsigned int>& Mesh::GetSourceIndices()
+{
+	return sourceIndices;
+}
+
+int Mesh::GetCurrentLod()
+{
+	return currentLod;
+}
+
+Aabb Mesh::GetBounds()
+{
+	return localBounds;
+}
+
+Sphere Mesh::GetBoundingSphere()
+{
+	return boundingSphere;
+}
+
+Aabb Mesh::GetWorldBounds(const XMFLOAT4X4& world)
+{
+	return localBounds.Transform(world);
+}
+
+Sphere Mesh::GetWorldSphere(const XMFLOAT4X4& world)
+{
+	return boundingSphere.Transform(world);
+}
+
 //--------
 // Methods
 //--------
 
+// --------------------------------------------------------
+// Picks the coarsest level of detail whose error covers at
+// most MaxLodPixelError pixels on screen
+// --------------------------------------------------------
+int Mesh::SelectLod(const XMFLOAT4X4& world, std::shared_ptr<Camera> camera)
+{
+	Sphere worldSphere = GetWorldSphere(world);
+	XMFLOAT3 cameraPosition = camera->GetTransform().GetPosition();
+	XMVECTOR offset = XMLoadFloat3(&worldSphere.center) - XMLoadFloat3(&cameraPosition);
+	float distance = XMVectorGetX(XMVector3Length(offset)) - worldSphere.radius;
+	if (distance <= 0.0f)
+		return 0;
+
+	float worldScale = Bounds::MaxScale(world);
+
+	// How many pixels one world unit covers at that distance
+	XMFLOAT4X4 projection = camera->ProjectionMatrix();
+	float pixelsPerUnit = projection._22 * Window::Height() * 0.5f / distance;
+
+	int lod = 0;
+	for (int i = 1; i < (int)lods.size(); i++)
+	{
+		if (lods[i].hausdorffError * worldScale * pixelsPerUnit > MaxLodPixelError)
+			break;
+
+		lod = i;
+	}
+
+	return lod;
+}
+
+void Mesh::SetBuffers()
+{
+	// Every mesh in the same pool shares these buffers, so
+	// this only does anything when the pool changes
+	pool->Bind();
+}
+
 void Mesh::Draw()
 {
-	// Set buffers in the input assembler
-	UINT stride = sizeof(Vertex);
-	UINT offset = 0;
-	Graphics::Context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	Graphics::Context->IASetIndexBuffer(indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+	SetBuffers();
 
-	// Have DirectX draw 
+	// Have DirectX draw this mesh's part of the pool
 	Graphics::Context->DrawIndexed(
 		indexCount,
-		0,     
-		0);    
+		allocation.startIndex,
+		allocation.baseVertex);
 }
 
-
-void Mesh::CreateBuffers(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount)
+// --------------------------------------------------------
+// Draws only the meshlets that might be visible to a camera,
+// with one call per run of visible meshlets
+// --------------------------------------------------------
+void Mesh::DrawCulled(const XMFLOAT4X4& world, std::shared_ptr<Camera> camera)
 {
+	// Frustum planes and camera position in this mesh's local space
+	XMFLOAT4X4 view = camera->ViewMatrix();
+	XMFLOAT4X4 projection = camera->ProjectionMatrix();
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+
+	XMFLOAT4X4 worldViewProjection;
+	XMStoreFloat4x4(&worldViewProjection, worldMatrix * XMLoadFloat4x4(&view) * XMLoadFloat4x4(&projection));
+	Frustum frustum = Frustum::FromMatrix(worldViewProjection);
 
-	CalculateTangents(vertices, vertexCount, indices, indexCount);
+	XMFLOAT3 cameraPosition = camera->GetTransform().GetPosition();
+	XMFLOAT3 localCameraPosition;
+	XMStoreFloat3(&localCameraPosition, XMVector3TransformCoord(
+		XMLoadFloat3(&cameraPosition),
+		XMMatrixInverse(nullptr, worldMatrix)));
 
-	// Creating the vertex buffer
-	D3D11_BUFFER_DESC vbd = {};
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * vertexCount;
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
+	// Cones are only trusted in local space when the world
+	// matrix doesn't stretch, shear or mirror the mesh
+	bool cullCones = Meshlets::ConesHoldUnder(world);
 
-	// Creating the struct with the initial data for the vertex buffer
-	D3D11_SUBRESOURCE_DATA initialVertexData = {};
-	initialVertexData.pSysMem = vertices;
+	currentLod = 0;
+	visibleMeshletCount = 0;
 
-	// Create Vertex Buffer with the initail data
-	Graphics::Device->CreateBuffer(&vbd, &initialVertexData, vertexBuffer.GetAddressOf());
+	// Skip the whole mesh when its sphere is outside the frustum
+	if (!frustum.IntersectsSphere(boundingSphere.center, boundingSphere.radius))
+		return;
 
+	SetBuffers();
+
+	unsigned int runStart = 0;
+	unsigned int runLength = 0;
+	for (const Meshlet& meshlet : meshlets)
+	{
+		bool visible =
+			frustum.IntersectsSphere(meshlet.center, meshlet.radius) &&
+			!(cullCones && Meshlets::IsBackfacing(meshlet, localCameraPosition));
 
-	// Creating the Index Buffer
-	D3D11_BUFFER_DESC ibd = {};
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * indexCount;
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
+		if (visible)
+		{
+			if (runLength == 0)
+				runStart = meshlet.indexOffset;
 
-	// Creating the struct with the initial data for the index buffer
-	D3D11_SUBRESOURCE_DATA initialIndexData = {};
-	initialIndexData.pSysMem = indices;
+			runLength += meshlet.triangleCount * 3;
+			visibleMeshletCount++;
+		}
+		else if (runLength > 0)
+		{
+			Graphics::Context->DrawIndexed(runLength, allocation.startIndex + runStart, allocation.baseVertex);
+			runLength = 0;
+		}
+	}
 
-	// Create index buffer with the initial data
-	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, indexBuffer.GetAddressOf());
+	if (runLength > 0)
+		Graphics::Context->DrawIndexed(runLength, allocation.startIndex + runStart, allocation.baseVertex);
 }
 
 // --------------------------------------------------------
-// Calculates the tangents of the vertices in a mesh
-// - Code originally adapted from: http://www.terathon.com/code/tangent.html
-// - Updated version found here: http://foundationsofgameenginedev.com/FGED2-sample.pdf
-// - See listing 7.4 in section 7.5 (page 9 of the PDF)
-//
-// - Note: For this code to work, your Vertex format must
-// contain an XMFLOAT3 called Tangent
+// Draws a whole level of detail (see SelectLod())
 //
-// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+// - Meshlets only cover the full detail level, so this skips
+//   culling, which matters least for distant, simple levels
 // --------------------------------------------------------
-void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+void Mesh::DrawLod(int lod)
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		verts[i].tangent = XMFLOAT3(0, 0, 0);
-	}
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numIndices;)
+	lod = std::clamp(lod, 0, (int)lods.size() - 1);
+
+	SetBuffers();
+	currentLod = lod;
+	Graphics::Context->DrawIndexed(lods[lod].indexCount, allocation.startIndex + lods[lod].indexOffset, allocation.baseVertex);
+}
+
+// --------------------------------------------------------
+// Draws a level of detail once per instance, with per-instance
+// data read from whatever buffer is bound to input slot 1
+// (see InstanceBuffer)
+// --------------------------------------------------------
+void Mesh::DrawInstanced(int lod, unsigned int instanceCount, unsigned int firstInstance)
+{
+	lod = std::clamp(lod, 0, (int)lods.size() - 1);
+
+	SetBuffers();
+	currentLod = lod;
+	Graphics::Context->DrawIndexedInstanced(
+		lods[lod].indexCount,
+		instanceCount,
+		allocation.startIndex + lods[lod].indexOffset,
+		allocation.baseVertex,
+		firstInstance);
+}
+
+void Mesh::CreateBuffers(const Vertex* vertices, int vertexCount, const unsigned int* indices, int indexCount)
+{
+	// Packed meshes are quantized on their way to the GPU
+	const void* vertexData = vertices;
+	std::vector<PackedVertex> packedVertices;
+	if (vertexLayout == VertexLayout::Packed)
 	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indices[i++];
-		unsigned int i2 = indices[i++];
-		unsigned int i3 = indices[i++];
-		Vertex* v1 = &verts[i1];
-		Vertex* v2 = &verts[i2];
-		Vertex* v3 = &verts[i3];
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->uv.x - v1->uv.x;
-		float t1 = v2->uv.y - v1->uv.y;
-		float s2 = v3->uv.x - v1->uv.x;
-		float t2 = v3->uv.y - v1->uv.y;
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-		// Adjust tangents of each vert of the triangle
-		v1->tangent.x += tx;
-		v1->tangent.y += ty;
-		v1->tangent.z += tz;
-		v2->tangent.x += tx;
-		v2->tangent.y += ty;
-		v2->tangent.z += tz;
-		v3->tangent.x += tx;
-		v3->tangent.y += ty;
-		v3->tangent.z += tz;
+		packedVertices = VertexPacking::PackAll(vertices, vertexCount, positionQuantization);
+		vertexData = packedVertices.data();
 	}
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
+
+	// Most meshes have few enough vertices for 16-bit indices,
+	// which halves the size of the index buffer
+	// - 0xFFFF itself is left unused, as it's the strip cut value
+	const void* indexData = indices;
+	std::vector<unsigned short> shortIndices;
+	indexFormat = vertexCount <= 0xFFFF ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	if (indexFormat == DXGI_FORMAT_R16_UINT)
 	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&verts[i].normal);
-		XMVECTOR tangent = XMLoadFloat3(&verts[i].tangent);
-		// Use Gram-Schmidt orthonormalize to ensure
-		// the normal and tangent are exactly 90 degrees apart
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
-		// Store the tangent
-		XMStoreFloat3(&verts[i].tangent, tangent);
+		shortIndices.resize(indexCount);
+		for (int i = 0; i < indexCount; i++)
+			shortIndices[i] = (unsigned short)indices[i];
+
+		indexData = shortIndices.data();
 	}
+
+	vertexBufferSize = GetVertexStride() * vertexCount;
+	indexBufferSize = GetIndexStride() * indexCount;
+
+	// Copy both into the shared pool for this vertex layout and index format
+	pool = GeometryPool::For(vertexLayout, indexFormat);
+	allocation = pool->Allocate(vertexData, vertexCount, indexData, indexCount);
+}
+
+// --------------------------------------------------------
+// Calculates the tangents of the vertices in a mesh
+// - See Tangents::Calculate() for how
+//
+// - Be sure to call this BEFORE creating your D3D vertex/index buffers
+//   (meshes loaded from a MeshCache already have their tangents)
+// --------------------------------------------------------
+void Mesh::CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices)
+{
+	Tangents::Calculate(verts, numVerts, indices, numIndices);
 }
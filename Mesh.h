@@ -2,44 +2,140 @@
 
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <memory>
+#include <vector>
+#include "Bounds.h"
+#include "Camera.h"
+#include "GeometryPool.h"
 #include "Graphics.h"
+#include "MeshData.h"
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
 #include "Vertex.h"
+#include "VertexPacking.h"
 
 class Mesh
 {
 
 private:
 
-	// Buffers
-	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	// The shared buffers holding this mesh, and where in them it is
+	std::shared_ptr<GeometryPool> pool;
+	GeometryPool::Allocation allocation;
 
 	//Index and vertex count
 	int indexCount;
 	int vertexCount;
 
-	// Helper method to create buffers from vertex and index data
-	void CreateBuffers(Vertex* vertices, int vertexCount, unsigned int* indices, int indexCount);
+	// Index buffer format (16-bit whenever every index fits) and the
+	// sizes of this mesh's parts of the pool's buffers, in bytes
+	DXGI_FORMAT indexFormat;
+	int vertexBufferSize;
+	int indexBufferSize;
+
+	// How well the index buffer uses the vertex cache, now and as imported
+	VertexCacheStats vertexCacheStats;
+	VertexCacheStats unoptimizedVertexCacheStats;
+
+	// Which vertex format the vertex buffer holds, and for packed
+	// meshes how to turn positions back into local space
+	VertexLayout vertexLayout;
+	PositionQuantization positionQuantization;
+	PackingError packingError;
+
+	// Clusters of triangles that can be culled individually, and
+	// how many survived culling the last time this mesh was drawn
+	std::vector<Meshlet> meshlets;
+	int visibleMeshletCount;
+
+	// Levels of detail sharing the buffers (level 0 is the full mesh),
+	// and which one was used the last time this mesh was drawn
+	std::vector<MeshLod> lods;
+	int currentLod;
+
+	// Local space bounds of the vertices: a box and the
+	// smallest sphere around them
+	Aabb localBounds;
+	Sphere boundingSphere;
+
+	// Full precision copy of the full detail level, kept on the CPU
+	// so static batching can merge it with other meshes
+	std::vector<Vertex> sourceVertices;
+	std::vector<unsigned int> sourceIndices;
+
+	// Estimated overdraw before and after OptimizeOverdraw (0 if it didn't run)
+	float overdraw;
+	float unoptimizedOverdraw;
+
+	// Helper method to copy vertex and index data into a geometry pool
+	void CreateBuffers(const Vertex* vertices, int vertexCount, const unsigned int* indices, int indexCount);
+
+	// Binds the pool's buffers to the input assembler (if they aren't already)
+	void SetBuffers();
 
 	// Calculates the tangents of the vertices in a mesh
 	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 	
 public:
 
+	// How far (in pixels) a level of detail's surface may stray from the
+	// full detail mesh before a finer level is used instead
+	static constexpr float MaxLodPixelError = 1.0f;
+
 	// Constructor
-	Mesh(Vertex *vertices, int vertexCount, unsigned int* indices, int indexCount);
-	Mesh(const char* filename);
+	Mesh(Vertex *vertices, int vertexCount, unsigned int* indices, int indexCount, bool calculateTangents = true);
+	Mesh(const char* filename, bool optimizeOverdraw = false, VertexLayout vertexLayout = VertexLayout::Standard);
 
 	// Destructor
 	~Mesh();
 
+	// Meshes own their part of the geometry pool, so they can't be copied
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
 	// Getters for data
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer();
 	Microsoft::WRL::ComPtr<ID3D11Buffer>  GetIndexBuffer();
 	int GetIndexCount();
 	int GetVertexCount();
+	VertexCacheStats GetVertexCacheStats();
+	VertexCacheStats GetUnoptimizedVertexCacheStats();
+	float GetOverdraw();
+	float GetUnoptimizedOverdraw();
+	VertexLayout GetVertexLayout();
+	PositionQuantization GetPositionQuantization();
+	PackingError GetPackingError();
+	int GetVertexStride();
+	DXGI_FORMAT GetIndexFormat();
+	int GetIndexStride();
+	int GetVertexBufferSize();
+	int GetIndexBufferSize();
+	std::shared_ptr<GeometryPool> GetPool();
+	int GetBaseVertex();
+	int GetStartIndex();
+	const std::vector<Meshlet>& GetMeshlets();
+	int GetVisibleMeshletCount();
+	const std::vector<MeshLod>& GetLods();
+	const std::vector<Vertex>& GetSourceVertices();
+	const std::vector<unsigned int>& GetSourceIndices();
+	int GetCurrentLod();
+	Aabb GetBounds();
+	Sphere GetBoundingSphere();
+
+	// Bounds in world space, given the mesh's world matrix
+	// - Cheaper than transforming every vertex, and never smaller
+	//   than the transformed mesh
+	Aabb GetWorldBounds(const DirectX::XMFLOAT4X4& world);
+	Sphere GetWorldSphere(const DirectX::XMFLOAT4X4& world);
+
+	// Picks the coarsest level of detail that looks the same as the
+	// full mesh from the camera, given the mesh's world matrix
+	int SelectLod(const DirectX::XMFLOAT4X4& world, std::shared_ptr<Camera> camera);
 
-	// Method for drawing
+	// Methods for drawing
 	void Draw();
+	void DrawCulled(const DirectX::XMFLOAT4X4& world, std::shared_ptr<Camera> camera);
+	void DrawLod(int lod);
+	void DrawInstanced(int lod, unsigned int instanceCount, unsigned int firstInstance);
 
 };
\ No newline at end of file
@@ -0,0 +1,150 @@
+#include "MeshCache.h"
+#include "VertexPacking.h"
+#include <cstring>
+#include <fstream>
+
+// The header is written and read as raw bytes, so its size must never change silently
+static_assert(sizeof(MeshCache::Header) == 104, "MeshCache::Header layout changed, bump MeshCache::Version");
+
+
+// --------------------------------------------------------
+// Hashes the contents of a file so we can tell when it changes
+//
+// - FNV-1a, but consuming 8 bytes at a time so hashing even
+//   large files costs far less than parsing them
+// --------------------------------------------------------
+uint64_t MeshCache::HashContents(const char* data, size_t size)
+{
+	const uint64_t prime = 1099511628211ull;
+	uint64_t hash = 14695981039346656037ull;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * prime;
+	}
+
+	// Any leftover bytes
+	for (; i < size; i++)
+		hash = (hash ^ (unsigned char)data[i]) * prime;
+
+	// Mix in the size and scramble the high bits back down
+	hash ^= size;
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// --------------------------------------------------------
+// Where the cache for a source file lives (right next to it)
+// - Each set of import flags gets its own file, so loading
+//   both variants doesn't rebuild them in turn
+// --------------------------------------------------------
+std::string MeshCache::CachePathFor(const char* sourceFile, uint32_t flags)
+{
+	std::string path = sourceFile;
+	if (flags != 0)
+		path += "." + std::to_string(flags);
+	return path + ".meshcache";
+}
+
+// --------------------------------------------------------
+// Checks that mapped bytes hold a complete cache that was
+// built from a source file with the given hash, using the
+// given optional import stages
+//
+// Returns the header if so, or nullptr if the cache is stale
+// --------------------------------------------------------
+const MeshCache::Header* MeshCache::Validate(const char* data, size_t size, uint64_t sourceHash, uint32_t flags)
+{
+	if (!data || size < sizeof(Header))
+		return nullptr;
+
+	const Header* header = (const Header*)data;
+	if (header->magic != Magic ||
+		header->version != Version ||
+		header->vertexLayout != (uint32_t)VertexLayout::Standard ||
+		header->vertexStride != sizeof(Vertex) ||
+		header->sourceHash != sourceHash ||
+		header->flags != flags)
+		return nullptr;
+
+	// Make sure the file wasn't cut short
+	size_t expectedSize = sizeof(Header) +
+		(size_t)header->vertexCount * header->vertexStride +
+		(size_t)header->indexCount * sizeof(unsigned int) +
+		(size_t)header->meshletCount * sizeof(Meshlet) +
+		(size_t)header->lodCount * sizeof(MeshLod);
+	if (size != expectedSize)
+		return nullptr;
+
+	return header;
+}
+
+// Vertices start right after the header
+const Vertex* MeshCache::GetVertices(const Header* header)
+{
+	return (const Vertex*)(header + 1);
+}
+
+// Indices start right after the vertices
+const unsigned int* MeshCache::GetIndices(const Header* header)
+{
+	return (const unsigned int*)(GetVertices(header) + header->vertexCount);
+}
+
+// Meshlets start right after the indices
+const Meshlet* MeshCache::GetMeshlets(const Header* header)
+{
+	return (const Meshlet*)(GetIndices(header) + header->indexCount);
+}
+
+// Levels of detail start right after the meshlets
+const MeshLod* MeshCache::GetLods(const Header* header)
+{
+	return (const MeshLod*)(GetMeshlets(header) + header->meshletCount);
+}
+
+// --------------------------------------------------------
+// Writes a cache file for imported mesh data
+//
+// Returns false if the file couldn't be written, in which
+// case the mesh will simply be imported again next time
+// --------------------------------------------------------
+bool MeshCache::Write(const char* cacheFile, const MeshData& data, uint64_t sourceHash, uint32_t flags, const VertexCacheStats& unoptimizedStats, float unoptimizedOverdraw, float overdraw, const Sphere& boundingSphere)
+{
+	Header header = {};
+	header.magic = Magic;
+	header.version = Version;
+	header.vertexLayout = (uint32_t)VertexLayout::Standard;
+	header.vertexStride = sizeof(Vertex);
+	header.vertexCount = (uint32_t)data.vertices.size();
+	header.indexCount = (uint32_t)data.indices.size();
+	header.meshletCount = (uint32_t)data.meshlets.size();
+	header.lodCount = (uint32_t)data.lods.size();
+	header.sourceHash = sourceHash;
+	header.unoptimizedACMR = unoptimizedStats.acmr;
+	header.unoptimizedATVR = unoptimizedStats.atvr;
+	header.flags = flags;
+	header.unoptimizedOverdraw = unoptimizedOverdraw;
+	header.overdraw = overdraw;
+	header.sphereCenter = boundingSphere.center;
+	header.sphereRadius = boundingSphere.radius;
+
+	// Local space bounds of all the vertices
+	VertexPacking::ComputeBounds(data.vertices.data(), data.vertices.size(), header.boundsMin, header.boundsMax);
+
+	std::ofstream file(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	file.write((const char*)&header, sizeof(Header));
+	file.write((const char*)data.vertices.data(), data.vertices.size() * sizeof(Vertex));
+	file.write((const char*)data.indices.data(), data.indices.size() * sizeof(unsigned int));
+	file.write((const char*)data.meshlets.data(), data.meshlets.size() * sizeof(Meshlet));
+	file.write((const char*)data.lods.data(), data.lods.size() * sizeof(MeshLod));
+	return file.good();
+}
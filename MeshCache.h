@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <DirectXMath.h>
+#include "Bounds.h"
+#include "MeshData.h"
+#include "MeshOptimizer.h"
+
+// --------------------------------------------------------
+// Binary cache of fully imported meshes, re-imported only
+// when the source file's contents change
+//
+// File layout: Header, vertices, indices (every level of
+// detail), meshlets, then levels of detail
+// --------------------------------------------------------
+namespace MeshCache
+{
+	// Identifies cache files ("MESH" when read as bytes)
+	const uint32_t Magic = 0x4853454D;
+
+	// Bump whenever the importer's output changes so old caches get rebuilt
+	const uint32_t Version = 6;
+
+	// Bits for Header::flags, recording which optional import stages ran
+	const uint32_t FlagOverdrawOptimized = 1 << 0;
+
+	// Fixed-size header at the start of every cache file
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexLayout;		// VertexLayout of the vertex array
+		uint32_t vertexStride;		// Size of one vertex in bytes
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint64_t sourceHash;		// HashContents() of the source file
+		DirectX::XMFLOAT3 boundsMin;	// Local space bounds of the vertices
+		DirectX::XMFLOAT3 boundsMax;
+		DirectX::XMFLOAT3 sphereCenter;	// Smallest bounding sphere of the vertices
+		float sphereRadius;
+		float unoptimizedACMR;		// Vertex cache stats of the indices as they were
+		float unoptimizedATVR;		// in the source file, before optimization
+		uint32_t flags;				// Flag* bits for the import stages that ran
+		float unoptimizedOverdraw;	// Overdraw before and after OptimizeOverdraw,
+		float overdraw;				// or 0 if that stage didn't run
+		uint32_t meshletCount;
+		uint32_t lodCount;
+		uint32_t reserved;			// Keeps the header a multiple of 8 bytes
+	};
+
+	// Helpers for naming and checking caches
+	uint64_t HashContents(const char* data, size_t size);
+	std::string CachePathFor(const char* sourceFile, uint32_t flags);
+
+	// Reading a mapped cache
+	const Header* Validate(const char* data, size_t size, uint64_t sourceHash, uint32_t flags);
+	const Vertex* GetVertices(const Header* header);
+	const unsigned int* GetIndices(const Header* header);
+	const Meshlet* GetMeshlets(const Header* header);
+	const MeshLod* GetLods(const Header* header);
+
+	// Writing a new cache
+	bool Write(const char* cacheFile, const MeshData& data, uint64_t sourceHash, uint32_t flags, const VertexCacheStats& unoptimizedStats, float unoptimizedOverdraw, float overdraw, const Sphere& boundingSphere);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include "Vertex.h"
+#include "Meshlets.h"
+
+// --------------------------------------------------------
+// One level of detail: a run of the mesh's index buffer and
+// how far it strays from the full detail mesh
+//
+// - Stored as raw bytes in the mesh cache
+// --------------------------------------------------------
+struct MeshLod
+{
+	unsigned int indexOffset;
+	unsigned int indexCount;
+	float error;			// Quadric error estimate, in local space units
+	float hausdorffError;	// Measured distance between the surfaces, in local space units
+};
+
+// --------------------------------------------------------
+// CPU-side geometry for a single mesh, as produced by the
+// importers before it's uploaded into D3D buffers
+// --------------------------------------------------------
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<Meshlet> meshlets;	// Filled in once the index order is final
+	std::vector<MeshLod> lods;		// Level 0 is the full detail mesh, if there are any
+};
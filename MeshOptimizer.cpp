@@ -0,0 +1,500 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Tuning values from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	// - https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	const int ForsythCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// Scores how much we'd like to use a vertex next, based on
+	// where it sits in the cache and how many triangles still need it
+	float VertexScore(int cachePosition, unsigned int remainingTriangles)
+	{
+		// Nothing left to draw with this vertex
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			// The last triangle's vertices get a fixed score so we don't
+			// just keep drawing strips, older entries decay with age
+			if (cachePosition < 3)
+			{
+				score = LastTriangleScore;
+			}
+			else
+			{
+				float scale = 1.0f / (ForsythCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scale, CacheDecayPower);
+			}
+		}
+
+		// Boost vertices with few triangles left, so we finish them
+		// off instead of leaving lone triangles scattered about
+		score += ValenceBoostScale * powf((float)remainingTriangles, -ValenceBoostPower);
+		return score;
+	}
+}
+
+
+// --------------------------------------------------------
+// Reorders triangles for the post-transform vertex cache
+//
+// - Greedily emits the highest scoring triangle, where a
+//   triangle's score is the sum of its vertices' scores
+// - Only triangles touching the cache are rescored after each
+//   step, which keeps this roughly linear in triangle count
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Build the list of triangles using each vertex
+	std::vector<unsigned int> remainingTriangles(vertexCount, 0);
+	for (unsigned int index : indices)
+		remainingTriangles[index]++;
+
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fillCounts(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			adjacency[adjacencyOffsets[v] + fillCounts[v]++] = (unsigned int)t;
+		}
+	}
+
+	// Starting scores for every vertex and triangle
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> triangleEmitted(triangleCount, false);
+	int bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] =
+			vertexScores[indices[t * 3 + 0]] +
+			vertexScores[indices[t * 3 + 1]] +
+			vertexScores[indices[t * 3 + 2]];
+
+		if (triangleScores[t] > triangleScores[bestTriangle])
+			bestTriangle = (int)t;
+	}
+
+	// The simulated cache, with room for a triangle's worth of overflow
+	std::vector<unsigned int> cache;
+	std::vector<unsigned int> newCache;
+	cache.reserve(ForsythCacheSize + 3);
+	newCache.reserve(ForsythCacheSize + 3);
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	size_t nextUnemitted = 0;
+
+	for (size_t emitted = 0; emitted < triangleCount; emitted++)
+	{
+		// Nothing in the cache is useful, so fall back to the next triangle in order
+		if (bestTriangle < 0)
+		{
+			while (triangleEmitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = (int)nextUnemitted;
+		}
+
+		// Emit the triangle
+		triangleEmitted[bestTriangle] = true;
+		const unsigned int* triangle = &indices[bestTriangle * 3];
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = triangle[c];
+			output.push_back(v);
+
+			// Take the triangle out of this vertex's remaining list
+			unsigned int begin = adjacencyOffsets[v];
+			unsigned int end = begin + remainingTriangles[v];
+			for (unsigned int a = begin; a < end; a++)
+			{
+				if (adjacency[a] == (unsigned int)bestTriangle)
+				{
+					adjacency[a] = adjacency[end - 1];
+					break;
+				}
+			}
+			remainingTriangles[v]--;
+		}
+
+		// The new triangle's vertices move to the front of the cache
+		newCache.clear();
+		newCache.insert(newCache.end(), triangle, triangle + 3);
+		for (unsigned int v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache.push_back(v);
+		}
+		cache.swap(newCache);
+
+		// Rescore every vertex that's in (or just fell out of) the cache
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			unsigned int v = cache[i];
+			cachePositions[v] = i < (size_t)ForsythCacheSize ? (int)i : -1;
+			vertexScores[v] = VertexScore(cachePositions[v], remainingTriangles[v]);
+		}
+
+		// Rescore their triangles, looking for the best one to emit next
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (unsigned int v : cache)
+		{
+			unsigned int begin = adjacencyOffsets[v];
+			unsigned int end = begin + remainingTriangles[v];
+			for (unsigned int a = begin; a < end; a++)
+			{
+				unsigned int t = adjacency[a];
+				triangleScores[t] =
+					vertexScores[indices[t * 3 + 0]] +
+					vertexScores[indices[t * 3 + 1]] +
+					vertexScores[indices[t * 3 + 2]];
+
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = (int)t;
+				}
+			}
+		}
+
+		// Drop the overflow now that it's been rescored
+		if (cache.size() > (size_t)ForsythCacheSize)
+			cache.resize(ForsythCacheSize);
+	}
+
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Reorders vertices so they're stored in the order the index
+// buffer first touches them, which keeps vertex fetches close
+// together in memory
+//
+// - Vertices that no triangle uses are dropped
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeVertexFetch(MeshData& data)
+{
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> remap(data.vertices.size(), unused);
+
+	std::vector<Vertex> vertices;
+	vertices.reserve(data.vertices.size());
+
+	for (unsigned int& index : data.indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (unsigned int)vertices.size();
+			vertices.push_back(data.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	data.vertices.swap(vertices);
+}
+
+// --------------------------------------------------------
+// Simulates a FIFO post-transform cache of the given size
+// over the indices and reports how often vertices are reused
+// --------------------------------------------------------
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3)
+		return stats;
+
+	// Each vertex remembers the "time" it was last put in the cache, and it's
+	// still there as long as fewer than cacheSize misses have happened since
+	std::vector<unsigned int> cacheTimestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int uniqueVertices = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (timestamp - cacheTimestamps[v] > cacheSize)
+		{
+			cacheTimestamps[v] = timestamp++;
+			stats.shaderInvocations++;
+		}
+
+		if (!referenced[v])
+		{
+			referenced[v] = true;
+			uniqueVertices++;
+		}
+	}
+
+	stats.acmr = (float)stats.shaderInvocations / (indexCount / 3);
+	stats.atvr = (float)stats.shaderInvocations / uniqueVertices;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Reorders clusters of triangles so the ones most likely to
+// hide the rest draw first, keeping the vertex cache order
+// within each (Sander et al, "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw")
+// --------------------------------------------------------
+void MeshOptimizer::OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	// The ACMR clusters have to beat before we're happy to split them
+	VertexCacheStats meshStats = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	float targetACMR = meshStats.acmr * threshold;
+
+	// Split the triangles into clusters, simulating the same FIFO cache
+	// as AnalyzeVertexCache but restarting it at every split
+	std::vector<unsigned int> clusterStarts;
+	std::vector<unsigned int> cacheTimestamps(vertices.size(), 0);
+	unsigned int timestamp = StatsCacheSize + 1;
+	unsigned int clusterMisses = 0;
+	unsigned int clusterTriangles = 0;
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int misses = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			unsigned int v = indices[t * 3 + c];
+			if (timestamp - cacheTimestamps[v] > StatsCacheSize)
+			{
+				cacheTimestamps[v] = timestamp++;
+				misses++;
+			}
+		}
+
+		// A triangle sharing nothing with the cache means the
+		// optimizer jumped elsewhere, so a cluster starts here
+		if (clusterTriangles == 0 || misses == 3)
+		{
+			clusterStarts.push_back((unsigned int)t);
+			clusterMisses = 0;
+			clusterTriangles = 0;
+		}
+
+		clusterMisses += misses;
+		clusterTriangles++;
+
+		// Close the cluster once it's as good as the mesh overall,
+		// restarting the cache so the next one is judged fairly
+		if ((float)clusterMisses / clusterTriangles <= targetACMR)
+		{
+			clusterTriangles = 0;
+			timestamp += StatsCacheSize + 1;
+		}
+	}
+	clusterStarts.push_back((unsigned int)triangleCount);
+	size_t clusterCount = clusterStarts.size() - 1;
+
+	// Area weighted centroid and normal of each cluster, along with the whole mesh
+	std::vector<XMFLOAT3> clusterCentroids(clusterCount);
+	std::vector<XMFLOAT3> clusterNormals(clusterCount);
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (size_t i = 0; i < clusterCount; i++)
+	{
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (unsigned int t = clusterStarts[i]; t < clusterStarts[i + 1]; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[indices[t * 3 + 0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position);
+
+			// Clockwise front faces, so this points out of the surface
+			// and its length is twice the triangle's area
+			XMVECTOR faceNormal = XMVector3Cross(p1 - p0, p2 - p0);
+			float faceArea = XMVectorGetX(XMVector3Length(faceNormal));
+
+			centroid += (p0 + p1 + p2) * (faceArea / 3.0f);
+			normal += faceNormal;
+			area += faceArea;
+		}
+
+		meshCentroid += centroid;
+		meshArea += area;
+
+		XMStoreFloat3(&clusterCentroids[i], area > 0.0f ? centroid / area : centroid);
+		XMStoreFloat3(&clusterNormals[i], XMVector3Normalize(normal));
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// How far out each cluster sits along its own facing direction
+	std::vector<float> clusterScores(clusterCount);
+	for (size_t i = 0; i < clusterCount; i++)
+	{
+		XMVECTOR offset = XMLoadFloat3(&clusterCentroids[i]) - meshCentroid;
+		clusterScores[i] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[i])));
+	}
+
+	// Highest scores first, keeping cache order between equals
+	std::vector<unsigned int> clusterOrder(clusterCount);
+	for (size_t i = 0; i < clusterCount; i++)
+		clusterOrder[i] = (unsigned int)i;
+
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+		[&](unsigned int a, unsigned int b) { return clusterScores[a] > clusterScores[b]; });
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (unsigned int cluster : clusterOrder)
+	{
+		output.insert(output.end(),
+			indices.begin() + clusterStarts[cluster] * 3,
+			indices.begin() + clusterStarts[cluster + 1] * 3);
+	}
+
+	indices.swap(output);
+}
+
+// --------------------------------------------------------
+// Estimates overdraw by rasterizing the mesh from directions
+// spread evenly over a sphere (orthographic, fit to the mesh)
+//
+// - Back faces are culled and the depth test happens before
+//   "shading", like early-z on a GPU, so this counts exactly
+//   the pixel shader work that triangle order can save
+// --------------------------------------------------------
+OverdrawStats MeshOptimizer::AnalyzeOverdraw(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	OverdrawStats stats = {};
+	if (indexCount < 3 || vertexCount == 0)
+		return stats;
+
+	const int size = (int)OverdrawResolution;
+	std::vector<float> depthBuffer(size * size);
+	std::vector<XMFLOAT3> projected(vertexCount);
+
+	for (unsigned int view = 0; view < OverdrawViewCount; view++)
+	{
+		// Fibonacci sphere, which spreads the views out evenly
+		float y = 1.0f - 2.0f * (view + 0.5f) / OverdrawViewCount;
+		float radius = sqrtf(1.0f - y * y);
+		float angle = view * XM_PI * (3.0f - sqrtf(5.0f));
+		XMVECTOR forward = XMVectorSet(cosf(angle) * radius, y, sinf(angle) * radius, 0);
+
+		// Left handed view basis, avoiding an up vector parallel to forward
+		XMVECTOR worldUp = fabsf(y) > 0.99f ? XMVectorSet(1, 0, 0, 0) : XMVectorSet(0, 1, 0, 0);
+		XMVECTOR right = XMVector3Normalize(XMVector3Cross(worldUp, forward));
+		XMVECTOR up = XMVector3Cross(forward, right);
+
+		// Project every vertex into view space and find the screen bounds
+		XMVECTOR screenMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR screenMax = XMVectorReplicate(-FLT_MAX);
+		for (size_t v = 0; v < vertexCount; v++)
+		{
+			XMVECTOR position = XMLoadFloat3(&vertices[v].Position);
+			XMVECTOR viewPosition = XMVectorSet(
+				XMVectorGetX(XMVector3Dot(position, right)),
+				XMVectorGetX(XMVector3Dot(position, up)),
+				XMVectorGetX(XMVector3Dot(position, forward)),
+				0);
+			screenMin = XMVectorMin(screenMin, viewPosition);
+			screenMax = XMVectorMax(screenMax, viewPosition);
+			XMStoreFloat3(&projected[v], viewPosition);
+		}
+
+		// Uniform scale to fit the mesh on screen, keeping its aspect ratio
+		XMFLOAT3 extents;
+		XMStoreFloat3(&extents, screenMax - screenMin);
+		float extent = std::max(extents.x, extents.y);
+		float scale = extent > 0.0f ? (size - 1) / extent : 0.0f;
+		XMFLOAT3 origin;
+		XMStoreFloat3(&origin, screenMin);
+
+		std::fill(depthBuffer.begin(), depthBuffer.end(), FLT_MAX);
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			XMFLOAT3 p[3];
+			for (int c = 0; c < 3; c++)
+			{
+				const XMFLOAT3& vp = projected[indices[i + c]];
+				p[c] = XMFLOAT3((vp.x - origin.x) * scale, (vp.y - origin.y) * scale, vp.z);
+			}
+
+			// Clockwise on screen (y up) is front facing, so this is
+			// negative for triangles we can see
+			float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+			if (area >= 0.0f)
+				continue;
+
+			int minX = std::max((int)floorf(std::min({ p[0].x, p[1].x, p[2].x })), 0);
+			int minY = std::max((int)floorf(std::min({ p[0].y, p[1].y, p[2].y })), 0);
+			int maxX = std::min((int)ceilf(std::max({ p[0].x, p[1].x, p[2].x })), size - 1);
+			int maxY = std::min((int)ceilf(std::max({ p[0].y, p[1].y, p[2].y })), size - 1);
+
+			// Walk the bounding box, sampling at pixel centers
+			for (int py = minY; py <= maxY; py++)
+			{
+				for (int px = minX; px <= maxX; px++)
+				{
+					float sx = px + 0.5f;
+					float sy = py + 0.5f;
+
+					// Edge functions, all <= 0 inside a clockwise triangle
+					float w0 = (p[2].x - p[1].x) * (sy - p[1].y) - (p[2].y - p[1].y) * (sx - p[1].x);
+					float w1 = (p[0].x - p[2].x) * (sy - p[2].y) - (p[0].y - p[2].y) * (sx - p[2].x);
+					float w2 = (p[1].x - p[0].x) * (sy - p[0].y) - (p[1].y - p[0].y) * (sx - p[0].x);
+
+					// Treat edges as half-open so shared edges aren't shaded twice
+					if (w0 > 0.0f || w1 > 0.0f || w2 > 0.0f ||
+						(w0 == 0.0f && p[2].y <= p[1].y) ||
+						(w1 == 0.0f && p[0].y <= p[2].y) ||
+						(w2 == 0.0f && p[1].y <= p[0].y))
+						continue;
+
+					float depth = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / area;
+					float& stored = depthBuffer[py * size + px];
+					if (depth < stored)
+					{
+						if (stored == FLT_MAX)
+							stats.pixelsCovered++;
+
+						stored = depth;
+						stats.pixelsShaded++;
+					}
+				}
+			}
+		}
+	}
+
+	stats.overdraw = stats.pixelsCovered > 0 ? (float)stats.pixelsShaded / stats.pixelsCovered : 0.0f;
+	return stats;
+}
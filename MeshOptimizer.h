@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// How well an index buffer uses the GPU's post-transform
+// vertex cache, measured by simulating a FIFO cache
+//
+// - ACMR: vertex shader runs per triangle (0.5 is ideal for
+//   big regular meshes, 3.0 means nothing is ever reused)
+// - ATVR: vertex shader runs per unique vertex (1.0 is ideal)
+// --------------------------------------------------------
+struct VertexCacheStats
+{
+	float acmr;
+	float atvr;
+	unsigned int shaderInvocations;
+};
+
+// --------------------------------------------------------
+// How many times each covered pixel gets shaded, measured by
+// rasterizing the mesh on the CPU from many directions with
+// back face culling and an early depth test
+//
+// - overdraw: shaded / covered pixels (1.0 is ideal)
+// --------------------------------------------------------
+struct OverdrawStats
+{
+	float overdraw;
+	unsigned int pixelsCovered;
+	unsigned int pixelsShaded;
+};
+
+// --------------------------------------------------------
+// Import stages that reorder mesh data for the GPU without
+// changing what it looks like
+// --------------------------------------------------------
+namespace MeshOptimizer
+{
+	// Size of the FIFO cache used when reporting stats
+	const unsigned int StatsCacheSize = 16;
+
+	// How much worse than the whole mesh's ACMR a cluster may be
+	// when splitting triangles up for overdraw optimization
+	const float DefaultOverdrawThreshold = 1.05f;
+
+	// Views and resolution used when estimating overdraw
+	const unsigned int OverdrawViewCount = 16;
+	const unsigned int OverdrawResolution = 256;
+
+	// Reorders triangles so neighbouring ones share vertices (Forsyth's algorithm)
+	void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+	// Reorders clusters of cache-optimized triangles so the ones most likely
+	// to hide others are drawn first (run after OptimizeVertexCache)
+	void OptimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices, float threshold = DefaultOverdrawThreshold);
+
+	// Reorders vertices into the order the index buffer first uses them
+	void OptimizeVertexFetch(MeshData& data);
+
+	// Simulates a FIFO post-transform cache over the indices
+	VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = StatsCacheSize);
+
+	// Rasterizes the mesh from many directions and counts shaded pixels
+	OverdrawStats AnalyzeOverdraw(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+}
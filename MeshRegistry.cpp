@@ -0,0 +1,72 @@
+#include "MeshRegistry.h"
+#include "FileRegistry.h"
+
+namespace
+{
+	// Shares meshes between requests with the same file and options
+	FileRegistry registry;
+
+	// Import options as FileRegistry option bits, and back
+	uint32_t OptionsFor(bool optimizeOverdraw, VertexLayout vertexLayout)
+	{
+		return (optimizeOverdraw ? 1u : 0u) | ((uint32_t)vertexLayout << 1);
+	}
+
+	bool OptimizesOverdraw(uint32_t options) { return (options & 1) != 0; }
+	VertexLayout LayoutOf(uint32_t options) { return (VertexLayout)(options >> 1); }
+}
+
+
+// --------------------------------------------------------
+// Finds or loads the mesh for a file (see FileRegistry::Load())
+// --------------------------------------------------------
+std::shared_ptr<Mesh> MeshRegistry::Load(const std::string& filename, bool optimizeOverdraw, VertexLayout vertexLayout)
+{
+	return registry.Load<Mesh>(filename, OptionsFor(optimizeOverdraw, vertexLayout), [&](const std::string& path)
+	{
+		return std::make_shared<Mesh>(path.c_str(), optimizeOverdraw, vertexLayout);
+	});
+}
+
+// --------------------------------------------------------
+// Hit and miss counts, and the GPU memory of every loaded mesh
+// --------------------------------------------------------
+MeshRegistry::Stats MeshRegistry::GetStats()
+{
+	Stats stats = {};
+	for (const Entry& entry : GetEntries())
+	{
+		stats.meshCount++;
+		stats.vertexBufferBytes += entry.vertexBufferSize;
+		stats.indexBufferBytes += entry.indexBufferSize;
+	}
+
+	FileRegistry::Stats counts = registry.GetStats();
+	stats.hits = counts.hits;
+	stats.misses = counts.misses;
+	return stats;
+}
+
+// --------------------------------------------------------
+// Every finished mesh in the registry, sorted by path
+// - Meshes still loading on another thread are left out
+// --------------------------------------------------------
+std::vector<MeshRegistry::Entry> MeshRegistry::GetEntries()
+{
+	std::vector<Entry> entries;
+	for (const FileRegistry::Entry& entry : registry.GetEntries())
+	{
+		std::shared_ptr<Mesh> mesh = std::static_pointer_cast<Mesh>(entry.resource);
+		entries.push_back({
+			entry.path, entry.contentHash, OptimizesOverdraw(entry.options), LayoutOf(entry.options),
+			mesh, entry.requestCount,
+			mesh->GetVertexBufferSize(), mesh->GetIndexBufferSize() });
+	}
+
+	return entries;
+}
+
+void MeshRegistry::Clear()
+{
+	registry.Clear();
+}
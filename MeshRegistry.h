@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+#include "VertexPacking.h"
+
+// --------------------------------------------------------
+// Shared, deduplicated mesh loading, keyed by path, file
+// contents and import options (a FileRegistry of meshes)
+// - Safe to call from several threads
+// - Holds on to every mesh until Clear()
+// --------------------------------------------------------
+namespace MeshRegistry
+{
+	// One loaded mesh and how often it's been asked for
+	struct Entry
+	{
+		std::string path;			// Canonical path of the source file
+		uint64_t contentHash;		// MeshCache::HashContents() of the source file
+		bool optimizeOverdraw;
+		VertexLayout vertexLayout;
+		std::shared_ptr<Mesh> mesh;
+		unsigned int requestCount;
+		int vertexBufferSize;		// GPU memory, in bytes
+		int indexBufferSize;
+	};
+
+	// Totals across every request since the last Clear()
+	struct Stats
+	{
+		unsigned int hits;			// Requests that shared an already loaded (or loading) mesh
+		unsigned int misses;		// Requests that loaded a mesh
+		size_t meshCount;
+		size_t vertexBufferBytes;
+		size_t indexBufferBytes;
+	};
+
+	// Returns the mesh for a file, loading it if this is the first
+	// request for it (see Mesh's constructor for the options)
+	// - Throws if the file can't be opened or loaded
+	std::shared_ptr<Mesh> Load(const std::string& filename, bool optimizeOverdraw = false, VertexLayout vertexLayout = VertexLayout::Standard);
+
+	// Reporting
+	Stats GetStats();
+	std::vector<Entry> GetEntries();
+
+	// Forgets every mesh and resets the stats (meshes still in
+	// use elsewhere stay alive until their last owner lets go)
+	void Clear();
+}
@@ -0,0 +1,647 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Sum of squared distances to a set of planes, weighted by
+	// the area of the triangles they came from
+	// --------------------------------------------------------
+	struct Quadric
+	{
+		double a00, a11, a22, a01, a02, a12;	// Symmetric 3x3 part
+		double b0, b1, b2;						// Linear part
+		double c;								// Constant part
+		double weight;							// Total area
+	};
+
+	Quadric PlaneQuadric(XMFLOAT3 normal, float distance, float weight)
+	{
+		Quadric q;
+		q.a00 = weight * normal.x * normal.x;
+		q.a11 = weight * normal.y * normal.y;
+		q.a22 = weight * normal.z * normal.z;
+		q.a01 = weight * normal.x * normal.y;
+		q.a02 = weight * normal.x * normal.z;
+		q.a12 = weight * normal.y * normal.z;
+		q.b0 = weight * normal.x * distance;
+		q.b1 = weight * normal.y * distance;
+		q.b2 = weight * normal.z * distance;
+		q.c = weight * distance * distance;
+		q.weight = weight;
+		return q;
+	}
+
+	void AddQuadric(Quadric& q, const Quadric& other)
+	{
+		q.a00 += other.a00; q.a11 += other.a11; q.a22 += other.a22;
+		q.a01 += other.a01; q.a02 += other.a02; q.a12 += other.a12;
+		q.b0 += other.b0; q.b1 += other.b1; q.b2 += other.b2;
+		q.c += other.c;
+		q.weight += other.weight;
+	}
+
+	// Mean squared distance from a point to the quadric's planes
+	float EvaluateQuadric(const Quadric& q, const XMFLOAT3& p)
+	{
+		double x = p.x, y = p.y, z = p.z;
+		double error =
+			q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+			2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z) +
+			2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) +
+			q.c;
+
+		return q.weight > 0.0 ? (float)(fabs(error) / q.weight) : 0.0f;
+	}
+
+	// Position and normal of a vertex, for welding across uv seams
+	struct WeldKey
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 normal;
+
+		bool operator==(const WeldKey& other) const
+		{
+			return memcmp(this, &other, sizeof(WeldKey)) == 0;
+		}
+	};
+
+	struct WeldKeyHash
+	{
+		size_t operator()(const WeldKey& key) const
+		{
+			uint32_t bits[6];
+			memcpy(bits, &key, sizeof(bits));
+
+			unsigned long long hash = 0;
+			for (uint32_t b : bits)
+				hash = hash * 0x9E3779B97F4A7C15ull ^ b;
+			return (size_t)(hash ^ (hash >> 29));
+		}
+	};
+
+	// Directed edges between two positions, packed for hashing
+	uint64_t EdgeKey(unsigned int from, unsigned int to)
+	{
+		return ((uint64_t)from << 32) | to;
+	}
+
+	// Unnormalized face normal (its length is twice the area)
+	XMVECTOR FaceNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&a);
+		return XMVector3Cross(XMLoadFloat3(&b) - p0, XMLoadFloat3(&c) - p0);
+	}
+
+	// --------------------------------------------------------
+	// Squared distance from a point to a triangle
+	// - From Ericson, "Real-Time Collision Detection" (5.1.5)
+	// --------------------------------------------------------
+	float PointTriangleDistanceSq(XMVECTOR p, XMVECTOR a, XMVECTOR b, XMVECTOR c)
+	{
+		XMVECTOR ab = b - a;
+		XMVECTOR ac = c - a;
+		XMVECTOR ap = p - a;
+
+		float d1 = XMVectorGetX(XMVector3Dot(ab, ap));
+		float d2 = XMVectorGetX(XMVector3Dot(ac, ap));
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return XMVectorGetX(XMVector3LengthSq(p - a));
+
+		XMVECTOR bp = p - b;
+		float d3 = XMVectorGetX(XMVector3Dot(ab, bp));
+		float d4 = XMVectorGetX(XMVector3Dot(ac, bp));
+		if (d3 >= 0.0f && d4 <= d3)
+			return XMVectorGetX(XMVector3LengthSq(p - b));
+
+		float vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			XMVECTOR closest = a + ab * (d1 / (d1 - d3));
+			return XMVectorGetX(XMVector3LengthSq(p - closest));
+		}
+
+		XMVECTOR cp = p - c;
+		float d5 = XMVectorGetX(XMVector3Dot(ab, cp));
+		float d6 = XMVectorGetX(XMVector3Dot(ac, cp));
+		if (d6 >= 0.0f && d5 <= d6)
+			return XMVectorGetX(XMVector3LengthSq(p - c));
+
+		float vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			XMVECTOR closest = a + ac * (d2 / (d2 - d6));
+			return XMVectorGetX(XMVector3LengthSq(p - closest));
+		}
+
+		float va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+		{
+			XMVECTOR closest = b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+			return XMVectorGetX(XMVector3LengthSq(p - closest));
+		}
+
+		// Inside the face
+		float denominator = va + vb + vc;
+		if (denominator == 0.0f)
+			return XMVectorGetX(XMVector3LengthSq(p - a));
+
+		XMVECTOR closest = a + ab * (vb / denominator) + ac * (vc / denominator);
+		return XMVectorGetX(XMVector3LengthSq(p - closest));
+	}
+
+	// --------------------------------------------------------
+	// Uniform grid of triangles, for finding the closest one to
+	// a point without testing every triangle
+	// --------------------------------------------------------
+	struct TriangleGrid
+	{
+		const Vertex* vertices;
+		const unsigned int* indices;
+		XMFLOAT3 origin;
+		float cellSize;
+		int dims[3];
+		std::vector<unsigned int> cellStarts;		// Per cell offsets into cellTriangles
+		std::vector<unsigned int> cellTriangles;
+		std::vector<unsigned int> stamps;			// Last query each triangle was tested in
+		unsigned int query;
+
+		TriangleGrid(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+			: vertices(vertices), indices(indices), query(0)
+		{
+			size_t triangleCount = indexCount / 3;
+
+			// Every sample point lies within the bounds of the shared vertices
+			XMFLOAT3 boundsMin = vertices[0].Position;
+			XMFLOAT3 boundsMax = vertices[0].Position;
+			for (size_t i = 1; i < vertexCount; i++)
+			{
+				const XMFLOAT3& p = vertices[i].Position;
+				boundsMin = XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+				boundsMax = XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+			}
+
+			// Roughly one cell per triangle along the longest axis's cube root
+			float extent = std::max({ boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z });
+			float cellsPerAxis = std::clamp(cbrtf((float)triangleCount) * 2.0f, 1.0f, 128.0f);
+			cellSize = extent > 0.0f ? extent / cellsPerAxis : 1.0f;
+			origin = boundsMin;
+			dims[0] = std::max((int)ceilf((boundsMax.x - boundsMin.x) / cellSize), 1);
+			dims[1] = std::max((int)ceilf((boundsMax.y - boundsMin.y) / cellSize), 1);
+			dims[2] = std::max((int)ceilf((boundsMax.z - boundsMin.z) / cellSize), 1);
+
+			// Count, then fill, the triangles overlapping each cell
+			cellStarts.assign((size_t)dims[0] * dims[1] * dims[2] + 1, 0);
+			for (int pass = 0; pass < 2; pass++)
+			{
+				if (pass == 1)
+				{
+					for (size_t c = 1; c < cellStarts.size(); c++)
+						cellStarts[c] += cellStarts[c - 1];
+					cellTriangles.resize(cellStarts.back());
+				}
+
+				for (size_t t = 0; t < triangleCount; t++)
+				{
+					int cellMin[3], cellMax[3];
+					TriangleCells(t, cellMin, cellMax);
+
+					for (int z = cellMin[2]; z <= cellMax[2]; z++)
+						for (int y = cellMin[1]; y <= cellMax[1]; y++)
+							for (int x = cellMin[0]; x <= cellMax[0]; x++)
+							{
+								size_t cell = CellIndex(x, y, z);
+								if (pass == 0)
+									cellStarts[cell + 1]++;
+								else
+									cellTriangles[cellStarts[cell]++] = (unsigned int)t;
+							}
+				}
+			}
+
+			// The fill pass moved each start to its end, so shift them back
+			for (size_t c = cellStarts.size() - 1; c > 0; c--)
+				cellStarts[c] = cellStarts[c - 1];
+			cellStarts[0] = 0;
+
+			stamps.assign(triangleCount, 0);
+		}
+
+		size_t CellIndex(int x, int y, int z) const
+		{
+			return ((size_t)z * dims[1] + y) * dims[0] + x;
+		}
+
+		int CellCoordinate(float value, float originValue, int axis) const
+		{
+			return std::clamp((int)floorf((value - originValue) / cellSize), 0, dims[axis] - 1);
+		}
+
+		void TriangleCells(size_t t, int cellMin[3], int cellMax[3]) const
+		{
+			const XMFLOAT3& a = vertices[indices[t * 3 + 0]].Position;
+			const XMFLOAT3& b = vertices[indices[t * 3 + 1]].Position;
+			const XMFLOAT3& c = vertices[indices[t * 3 + 2]].Position;
+
+			cellMin[0] = CellCoordinate(std::min({ a.x, b.x, c.x }), origin.x, 0);
+			cellMin[1] = CellCoordinate(std::min({ a.y, b.y, c.y }), origin.y, 1);
+			cellMin[2] = CellCoordinate(std::min({ a.z, b.z, c.z }), origin.z, 2);
+			cellMax[0] = CellCoordinate(std::max({ a.x, b.x, c.x }), origin.x, 0);
+			cellMax[1] = CellCoordinate(std::max({ a.y, b.y, c.y }), origin.y, 1);
+			cellMax[2] = CellCoordinate(std::max({ a.z, b.z, c.z }), origin.z, 2);
+		}
+
+		// Squared distance from a point (inside the grid's bounds) to the nearest triangle
+		float ClosestDistanceSq(const XMFLOAT3& point)
+		{
+			query++;
+			XMVECTOR p = XMLoadFloat3(&point);
+			int center[3] =
+			{
+				CellCoordinate(point.x, origin.x, 0),
+				CellCoordinate(point.y, origin.y, 1),
+				CellCoordinate(point.z, origin.z, 2)
+			};
+
+			// Search shells of cells outward until nothing closer can be left
+			float best = FLT_MAX;
+			int maxRadius = std::max({ dims[0], dims[1], dims[2] });
+			for (int radius = 0; radius <= maxRadius; radius++)
+			{
+				for (int z = center[2] - radius; z <= center[2] + radius; z++)
+				{
+					if (z < 0 || z >= dims[2])
+						continue;
+
+					for (int y = center[1] - radius; y <= center[1] + radius; y++)
+					{
+						if (y < 0 || y >= dims[1])
+							continue;
+
+						for (int x = center[0] - radius; x <= center[0] + radius; x++)
+						{
+							if (x < 0 || x >= dims[0])
+								continue;
+
+							// Only the surface of the shell, the inside was done already
+							bool onShell =
+								abs(x - center[0]) == radius ||
+								abs(y - center[1]) == radius ||
+								abs(z - center[2]) == radius;
+							if (!onShell)
+								continue;
+
+							size_t cell = CellIndex(x, y, z);
+							for (unsigned int i = cellStarts[cell]; i < cellStarts[cell + 1]; i++)
+							{
+								unsigned int t = cellTriangles[i];
+								if (stamps[t] == query)
+									continue;
+								stamps[t] = query;
+
+								best = std::min(best, PointTriangleDistanceSq(p,
+									XMLoadFloat3(&vertices[indices[t * 3 + 0]].Position),
+									XMLoadFloat3(&vertices[indices[t * 3 + 1]].Position),
+									XMLoadFloat3(&vertices[indices[t * 3 + 2]].Position)));
+							}
+						}
+					}
+				}
+
+				// Anything in a further shell is at least this far away
+				float reach = radius * cellSize;
+				if (best <= reach * reach)
+					break;
+			}
+
+			return best;
+		}
+	};
+
+	// Largest distance from samples on the "from" triangles to the nearest "to" triangle
+	float DirectedHausdorff(const Vertex* vertices, const unsigned int* from, size_t fromCount, TriangleGrid& to)
+	{
+		float worst = 0.0f;
+		for (size_t i = 0; i + 2 < fromCount; i += 3)
+		{
+			XMVECTOR a = XMLoadFloat3(&vertices[from[i + 0]].Position);
+			XMVECTOR b = XMLoadFloat3(&vertices[from[i + 1]].Position);
+			XMVECTOR c = XMLoadFloat3(&vertices[from[i + 2]].Position);
+
+			XMVECTOR samples[7] =
+			{
+				a, b, c,
+				(a + b) * 0.5f, (b + c) * 0.5f, (c + a) * 0.5f,
+				(a + b + c) * (1.0f / 3.0f)
+			};
+
+			for (XMVECTOR sample : samples)
+			{
+				XMFLOAT3 point;
+				XMStoreFloat3(&point, sample);
+				worst = std::max(worst, to.ClosestDistanceSq(point));
+			}
+		}
+
+		return sqrtf(worst);
+	}
+}
+
+
+// --------------------------------------------------------
+// Simplifies a triangle list with quadric edge collapses
+//
+// - Works in passes: every pass scores all collapsible edges,
+//   then applies the cheapest ones that don't touch each other
+//   or flip any triangles, until the target is reached or
+//   nothing more can collapse
+// --------------------------------------------------------
+std::vector<unsigned int> MeshSimplifier::Simplify(const Vertex* vertices, size_t vertexCount,
+	const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float* resultError)
+{
+	std::vector<unsigned int> result(indices, indices + indexCount);
+	if (resultError)
+		*resultError = 0.0f;
+
+	// Weld vertices split only by their uvs, so uv seams can be found
+	// - Vertices with different normals stay apart: hard edges, and the
+	//   two sides of double sided meshes, which share positions
+	std::unordered_map<WeldKey, unsigned int, WeldKeyHash> weldIds;
+	std::vector<unsigned int> weldOf(vertexCount);
+	std::vector<unsigned int> wedgeCounts;
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		WeldKey key = { vertices[v].Position, vertices[v].normal };
+		auto inserted = weldIds.insert({ key, (unsigned int)wedgeCounts.size() });
+		if (inserted.second)
+			wedgeCounts.push_back(0);
+
+		weldOf[v] = inserted.first->second;
+		wedgeCounts[weldOf[v]]++;
+	}
+	size_t weldCount = wedgeCounts.size();
+
+	// Uv seams get locked in place
+	std::vector<bool> locked(weldCount, false);
+	for (size_t w = 0; w < weldCount; w++)
+		locked[w] = wedgeCounts[w] > 1;
+
+	// So do open borders (including hard edges) and non-manifold edges,
+	// found by matching each edge with exactly one edge running the other way
+	std::unordered_map<uint64_t, unsigned int> edgeCounts;
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int from = weldOf[indices[i + e]];
+			unsigned int to = weldOf[indices[i + (e + 1) % 3]];
+			if (from != to)
+				edgeCounts[EdgeKey(from, to)]++;
+		}
+	}
+	for (const auto& edge : edgeCounts)
+	{
+		unsigned int from = (unsigned int)(edge.first >> 32);
+		unsigned int to = (unsigned int)(edge.first & 0xFFFFFFFF);
+		auto opposite = edgeCounts.find(EdgeKey(to, from));
+		if (edge.second != 1 || opposite == edgeCounts.end() || opposite->second != 1)
+			locked[from] = locked[to] = true;
+	}
+
+	// Quadrics for each welded vertex, from the planes of the triangles around it
+	std::vector<Quadric> quadrics(weldCount, Quadric{});
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		const XMFLOAT3& a = vertices[indices[i + 0]].Position;
+		XMVECTOR normal = FaceNormal(a, vertices[indices[i + 1]].Position, vertices[indices[i + 2]].Position);
+		float area = XMVectorGetX(XMVector3Length(normal)) * 0.5f;
+		if (area == 0.0f)
+			continue;
+
+		XMFLOAT3 unitNormal;
+		XMStoreFloat3(&unitNormal, XMVector3Normalize(normal));
+		float distance = -(unitNormal.x * a.x + unitNormal.y * a.y + unitNormal.z * a.z);
+
+		Quadric plane = PlaneQuadric(unitNormal, distance, area);
+		for (int c = 0; c < 3; c++)
+			AddQuadric(quadrics[weldOf[indices[i + c]]], plane);
+	}
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		float cost;
+	};
+
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> adjacencyOffsets;
+	std::vector<unsigned int> adjacency;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+
+	float maxError = 0.0f;
+	while (result.size() > targetIndexCount)
+	{
+		size_t triangleCount = result.size() / 3;
+
+		// Score both directions of every interior edge, seeing each once
+		// from the triangle where it runs from the lower index
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				unsigned int a = result[t * 3 + e];
+				unsigned int b = result[t * 3 + (e + 1) % 3];
+				if (a >= b)
+					continue;
+
+				Quadric combined = quadrics[weldOf[a]];
+				AddQuadric(combined, quadrics[weldOf[b]]);
+
+				if (!locked[weldOf[a]])
+					collapses.push_back({ a, b, EvaluateQuadric(combined, vertices[b].Position) });
+				if (!locked[weldOf[b]])
+					collapses.push_back({ b, a, EvaluateQuadric(combined, vertices[a].Position) });
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(),
+			[](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		// Triangles around each vertex
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (unsigned int index : result)
+			adjacencyOffsets[index + 1]++;
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+		adjacency.resize(result.size());
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); i++)
+			adjacency[fill[result[i]]++] = (unsigned int)(i / 3);
+
+		for (size_t v = 0; v < vertexCount; v++)
+			remap[v] = (unsigned int)v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		size_t trianglesToRemove = triangleCount - targetIndexCount / 3;
+		size_t trianglesRemoved = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (trianglesRemoved >= trianglesToRemove)
+				break;
+
+			if (touched[collapse.from] || touched[collapse.to])
+				continue;
+
+			// Moving "from" onto "to" mustn't flip any triangle that survives
+			const XMFLOAT3& target = vertices[collapse.to].Position;
+			bool flips = false;
+			size_t collapsing = 0;
+			for (unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+			{
+				const unsigned int* triangle = &result[adjacency[a] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					collapsing++;
+					continue;
+				}
+
+				XMFLOAT3 before[3], after[3];
+				for (int c = 0; c < 3; c++)
+				{
+					before[c] = vertices[triangle[c]].Position;
+					after[c] = triangle[c] == collapse.from ? target : before[c];
+				}
+
+				XMVECTOR normalBefore = FaceNormal(before[0], before[1], before[2]);
+				XMVECTOR normalAfter = FaceNormal(after[0], after[1], after[2]);
+				if (XMVectorGetX(XMVector3Dot(normalBefore, normalAfter)) <= 0.0f)
+				{
+					flips = true;
+					break;
+				}
+			}
+
+			if (flips)
+				continue;
+
+			// Nothing else this pass may touch the triangles around "from",
+			// so the flip test above stays true
+			for (unsigned int a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1]; a++)
+			{
+				const unsigned int* triangle = &result[adjacency[a] * 3];
+				touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+			}
+
+			remap[collapse.from] = collapse.to;
+			AddQuadric(quadrics[weldOf[collapse.to]], quadrics[weldOf[collapse.from]]);
+			maxError = std::max(maxError, collapse.cost);
+			trianglesRemoved += collapsing;
+		}
+
+		if (trianglesRemoved == 0)
+			break;
+
+		// Apply the collapses, dropping the triangles that vanished
+		size_t write = 0;
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			unsigned int a = remap[result[t * 3 + 0]];
+			unsigned int b = remap[result[t * 3 + 1]];
+			unsigned int c = remap[result[t * 3 + 2]];
+			if (a == b || b == c || c == a)
+				continue;
+
+			result[write++] = a;
+			result[write++] = b;
+			result[write++] = c;
+		}
+		result.resize(write);
+	}
+
+	if (resultError)
+		*resultError = sqrtf(maxError);
+
+	return result;
+}
+
+// --------------------------------------------------------
+// Builds successively simpler levels of detail
+//
+// - Each level is simplified from the full detail mesh (not
+//   the previous level) so errors don't stack up, and is then
+//   reordered for the vertex cache
+// - Stops early once a mesh is too locked down to shrink much
+// --------------------------------------------------------
+void MeshSimplifier::BuildLodChain(MeshData& data, unsigned int lodCount)
+{
+	size_t fullIndexCount = data.indices.size();
+	data.lods.clear();
+	data.lods.push_back({ 0, (unsigned int)fullIndexCount, 0.0f, 0.0f });
+
+	size_t previousIndexCount = fullIndexCount;
+	float reduction = 1.0f;
+	for (unsigned int level = 1; level <= lodCount; level++)
+	{
+		reduction *= LodReduction;
+		size_t targetIndexCount = (size_t)(fullIndexCount / 3 * reduction) * 3;
+
+		float error = 0.0f;
+		std::vector<unsigned int> lod = Simplify(
+			data.vertices.data(), data.vertices.size(),
+			data.indices.data(), fullIndexCount,
+			targetIndexCount, &error);
+
+		// Not even halfway from the last level to this one's target
+		if (lod.empty() || lod.size() > (previousIndexCount + targetIndexCount) / 2)
+			break;
+
+		MeshOptimizer::OptimizeVertexCache(lod, data.vertices.size());
+
+		MeshLod record;
+		record.indexOffset = (unsigned int)data.indices.size();
+		record.indexCount = (unsigned int)lod.size();
+		record.error = error;
+		record.hausdorffError = MeasureHausdorff(
+			data.vertices.data(), data.vertices.size(),
+			data.indices.data(), fullIndexCount,
+			lod.data(), lod.size());
+
+		data.lods.push_back(record);
+		data.indices.insert(data.indices.end(), lod.begin(), lod.end());
+		previousIndexCount = lod.size();
+	}
+}
+
+// --------------------------------------------------------
+// Measures how far apart two surfaces are, as the largest
+// distance from a sample on either one to the other
+// --------------------------------------------------------
+float MeshSimplifier::MeasureHausdorff(const Vertex* vertices, size_t vertexCount,
+	const unsigned int* indicesA, size_t indexCountA,
+	const unsigned int* indicesB, size_t indexCountB)
+{
+	if (vertexCount == 0 || indexCountA < 3 || indexCountB < 3)
+		return 0.0f;
+
+	TriangleGrid gridA(vertices, vertexCount, indicesA, indexCountA);
+	TriangleGrid gridB(vertices, vertexCount, indicesB, indexCountB);
+
+	return std::max(
+		DirectedHausdorff(vertices, indicesA, indexCountA, gridB),
+		DirectedHausdorff(vertices, indicesB, indexCountB, gridA));
+}
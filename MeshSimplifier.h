@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Builds lower detail versions of a mesh by collapsing edges
+// (Garland & Heckbert, quadric error metrics)
+// - Every level shares the original vertex buffer, and seams
+//   and borders never move
+// --------------------------------------------------------
+namespace MeshSimplifier
+{
+	// Each level aims for this fraction of the previous level's triangles
+	const float LodReduction = 0.5f;
+
+	// Levels built after the full detail one (50%, 25%, 12.5%)
+	const unsigned int DefaultLodCount = 3;
+
+	// Simplifies a triangle list down to (at most) targetIndexCount indices
+	// - resultError is set to the largest collapse error, in local space units
+	std::vector<unsigned int> Simplify(const Vertex* vertices, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float* resultError = nullptr);
+
+	// Adds simplified levels of detail to the end of data.indices, recording
+	// every level (including the full detail one) in data.lods
+	void BuildLodChain(MeshData& data, unsigned int lodCount = DefaultLodCount);
+
+	// Symmetric Hausdorff distance between two triangle lists sharing vertices,
+	// sampled at vertices, edge midpoints and triangle centers
+	float MeasureHausdorff(const Vertex* vertices, size_t vertexCount,
+		const unsigned int* indicesA, size_t indexCountA,
+		const unsigned int* indicesB, size_t indexCountB);
+}
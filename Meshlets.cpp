@@ -0,0 +1,190 @@
+#include "Meshlets.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+// Meshlets are written and read as raw bytes by the mesh cache
+static_assert(sizeof(Meshlet) == 56, "Meshlet layout changed, bump MeshCache::Version");
+
+namespace
+{
+	// Below this, the normals spread too far for the cone to ever cull
+	const float MinConeSpread = 0.1f;
+
+	// --------------------------------------------------------
+	// Fills in the bounding sphere and normal cone of a meshlet
+	// - Cone math follows meshoptimizer's meshopt_computeClusterBounds
+	// --------------------------------------------------------
+	void ComputeBounds(Meshlet& meshlet, const Vertex* vertices, const unsigned int* indices)
+	{
+		const unsigned int* triangles = indices + meshlet.indexOffset;
+		unsigned int indexCount = meshlet.triangleCount * 3;
+
+		// Sphere around the center of the bounding box
+		XMVECTOR boundsMin = XMLoadFloat3(&vertices[triangles[0]].Position);
+		XMVECTOR boundsMax = boundsMin;
+		for (unsigned int i = 1; i < indexCount; i++)
+		{
+			XMVECTOR position = XMLoadFloat3(&vertices[triangles[i]].Position);
+			boundsMin = XMVectorMin(boundsMin, position);
+			boundsMax = XMVectorMax(boundsMax, position);
+		}
+
+		XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+		float radiusSquared = 0.0f;
+		for (unsigned int i = 0; i < indexCount; i++)
+		{
+			XMVECTOR offset = XMLoadFloat3(&vertices[triangles[i]].Position) - center;
+			radiusSquared = std::max(radiusSquared, XMVectorGetX(XMVector3LengthSq(offset)));
+		}
+
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = sqrtf(radiusSquared);
+
+		// Face normals (outward, since front faces are clockwise), and their average
+		std::vector<XMFLOAT3> normals(meshlet.triangleCount);
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[triangles[t * 3 + 0]].Position);
+			XMVECTOR p1 = XMLoadFloat3(&vertices[triangles[t * 3 + 1]].Position);
+			XMVECTOR p2 = XMLoadFloat3(&vertices[triangles[t * 3 + 2]].Position);
+
+			XMVECTOR normal = XMVector3Normalize(XMVector3Cross(p1 - p0, p2 - p0));
+			XMStoreFloat3(&normals[t], normal);
+			axis += normal;
+		}
+		axis = XMVector3Normalize(axis);
+
+		// The widest angle between a normal and the axis
+		float minDot = 1.0f;
+		for (const XMFLOAT3& normal : normals)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(XMLoadFloat3(&normal), axis)));
+
+		meshlet.coneApex = meshlet.center;
+		meshlet.coneAxis = XMFLOAT3(0, 0, 0);
+		meshlet.coneCutoff = 1.0f;
+		if (minDot <= MinConeSpread)
+			return;
+
+		// Slide the apex back along the axis until every triangle's
+		// plane is in front of it, so the test works for perspective
+		float maxDistance = 0.0f;
+		for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&vertices[triangles[t * 3 + 0]].Position);
+			XMVECTOR normal = XMLoadFloat3(&normals[t]);
+
+			float planeDistance = XMVectorGetX(XMVector3Dot(center - p0, normal));
+			float axisDot = XMVectorGetX(XMVector3Dot(axis, normal));
+			maxDistance = std::max(maxDistance, planeDistance / axisDot);
+		}
+
+		XMStoreFloat3(&meshlet.coneApex, center - axis * maxDistance);
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+
+// --------------------------------------------------------
+// Splits a triangle list into meshlets
+//
+// - Triangles are taken in order, starting a new meshlet
+//   whenever the next one would go over either limit
+// - Index order isn't changed, which keeps the vertex cache
+//   and overdraw ordering intact
+// --------------------------------------------------------
+std::vector<Meshlet> Meshlets::Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+	unsigned int maxVertices, unsigned int maxTriangles)
+{
+	std::vector<Meshlet> meshlets;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return meshlets;
+
+	// Which meshlet last used each vertex, to count unique vertices
+	const unsigned int unused = ~0u;
+	std::vector<unsigned int> lastMeshlet(vertexCount, unused);
+
+	// Counts the triangle's vertices the given meshlet doesn't have yet
+	auto countNewVertices = [&](const unsigned int* triangle, unsigned int meshletIndex)
+	{
+		unsigned int count = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			bool repeated = (c > 0 && triangle[c] == triangle[0]) || (c > 1 && triangle[c] == triangle[1]);
+			if (!repeated && lastMeshlet[triangle[c]] != meshletIndex)
+				count++;
+		}
+		return count;
+	};
+
+	Meshlet current = {};
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const unsigned int* triangle = &indices[t * 3];
+		unsigned int meshletIndex = (unsigned int)meshlets.size();
+		unsigned int newVertices = countNewVertices(triangle, meshletIndex);
+
+		// Full, so finish this meshlet and start the next with this triangle
+		if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+		{
+			meshlets.push_back(current);
+			meshletIndex++;
+			newVertices = countNewVertices(triangle, meshletIndex);
+
+			current = {};
+			current.indexOffset = (unsigned int)(t * 3);
+		}
+
+		for (int c = 0; c < 3; c++)
+			lastMeshlet[triangle[c]] = meshletIndex;
+
+		current.vertexCount += newVertices;
+		current.triangleCount++;
+	}
+	meshlets.push_back(current);
+
+	for (Meshlet& meshlet : meshlets)
+		ComputeBounds(meshlet, vertices, indices);
+
+	return meshlets;
+}
+
+// --------------------------------------------------------
+// Whether a meshlet is entirely back facing from a camera at
+// the given position (in the mesh's local space)
+// --------------------------------------------------------
+bool Meshlets::IsBackfacing(const Meshlet& meshlet, const XMFLOAT3& cameraPosition)
+{
+	XMVECTOR toApex = XMVector3Normalize(XMLoadFloat3(&meshlet.coneApex) - XMLoadFloat3(&cameraPosition));
+	return XMVectorGetX(XMVector3Dot(toApex, XMLoadFloat3(&meshlet.coneAxis))) >= meshlet.coneCutoff;
+}
+
+// --------------------------------------------------------
+// Whether a world matrix keeps the local space cone test valid
+//
+// - Non-uniform scale and shear bend normals by different
+//   amounts, and mirroring flips which side the rasterizer
+//   culls, so any of those turns cone culling off
+// --------------------------------------------------------
+bool Meshlets::ConesHoldUnder(const XMFLOAT4X4& world)
+{
+	XMVECTOR x = XMVectorSet(world._11, world._12, world._13, 0);
+	XMVECTOR y = XMVectorSet(world._21, world._22, world._23, 0);
+	XMVECTOR z = XMVectorSet(world._31, world._32, world._33, 0);
+
+	// Rows of equal length at right angles, in a right-handed order
+	float scaleSquared = XMVectorGetX(XMVector3LengthSq(x));
+	float tolerance = scaleSquared * 1e-4f;
+	return
+		scaleSquared > 0.0f &&
+		fabsf(XMVectorGetX(XMVector3LengthSq(y)) - scaleSquared) <= tolerance &&
+		fabsf(XMVectorGetX(XMVector3LengthSq(z)) - scaleSquared) <= tolerance &&
+		fabsf(XMVectorGetX(XMVector3Dot(x, y))) <= tolerance &&
+		fabsf(XMVectorGetX(XMVector3Dot(y, z))) <= tolerance &&
+		fabsf(XMVectorGetX(XMVector3Dot(z, x))) <= tolerance &&
+		XMVectorGetX(XMVector3Dot(XMVector3Cross(x, y), z)) > 0.0f;
+}
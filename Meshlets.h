@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// A small cluster of a mesh's triangles, with local space
+// bounds for culling on the CPU
+// - Stored raw in the mesh cache, so the layout is fixed
+// --------------------------------------------------------
+struct Meshlet
+{
+	unsigned int indexOffset;		// First index in the mesh's index buffer
+	unsigned int triangleCount;
+	unsigned int vertexCount;		// Unique vertices used by the triangles
+
+	// Bounding sphere
+	DirectX::XMFLOAT3 center;
+	float radius;
+
+	// Normal cone: every triangle faces away from cameras inside the
+	// cone behind the apex (coneCutoff of 1 means it never does)
+	DirectX::XMFLOAT3 coneApex;
+	DirectX::XMFLOAT3 coneAxis;
+	float coneCutoff;
+};
+
+// --------------------------------------------------------
+// Splits meshes into meshlets and culls them
+// --------------------------------------------------------
+namespace Meshlets
+{
+	// Limits per meshlet, sized to match what mesh shader hardware prefers
+	const unsigned int MaxVertices = 64;
+	const unsigned int MaxTriangles = 124;
+
+	// Splits indices into meshlets in order, keeping whatever locality
+	// the vertex cache and overdraw passes gave them
+	std::vector<Meshlet> Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		unsigned int maxVertices = MaxVertices, unsigned int maxTriangles = MaxTriangles);
+
+	// Whether every triangle faces away from a camera at this (local space) position
+	bool IsBackfacing(const Meshlet& meshlet, const DirectX::XMFLOAT3& cameraPosition);
+
+	// Whether the cones still hold once drawn with this world matrix,
+	// which must only rotate, translate and scale uniformly
+	bool ConesHoldUnder(const DirectX::XMFLOAT4X4& world);
+}
@@ -0,0 +1,496 @@
+#include "ObjLoader.h"
+#include "MappedFile.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	// One corner of a face, as 1-based indices into
+	// the attribute lists (0 means it wasn't given)
+	struct ObjCorner
+	{
+		unsigned int position;
+		unsigned int uv;
+		unsigned int normal;
+
+		bool operator==(const ObjCorner& other) const
+		{
+			return position == other.position && uv == other.uv && normal == other.normal;
+		}
+	};
+
+	// Hashes a corner so identical ones can be welded
+	// - The maps index buckets by the low bits, so the parallel
+	//   build picks each corner's thread from the high 32 bits
+	struct ObjCornerHash
+	{
+		static unsigned long long Mix(const ObjCorner& corner)
+		{
+			unsigned long long hash = corner.position;
+			hash = hash * 0x9E3779B97F4A7C15ull ^ corner.uv;
+			hash = hash * 0x9E3779B97F4A7C15ull ^ corner.normal;
+			return hash ^ (hash >> 29);
+		}
+
+		size_t operator()(const ObjCorner& corner) const
+		{
+			return (size_t)Mix(corner);
+		}
+
+		// Scales the high bits into [0, count)
+		static unsigned int Partition(const ObjCorner& corner, unsigned int count)
+		{
+			return (unsigned int)(((Mix(corner) >> 32) * count) >> 32);
+		}
+	};
+
+	// Everything read out of the file before vertices are built
+	struct ObjData
+	{
+		std::vector<XMFLOAT3> positions;	// Positions from the file
+		std::vector<XMFLOAT3> normals;		// Normals from the file
+		std::vector<XMFLOAT2> uvs;		// UVs from the file
+		std::vector<ObjCorner> corners;		// Triangle corners, three per triangle
+	};
+
+	// Spaces, tabs and the '\r' of Windows line endings all separate tokens
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	const char* SkipSpaces(const char* cursor, const char* end)
+	{
+		while (cursor < end && IsSpace(*cursor))
+			cursor++;
+		return cursor;
+	}
+
+	// Reads the next float on the line, leaving it at 0 if there isn't one
+	const char* ReadFloat(const char* cursor, const char* end, float& value)
+	{
+		cursor = SkipSpaces(cursor, end);
+
+		// from_chars doesn't accept a leading plus sign
+		if (cursor < end && *cursor == '+')
+			cursor++;
+
+		value = 0.0f;
+		std::from_chars_result result = std::from_chars(cursor, end, value);
+		return result.ec == std::errc() ? result.ptr : cursor;
+	}
+
+	// Reads a (possibly negative) integer index, leaving it at 0 if there isn't one
+	const char* ReadIndex(const char* cursor, const char* end, int& value)
+	{
+		value = 0;
+		std::from_chars_result result = std::from_chars(cursor, end, value);
+		return result.ec == std::errc() ? result.ptr : cursor;
+	}
+
+	// Turns an OBJ index into a 1-based index, where negative
+	// indices count backwards from the most recent attribute
+	unsigned int ResolveIndex(int index, size_t count)
+	{
+		if (index < 0)
+			return (unsigned int)((long long)count + index + 1);
+		return (unsigned int)index;
+	}
+
+	// Finds the end of the line starting at the cursor
+	const char* FindLineEnd(const char* cursor, const char* end)
+	{
+		const char* lineEnd = (const char*)memchr(cursor, '\n', end - cursor);
+		return lineEnd ? lineEnd : end;
+	}
+
+	// Finds the start of the line after the one at the cursor
+	const char* NextLine(const char* cursor, const char* end)
+	{
+		const char* lineEnd = FindLineEnd(cursor, end);
+		return lineEnd < end ? lineEnd + 1 : end;
+	}
+
+	// How many of each kind of line a block of text holds
+	struct ObjCounts
+	{
+		size_t positions;
+		size_t normals;
+		size_t uvs;
+		size_t faces;
+	};
+
+	// A block of whole lines that is read independently of the others
+	struct ObjChunk
+	{
+		const char* begin;
+		const char* end;
+		ObjCounts counts;		// Lines of each kind inside this chunk
+		ObjCounts firstIndex;		// Lines of each kind in all earlier chunks
+		std::vector<ObjCorner> corners;	// Triangle corners read from this chunk
+	};
+
+	// Counts each type of line so the attribute lists never reallocate
+	ObjCounts CountLines(const char* text, const char* end)
+	{
+		ObjCounts counts = {};
+		for (const char* line = text; line < end; line = NextLine(line, end))
+		{
+			if (line[0] == 'v' && line + 1 < end)
+			{
+				if (line[1] == 'n') counts.normals++;
+				else if (line[1] == 't') counts.uvs++;
+				else if (IsSpace(line[1])) counts.positions++;
+			}
+			else if (line[0] == 'f')
+			{
+				counts.faces++;
+			}
+		}
+		return counts;
+	}
+
+	// --------------------------------------------------------
+	// Reads the attributes and faces out of one chunk of text,
+	// rebasing face indices by the earlier chunks' counts
+	// --------------------------------------------------------
+	void ReadChunk(ObjChunk& chunk, ObjData& obj)
+	{
+		// Where this chunk's attributes live in the shared lists
+		size_t positionCount = chunk.firstIndex.positions;
+		size_t normalCount = chunk.firstIndex.normals;
+		size_t uvCount = chunk.firstIndex.uvs;
+
+		chunk.corners.reserve(chunk.counts.faces * 3);
+
+		// Walk every line, reading the ones we care about
+		const char* end = chunk.end;
+		for (const char* line = chunk.begin; line < end; line = NextLine(line, end))
+		{
+			const char* lineEnd = FindLineEnd(line, end);
+
+			// Check the type of line
+			if (line[0] == 'v' && line + 1 < lineEnd && line[1] == 'n')
+			{
+				// Read the 3 numbers directly into an XMFLOAT3
+				XMFLOAT3& norm = obj.normals[normalCount++];
+				const char* cursor = ReadFloat(line + 2, lineEnd, norm.x);
+				cursor = ReadFloat(cursor, lineEnd, norm.y);
+				ReadFloat(cursor, lineEnd, norm.z);
+
+				// Flip normal's Z (LH vs. RH)
+				norm.z *= -1.0f;
+			}
+			else if (line[0] == 'v' && line + 1 < lineEnd && line[1] == 't')
+			{
+				// Read the 2 numbers directly into an XMFLOAT2
+				XMFLOAT2& uv = obj.uvs[uvCount++];
+				const char* cursor = ReadFloat(line + 2, lineEnd, uv.x);
+				ReadFloat(cursor, lineEnd, uv.y);
+
+				// Flip the UV's since they're probably "upside down", as DirectX
+				// defines (0,0) as the top left of the texture, and many
+				// 3D modeling packages use the bottom left as (0,0)
+				uv.y = 1.0f - uv.y;
+			}
+			else if (line[0] == 'v' && line + 1 < lineEnd && IsSpace(line[1]))
+			{
+				// Read the 3 numbers directly into an XMFLOAT3
+				XMFLOAT3& pos = obj.positions[positionCount++];
+				const char* cursor = ReadFloat(line + 1, lineEnd, pos.x);
+				cursor = ReadFloat(cursor, lineEnd, pos.y);
+				ReadFloat(cursor, lineEnd, pos.z);
+
+				// Flip Z (LH vs. RH)
+				pos.z *= -1.0f;
+			}
+			else if (line[0] == 'f')
+			{
+				// Walk the corners, fan triangulating as we go so
+				// faces with any number of corners are supported
+				ObjCorner first = {};
+				ObjCorner previous = {};
+				int cornerCount = 0;
+
+				const char* cursor = line + 1;
+				while (true)
+				{
+					cursor = SkipSpaces(cursor, lineEnd);
+					if (cursor >= lineEnd || *cursor == '#')
+						break;
+
+					// Corners look like "p", "p/t", "p//n" or "p/t/n"
+					int p = 0, t = 0, n = 0;
+					cursor = ReadIndex(cursor, lineEnd, p);
+					if (cursor < lineEnd && *cursor == '/')
+					{
+						cursor++;
+						if (cursor < lineEnd && *cursor != '/')
+							cursor = ReadIndex(cursor, lineEnd, t);
+						if (cursor < lineEnd && *cursor == '/')
+							cursor = ReadIndex(cursor + 1, lineEnd, n);
+					}
+
+					// Skip anything we couldn't make sense of
+					if (p == 0)
+					{
+						while (cursor < lineEnd && !IsSpace(*cursor))
+							cursor++;
+						continue;
+					}
+
+					ObjCorner corner;
+					corner.position = ResolveIndex(p, positionCount);
+					corner.uv = ResolveIndex(t, uvCount);
+					corner.normal = ResolveIndex(n, normalCount);
+
+					// Every corner past the second adds a triangle,
+					// flipping the winding order for LH space
+					if (cornerCount == 0)
+					{
+						first = corner;
+					}
+					else if (cornerCount >= 2)
+					{
+						chunk.corners.push_back(first);
+						chunk.corners.push_back(corner);
+						chunk.corners.push_back(previous);
+					}
+
+					previous = corner;
+					cornerCount++;
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Reads the attributes and faces out of the text
+	//
+	// - The text is split at line boundaries into one chunk per
+	//   thread, and each chunk is counted and then read on its own
+	// - A prefix sum over the chunk counts tells every chunk where
+	//   its attributes start, so the results match a serial read
+	// --------------------------------------------------------
+	void ReadObjData(const char* text, const char* end, unsigned int threadCount, ObjData& obj)
+	{
+		// Split the text into chunks of whole lines
+		std::vector<ObjChunk> chunks(threadCount);
+		size_t length = end - text;
+		const char* chunkBegin = text;
+		for (unsigned int i = 0; i < threadCount; i++)
+		{
+			const char* chunkEnd = end;
+			if (i + 1 < threadCount)
+			{
+				chunkEnd = text + length * (i + 1) / threadCount;
+				if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+				chunkEnd = NextLine(chunkEnd, end);
+			}
+
+			chunks[i].begin = chunkBegin;
+			chunks[i].end = chunkEnd;
+			chunkBegin = chunkEnd;
+		}
+
+		// Count the lines in every chunk
+		Parallel::RunParallel(threadCount, [&](unsigned int i)
+		{
+			chunks[i].counts = CountLines(chunks[i].begin, chunks[i].end);
+		});
+
+		// Prefix sum the counts so each chunk knows where its data goes
+		ObjCounts totals = {};
+		for (ObjChunk& chunk : chunks)
+		{
+			chunk.firstIndex = totals;
+			totals.positions += chunk.counts.positions;
+			totals.normals += chunk.counts.normals;
+			totals.uvs += chunk.counts.uvs;
+			totals.faces += chunk.counts.faces;
+		}
+
+		obj.positions.resize(totals.positions);
+		obj.normals.resize(totals.normals);
+		obj.uvs.resize(totals.uvs);
+
+		// Read every chunk
+		Parallel::RunParallel(threadCount, [&](unsigned int i)
+		{
+			ReadChunk(chunks[i], obj);
+		});
+
+		// Stitch the corners back together in file order
+		size_t cornerCount = 0;
+		for (ObjChunk& chunk : chunks)
+			cornerCount += chunk.corners.size();
+
+		obj.corners.reserve(cornerCount);
+		for (ObjChunk& chunk : chunks)
+			obj.corners.insert(obj.corners.end(), chunk.corners.begin(), chunk.corners.end());
+	}
+
+	// Checks that a corner only references data that's in the file
+	void ValidateCorner(const ObjCorner& corner, const ObjData& obj)
+	{
+		if (corner.position == 0 ||
+			corner.position > obj.positions.size() ||
+			corner.uv > obj.uvs.size() ||
+			corner.normal > obj.normals.size())
+			throw std::runtime_error("Error reading OBJ: Face references data that isn't in the file");
+	}
+
+	// Creates the vert by looking up the corresponding data
+	// - OBJ File indices are 1-based, so they need to be adusted
+	// - Missing uvs default to (0,0) in file space, which is (0,1) once flipped
+	Vertex MakeVertex(const ObjCorner& corner, const ObjData& obj)
+	{
+		Vertex vertex = {};
+		vertex.Position = obj.positions[corner.position - 1];
+		vertex.uv = corner.uv ? obj.uvs[corner.uv - 1] : XMFLOAT2(0.0f, 1.0f);
+		vertex.normal = corner.normal ? obj.normals[corner.normal - 1] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		return vertex;
+	}
+
+	// --------------------------------------------------------
+	// Turns the triangle corners into welded vertices and indices
+	//
+	// - Each unique position/uv/normal triple becomes exactly one
+	//   vertex, and every corner using it shares that vertex
+	// --------------------------------------------------------
+	MeshData BuildMeshData(const ObjData& obj)
+	{
+		MeshData data;
+		data.indices.reserve(obj.corners.size());
+		data.vertices.reserve(obj.positions.size());
+
+		std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> vertexLookup;
+		vertexLookup.reserve(obj.positions.size() * 2);
+
+		for (const ObjCorner& corner : obj.corners)
+		{
+			// Already made a vertex for this triple?
+			auto found = vertexLookup.find(corner);
+			if (found != vertexLookup.end())
+			{
+				data.indices.push_back(found->second);
+				continue;
+			}
+
+			ValidateCorner(corner, obj);
+
+			unsigned int index = (unsigned int)data.vertices.size();
+			data.vertices.push_back(MakeVertex(corner, obj));
+			data.indices.push_back(index);
+			vertexLookup.insert({ corner, index });
+		}
+
+		return data;
+	}
+
+	// --------------------------------------------------------
+	// Multithreaded version of BuildMeshData() with identical output
+	// - Corners are bucketed by hash, one bucket per thread
+	// --------------------------------------------------------
+	MeshData BuildMeshDataParallel(const ObjData& obj, unsigned int threadCount)
+	{
+		size_t cornerCount = obj.corners.size();
+
+		// Partition each thread's run of corners by hash
+		// - buckets[run * threadCount + owner] holds corner indices in order
+		std::vector<std::vector<unsigned int>> buckets(threadCount * threadCount);
+		Parallel::RunParallel(threadCount, [&](unsigned int t)
+		{
+			size_t begin = cornerCount * t / threadCount;
+			size_t end = cornerCount * (t + 1) / threadCount;
+			std::vector<unsigned int>* runBuckets = &buckets[t * threadCount];
+			for (unsigned int owner = 0; owner < threadCount; owner++)
+				runBuckets[owner].reserve((end - begin) / threadCount + 16);
+
+			for (size_t i = begin; i < end; i++)
+				runBuckets[ObjCornerHash::Partition(obj.corners[i], threadCount)].push_back((unsigned int)i);
+		});
+
+		// Find the first corner with the same triple as each corner
+		// - Runs are visited in order, so corners arrive in file order
+		std::vector<unsigned int> firstUse(cornerCount);
+		Parallel::RunParallel(threadCount, [&](unsigned int t)
+		{
+			std::unordered_map<ObjCorner, unsigned int, ObjCornerHash> lookup;
+			lookup.reserve(obj.positions.size() * 2 / threadCount + 1);
+
+			for (unsigned int run = 0; run < threadCount; run++)
+			{
+				for (unsigned int i : buckets[run * threadCount + t])
+				{
+					auto inserted = lookup.insert({ obj.corners[i], i });
+					firstUse[i] = inserted.first->second;
+				}
+			}
+		});
+
+		// Create a vertex at each first use, in order
+		MeshData data;
+		data.indices.resize(cornerCount);
+		data.vertices.reserve(obj.positions.size());
+		for (size_t i = 0; i < cornerCount; i++)
+		{
+			if (firstUse[i] == i)
+			{
+				ValidateCorner(obj.corners[i], obj);
+
+				// Remember the new vertex's index in place of this corner's
+				data.indices[i] = (unsigned int)data.vertices.size();
+				data.vertices.push_back(MakeVertex(obj.corners[i], obj));
+			}
+			else
+			{
+				// The first use always comes earlier, so its vertex exists already
+				data.indices[i] = data.indices[firstUse[i]];
+			}
+		}
+
+		return data;
+	}
+}
+
+
+// --------------------------------------------------------
+// Loads an OBJ file from disk
+// --------------------------------------------------------
+MeshData ObjLoader::Load(const char* filename, unsigned int threadCount)
+{
+	// Throws if the file can't be opened
+	MappedFile file(filename);
+	return Parse(file.GetData(), file.GetSize(), threadCount);
+}
+
+// --------------------------------------------------------
+// Parses OBJ text that is already in memory
+//
+// - A thread count of 0 picks one automatically, only going
+//   wide for files big enough to be worth it
+// --------------------------------------------------------
+MeshData ObjLoader::Parse(const char* text, size_t length, unsigned int threadCount)
+{
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		size_t chunksWorthReading = length / ParallelChunkSize + 1;
+		threadCount = (unsigned int)std::min<size_t>(chunksWorthReading, hardwareThreads > 0 ? hardwareThreads : 1);
+	}
+
+	ObjData obj;
+	ReadObjData(text, text + length, threadCount, obj);
+
+	if (threadCount > 1)
+		return BuildMeshDataParallel(obj, threadCount);
+	return BuildMeshData(obj);
+}
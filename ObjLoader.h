@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include "MeshData.h"
+
+// --------------------------------------------------------
+// Loads Wavefront OBJ files into welded, indexed mesh data
+// - Converted to D3D's left-handed space
+// - Large files are read on several threads
+// --------------------------------------------------------
+namespace ObjLoader
+{
+	// Roughly how many bytes of text each thread should get
+	// before it's worth spreading a file across threads
+	const size_t ParallelChunkSize = 4 * 1024 * 1024;
+
+	// A thread count of 0 picks one based on the file size
+	MeshData Load(const char* filename, unsigned int threadCount = 0);
+	MeshData Parse(const char* text, size_t length, unsigned int threadCount = 0);
+}
@@ -0,0 +1,151 @@
+#include "ObjectCache.h"
+#include "Graphics.h"
+#include "TransformSystem.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace DirectX;
+
+namespace
+{
+	// Changed entries closer together than this are sent in one
+	// update, unchanged ones between them included
+	const size_t MaxUploadGap = 16;
+}
+
+
+ObjectCache::ObjectCache()
+	: capacity(0),
+	lastUploadCount(0),
+	lastUploadBytes(0)
+{
+}
+
+// --------------------------------------------------------
+// Grows the arrays to the transform system's capacity
+// - New entries have never been prepared, so their first
+//   Prepare() always fills them in
+// --------------------------------------------------------
+void ObjectCache::Reserve(size_t slotCount)
+{
+	if (slotCount <= entries.size())
+		return;
+
+	Entry empty = {};
+	entries.resize(slotCount, empty);
+	objects.resize(slotCount);
+	pendingUpload.resize(slotCount, 0);
+}
+
+// --------------------------------------------------------
+// Recomputes an entry's data only if its transform has a
+// new version, and its bounds only then or if its mesh
+// changed
+// --------------------------------------------------------
+unsigned int ObjectCache::Prepare(unsigned int transformSlot, Mesh* mesh)
+{
+	unsigned int index = transformSlot;
+	unsigned int version = TransformSystem::GetVersion(transformSlot);
+
+	Entry& entry = entries[index];
+	if (entry.version == version && entry.mesh == mesh)
+		return index;
+
+	if (entry.version != version)
+	{
+		objects[index].world = TransformSystem::GetWorldMatrix(transformSlot);
+		objects[index].worldInvTranspose = TransformSystem::GetWorldInverseTranspose(transformSlot);
+		pendingUpload[index] = 1;
+	}
+
+	entry.version = version;
+	entry.mesh = mesh;
+	entry.worldSphere = mesh->GetWorldSphere(objects[index].world);
+	entry.worldBounds = mesh->GetWorldBounds(objects[index].world);
+	return index;
+}
+
+// --------------------------------------------------------
+// Sends each run of changed entries with one update
+//
+// - A new (bigger) buffer gets everything, as it starts out
+//   empty
+// --------------------------------------------------------
+void ObjectCache::Upload()
+{
+	lastUploadCount = 0;
+	lastUploadBytes = 0;
+	if (objects.empty())
+		return;
+
+	if (objects.size() > capacity)
+	{
+		capacity = std::max((unsigned int)objects.size(), capacity * 2);
+
+		D3D11_BUFFER_DESC desc = {};
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.ByteWidth = capacity * sizeof(InstanceData);
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.CPUAccessFlags = 0;
+		desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		desc.StructureByteStride = sizeof(InstanceData);
+
+		buffer.Reset();
+		srv.Reset();
+		if (FAILED(Graphics::Device->CreateBuffer(&desc, 0, buffer.GetAddressOf())))
+			throw std::runtime_error("Couldn't create the object buffer");
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = capacity;
+		if (FAILED(Graphics::Device->CreateShaderResourceView(buffer.Get(), &srvDesc, srv.GetAddressOf())))
+			throw std::runtime_error("Couldn't create the object buffer's view");
+
+		std::fill(pendingUpload.begin(), pendingUpload.end(), 1);
+	}
+
+	size_t index = 0;
+	while (index < objects.size())
+	{
+		if (!pendingUpload[index])
+		{
+			index++;
+			continue;
+		}
+
+		// Extend the run while the next change is close enough
+		size_t runStart = index;
+		size_t runEnd = index + 1;
+		for (size_t next = runEnd; next < objects.size() && next - runEnd < MaxUploadGap; next++)
+		{
+			if (pendingUpload[next])
+				runEnd = next + 1;
+		}
+
+		D3D11_BOX box = {};
+		box.left = (UINT)(runStart * sizeof(InstanceData));
+		box.right = (UINT)(runEnd * sizeof(InstanceData));
+		box.bottom = 1;
+		box.back = 1;
+		Graphics::Context->UpdateSubresource(buffer.Get(), 0, &box, &objects[runStart], 0, 0);
+
+		std::fill(pendingUpload.begin() + runStart, pendingUpload.begin() + runEnd, 0);
+		lastUploadCount += runEnd - runStart;
+		lastUploadBytes += (runEnd - runStart) * sizeof(InstanceData);
+		index = runEnd;
+	}
+}
+
+
+//--------
+// Getters
+//--------
+const InstanceData& ObjectCache::GetObjectData(unsigned int index) { return objects[index]; }
+const Sphere& ObjectCache::GetWorldSphere(unsigned int index) { return entries[index].worldSphere; }
+const Aabb& ObjectCache::GetWorldBounds(unsigned int index) { return entries[index].worldBounds; }
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ObjectCache::GetShaderResourceView() { return srv; }
+unsigned int ObjectCache::GetCapacity() { return capacity; }
+size_t ObjectCache::GetLastUploadCount() { return lastUploadCount; }
+size_t ObjectCache::GetLastUploadBytes() { return lastUploadBytes; }
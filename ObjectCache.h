@@ -0,0 +1,79 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+#include "Bounds.h"
+#include "Mesh.h"
+
+// --------------------------------------------------------
+// Per-object data for drawing
+// - Matches ObjectData in GlobalShaderStructs.hlsli
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 worldInvTranspose;
+};
+
+// --------------------------------------------------------
+// Everything derived from an entity's transform, cached
+// against the transform's version
+// - Indexed by transform slot, and mirrored on the GPU, where
+//   Upload() only sends the entries that changed
+// - Prepare() may run on several jobs at once, as long as no
+//   two of them are for the same transform
+// --------------------------------------------------------
+class ObjectCache
+{
+
+private:
+
+	struct Entry
+	{
+		unsigned int version;		// Transform version the entry was computed for (0: never)
+		const Mesh* mesh;			// Mesh the bounds are for
+		Sphere worldSphere;
+		Aabb worldBounds;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<InstanceData> objects;
+	std::vector<uint8_t> pendingUpload;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
+	unsigned int capacity;
+
+	// Reporting
+	size_t lastUploadCount;
+	size_t lastUploadBytes;
+
+public:
+
+	// Constructor
+	ObjectCache();
+
+	// Makes room for every transform slot
+	// - Call before any Prepare() in a frame, outside of jobs
+	void Reserve(size_t slotCount);
+
+	// Brings the entry for a transform slot (drawn with the given mesh)
+	// up to date and returns its index
+	unsigned int Prepare(unsigned int transformSlot, Mesh* mesh);
+
+	// Sends the entries that changed since the last call to the GPU
+	void Upload();
+
+	// Getters for data
+	const InstanceData& GetObjectData(unsigned int index);
+	const Sphere& GetWorldSphere(unsigned int index);
+	const Aabb& GetWorldBounds(unsigned int index);
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetShaderResourceView();
+	unsigned int GetCapacity();
+	size_t GetLastUploadCount();
+	size_t GetLastUploadBytes();
+
+};
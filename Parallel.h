@@ -0,0 +1,25 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Minimal fork/join helper shared by the import stages
+// --------------------------------------------------------
+namespace Parallel
+{
+	// Runs the function once for each index in [0, count) with one thread each
+	// - The calling thread handles index 0 itself
+	template<typename Func>
+	void RunParallel(unsigned int count, Func func)
+	{
+		std::vector<std::thread> workers;
+		for (unsigned int i = 1; i < count; i++)
+			workers.emplace_back(func, i);
+
+		func(0);
+
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+}
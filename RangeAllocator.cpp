@@ -0,0 +1,153 @@
+#include "RangeAllocator.h"
+#include <stdexcept>
+
+RangeAllocator::RangeAllocator(size_t capacity)
+	: capacity(0), used(0)
+{
+	Grow(capacity);
+}
+
+void RangeAllocator::AddFreeRange(size_t offset, size_t size)
+{
+	freeByOffset[offset] = size;
+	freeBySize.insert({ size, offset });
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<size_t, size_t>::iterator range)
+{
+	// Several ranges can share a size, so find this one's entry exactly
+	auto [first, last] = freeBySize.equal_range(range->second);
+	for (auto it = first; it != last; ++it)
+	{
+		if (it->second == range->first)
+		{
+			freeBySize.erase(it);
+			break;
+		}
+	}
+
+	freeByOffset.erase(range);
+}
+
+// --------------------------------------------------------
+// Best-fit allocation
+//
+// - The smallest free range that fits is split, with any
+//   leftover staying free, which keeps large ranges intact
+//   for large meshes
+// --------------------------------------------------------
+size_t RangeAllocator::Allocate(size_t size)
+{
+	if (size == 0)
+		throw std::invalid_argument("RangeAllocator can't allocate zero elements");
+
+	auto fit = freeBySize.lower_bound(size);
+	if (fit == freeBySize.end())
+		return InvalidOffset;
+
+	size_t offset = fit->second;
+	size_t rangeSize = fit->first;
+	RemoveFreeRange(freeByOffset.find(offset));
+
+	if (rangeSize > size)
+		AddFreeRange(offset + size, rangeSize - size);
+
+	allocations[offset] = size;
+	used += size;
+	return offset;
+}
+
+// --------------------------------------------------------
+// Frees an allocation, merging it with the free ranges
+// directly before and after it so free space doesn't
+// splinter into ever smaller pieces
+// --------------------------------------------------------
+void RangeAllocator::Free(size_t offset)
+{
+	auto allocation = allocations.find(offset);
+	if (allocation == allocations.end())
+		throw std::invalid_argument("RangeAllocator::Free() given an offset that isn't allocated");
+
+	size_t size = allocation->second;
+	allocations.erase(allocation);
+	used -= size;
+
+	// Merge with the free range after this one
+	auto next = freeByOffset.find(offset + size);
+	if (next != freeByOffset.end())
+	{
+		size += next->second;
+		RemoveFreeRange(next);
+	}
+
+	// And the one before it
+	auto previous = freeByOffset.lower_bound(offset);
+	if (previous != freeByOffset.begin())
+	{
+		--previous;
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeRange(previous);
+		}
+	}
+
+	AddFreeRange(offset, size);
+}
+
+// --------------------------------------------------------
+// Extends the space, merging the new part with a free
+// range at the old end if there is one
+// --------------------------------------------------------
+void RangeAllocator::Grow(size_t newCapacity)
+{
+	if (newCapacity <= capacity)
+		return;
+
+	size_t offset = capacity;
+	size_t size = newCapacity - capacity;
+	capacity = newCapacity;
+
+	if (!freeByOffset.empty())
+	{
+		auto last = std::prev(freeByOffset.end());
+		if (last->first + last->second == offset)
+		{
+			offset = last->first;
+			size += last->second;
+			RemoveFreeRange(last);
+		}
+	}
+
+	AddFreeRange(offset, size);
+}
+
+//---------------
+// Getter Methods
+//---------------
+
+size_t RangeAllocator::GetCapacity() const
+{
+	return capacity;
+}
+
+size_t RangeAllocator::GetUsed() const
+{
+	return used;
+}
+
+size_t RangeAllocator::GetAllocationCount() const
+{
+	return allocations.size();
+}
+
+size_t RangeAllocator::GetFreeRangeCount() const
+{
+	return freeByOffset.size();
+}
+
+size_t RangeAllocator::GetLargestFreeRange() const
+{
+	return freeBySize.empty() ? 0 : std::prev(freeBySize.end())->first;
+}
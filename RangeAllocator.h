@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// Hands out ranges of a fixed size space, such as the
+// elements of a large GPU buffer (best fit, merging freed
+// neighbours)
+// --------------------------------------------------------
+class RangeAllocator
+{
+
+private:
+
+	size_t capacity;
+	size_t used;
+
+	// Free ranges by offset (to merge neighbours) and by size (to find the best fit)
+	std::map<size_t, size_t> freeByOffset;
+	std::multimap<size_t, size_t> freeBySize;
+
+	// Size of every live allocation, by offset
+	std::unordered_map<size_t, size_t> allocations;
+
+	// Keeping both free lists in step
+	void AddFreeRange(size_t offset, size_t size);
+	void RemoveFreeRange(std::map<size_t, size_t>::iterator range);
+
+public:
+
+	// Returned by Allocate() when no free range is big enough
+	static const size_t InvalidOffset = (size_t)-1;
+
+	// Constructor
+	RangeAllocator(size_t capacity = 0);
+
+	// Takes the smallest free range that fits, returning its offset
+	// - Returns InvalidOffset if nothing fits (see Grow())
+	// - Zero sized allocations are not allowed
+	size_t Allocate(size_t size);
+
+	// Returns an allocation's range, merging it with free neighbours
+	// - Throws if the offset isn't a live allocation
+	void Free(size_t offset);
+
+	// Adds space at the end, keeping every allocation where it is
+	void Grow(size_t newCapacity);
+
+	// Getters for data
+	size_t GetCapacity() const;
+	size_t GetUsed() const;
+	size_t GetAllocationCount() const;
+	size_t GetFreeRangeCount() const;
+	size_t GetLargestFreeRange() const;
+
+};
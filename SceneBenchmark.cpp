@@ -0,0 +1,1125 @@
+#include "SceneBenchmark.h"
+#include "Bounds.h"
+#include "Bvh.h"
+#include "Culling.h"
+#include "EntityStore.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+#include "ObjLoader.h"
+#include "Tangents.h"
+#include "Transform.h"
+#include "TransformSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	// Entities per job when preparing draws
+	const size_t PrepareGrain = 256;
+
+	// One in this many entities hangs off another
+	const size_t ChildEvery = 4;
+
+	// What the renderer works out for each entity before drawing it
+	struct DrawData
+	{
+		XMFLOAT4X4 world;
+		XMFLOAT4X4 worldInvTranspose;
+		Sphere worldSphere;
+		Aabb worldBox;
+	};
+
+	double MsSince(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// How entities were stored before EntityStore: each one a
+	// separate heap transform and shared pointers, in a vector
+	struct LegacyEntity
+	{
+		std::shared_ptr<Transform> transform;
+		std::shared_ptr<Mesh> mesh;
+		std::shared_ptr<Material> material;
+		bool isStatic;
+	};
+
+	// What a draw list gathers from each entity
+	struct Gathered
+	{
+		std::vector<unsigned int> slots;
+		std::vector<Mesh*> meshes;
+		std::vector<Material*> materials;
+
+		void Resize(size_t count) { slots.resize(count); meshes.resize(count); materials.resize(count); }
+	};
+
+	// How Transform worked before TransformSystem: Euler angles and
+	// cached matrices in each object, recomputed lazily on read
+	class LegacyTransform
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 rotation;
+		XMFLOAT3 scale;
+		XMFLOAT3 forward;
+		XMFLOAT3 rightward;
+		XMFLOAT3 upward;
+		XMFLOAT4X4 worldMatrix;
+		XMFLOAT4X4 worldInverseTranspose;
+		bool dirty;
+
+		void UpdateWorldMatrix()
+		{
+			if (!dirty)
+				return;
+
+			XMMATRIX world = XMMatrixScaling(scale.x, scale.y, scale.z) *
+				XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) *
+				XMMatrixTranslation(position.x, position.y, position.z);
+			XMStoreFloat4x4(&worldMatrix, world);
+			XMStoreFloat4x4(&worldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+			UpdateDirectionalVectors();
+			dirty = false;
+		}
+
+		void UpdateDirectionalVectors()
+		{
+			XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+			XMStoreFloat3(&rightward, XMVector3Rotate(XMVectorSet(1, 0, 0, 0), rotationQuat));
+			XMStoreFloat3(&upward, XMVector3Rotate(XMVectorSet(0, 1, 0, 0), rotationQuat));
+			XMStoreFloat3(&forward, XMVector3Rotate(XMVectorSet(0, 0, 1, 0), rotationQuat));
+		}
+
+	public:
+		LegacyTransform()
+			: position(0, 0, 0), rotation(0, 0, 0), scale(1, 1, 1),
+			forward(0, 0, 1), rightward(1, 0, 0), upward(0, 1, 0), dirty(true)
+		{
+			XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
+			XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
+		}
+
+		void SetPosition(float x, float y, float z) { position = { x, y, z }; dirty = true; }
+		void SetRotation(float pitch, float yaw, float roll) { rotation = { pitch, yaw, roll }; dirty = true; }
+
+		void MoveAbsolute(float x, float y, float z)
+		{
+			position.x += x;
+			position.y += y;
+			position.z += z;
+			dirty = true;
+		}
+
+		void Rotate(float pitch, float yaw, float roll)
+		{
+			rotation.x += pitch;
+			rotation.y += yaw;
+			rotation.z += roll;
+			dirty = true;
+			UpdateDirectionalVectors();
+		}
+
+		void MoveRelative(float x, float y, float z)
+		{
+			XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+			XMFLOAT3 move;
+			XMStoreFloat3(&move, XMVector3Rotate(XMVectorSet(x, y, z, 0), rotationQuat));
+			MoveAbsolute(move.x, move.y, move.z);
+		}
+
+		XMFLOAT4X4 GetWorldMatrix() { UpdateWorldMatrix(); return worldMatrix; }
+		XMFLOAT4X4 GetWorldInverseTranspose() { return worldInverseTranspose; }
+		XMFLOAT3 GetForward() { return forward; }
+	};
+
+	// How Mesh read OBJ files before ObjLoader: a line at a time
+	// with getline and sscanf, three new vertices per triangle
+	MeshData LoadObjLegacy(const char* filename)
+	{
+		std::ifstream obj(filename);
+		if (!obj.is_open())
+			throw std::invalid_argument("Error opening file: Invalid file path or file is inaccessible");
+
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		MeshData data;
+		char chars[100];
+
+		while (obj.good())
+		{
+			obj.getline(chars, 100);
+
+			if (chars[0] == 'v' && chars[1] == 'n')
+			{
+				XMFLOAT3 norm;
+				sscanf(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+				normals.push_back(norm);
+			}
+			else if (chars[0] == 'v' && chars[1] == 't')
+			{
+				XMFLOAT2 uv;
+				sscanf(chars, "vt %f %f", &uv.x, &uv.y);
+				uvs.push_back(uv);
+			}
+			else if (chars[0] == 'v')
+			{
+				XMFLOAT3 pos;
+				sscanf(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+				positions.push_back(pos);
+			}
+			else if (chars[0] == 'f')
+			{
+				unsigned int i[12];
+				int numbersRead = sscanf(chars, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
+					&i[0], &i[1], &i[2], &i[3], &i[4], &i[5], &i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+
+				if (numbersRead == 1)
+				{
+					numbersRead = sscanf(chars, "f %d//%d %d//%d %d//%d %d//%d",
+						&i[0], &i[2], &i[3], &i[5], &i[6], &i[8], &i[9], &i[11]);
+					i[1] = i[4] = i[7] = i[10] = 1;
+					if (uvs.size() == 0)
+						uvs.push_back(XMFLOAT2(0, 0));
+				}
+
+				// Corners in file order, flipped into left-handed space
+				Vertex v[4] = {};
+				int cornerCount = (numbersRead == 12 || numbersRead == 8) ? 4 : 3;
+				for (int c = 0; c < cornerCount; c++)
+				{
+					v[c].Position = positions[i[c * 3] - 1];
+					v[c].uv = uvs[i[c * 3 + 1] - 1];
+					v[c].normal = normals[i[c * 3 + 2] - 1];
+					v[c].uv.y = 1.0f - v[c].uv.y;
+					v[c].Position.z *= -1.0f;
+					v[c].normal.z *= -1.0f;
+				}
+
+				const int order[6] = { 0, 2, 1, 0, 3, 2 };
+				for (int c = 0; c < (cornerCount == 4 ? 6 : 3); c++)
+				{
+					data.indices.push_back((unsigned int)data.vertices.size());
+					data.vertices.push_back(v[order[c]]);
+				}
+			}
+		}
+
+		return data;
+	}
+
+	// Writes a gently rolling grid of quads, side by side vertices,
+	// with every corner indexing its position, uv and normal
+	// - Kept under a million vertices so face lines fit the old
+	//   parser's 100 character buffer
+	void WriteGridObj(const std::string& filename, unsigned int side)
+	{
+		std::ofstream obj(filename, std::ios::binary | std::ios::trunc);
+		if (!obj.is_open())
+			throw std::runtime_error("Error writing benchmark OBJ file");
+
+		std::string text;
+		char line[128];
+		for (unsigned int row = 0; row < side; row++)
+		{
+			text.clear();
+			for (unsigned int column = 0; column < side; column++)
+			{
+				float x = column * 0.1f;
+				float z = row * 0.1f;
+				float slope = cosf(x) * 0.25f;
+				XMFLOAT3 normal;
+				XMStoreFloat3(&normal, XMVector3Normalize(XMVectorSet(-slope, 1.0f, 0.0f, 0.0f)));
+
+				text.append(line, snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", x, sinf(x) * 0.25f, z));
+				text.append(line, snprintf(line, sizeof(line), "vt %.6f %.6f\n", (float)column / (side - 1), (float)row / (side - 1)));
+				text.append(line, snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", normal.x, normal.y, normal.z));
+			}
+			obj.write(text.data(), text.size());
+		}
+
+		for (unsigned int row = 0; row + 1 < side; row++)
+		{
+			text.clear();
+			for (unsigned int column = 0; column + 1 < side; column++)
+			{
+				unsigned int a = row * side + column + 1;
+				unsigned int b = a + 1;
+				unsigned int c = a + side + 1;
+				unsigned int d = a + side;
+				text.append(line, snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d));
+			}
+			obj.write(text.data(), text.size());
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Builds the scene once, then runs the same frames at each
+// thread count
+// --------------------------------------------------------
+std::vector<SceneBenchmark::Result> SceneBenchmark::Run(size_t entityCount, int frameCount, std::vector<unsigned int> threadCounts)
+{
+	unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	if (threadCounts.empty())
+	{
+		for (unsigned int count = 1; count < hardwareThreads; count *= 2)
+			threadCounts.push_back(count);
+		threadCounts.push_back(hardwareThreads);
+	}
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> spread(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> angle(0.0f, XM_2PI);
+
+	std::vector<Transform> transforms(entityCount);
+	std::vector<size_t> roots;
+	for (size_t i = 0; i < entityCount; i++)
+	{
+		if (i % ChildEvery == ChildEvery - 1 && !roots.empty())
+		{
+			transforms[i].SetParent(&transforms[roots[random() % roots.size()]]);
+			transforms[i].SetPosition(0.0f, 2.0f, 0.0f);
+			transforms[i].SetScale(0.5f, 0.5f, 0.5f);
+			continue;
+		}
+
+		transforms[i].SetPosition(spread(random), 0.0f, spread(random));
+		transforms[i].SetRotation(0.0f, angle(random), 0.0f);
+		roots.push_back(i);
+	}
+
+	// Every entity shares one unit cube's bounds, as instances of one mesh would
+	Aabb localBox = { XMFLOAT3(0, 0, 0), XMFLOAT3(0.5f, 0.5f, 0.5f) };
+	Sphere localSphere = { XMFLOAT3(0, 0, 0), 0.87f };
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection,
+		XMMatrixLookToLH(XMVectorSet(0, 10, -500, 0), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)) *
+		XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+	Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+	std::vector<DrawData> draws(entityCount);
+	SphereList spheres;
+	spheres.Resize(entityCount);
+	std::vector<uint8_t> visible(entityCount);
+	unsigned int previousThreads = JobSystem::GetThreadCount();
+
+	std::vector<Result> results;
+	for (unsigned int threadCount : threadCounts)
+	{
+		JobSystem::Initialize(threadCount - 1);
+
+		Result result = {};
+		result.threadCount = JobSystem::GetThreadCount();
+
+		// One extra frame up front to warm the caches and the pool
+		for (int frame = -1; frame < frameCount; frame++)
+		{
+			for (size_t i : roots)
+				transforms[i].Rotate(0.0f, 0.01f, 0.0f);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			TransformSystem::UpdateDirty();
+			double transformMs = MsSince(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			JobSystem::ParallelFor(entityCount, PrepareGrain, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					DrawData& draw = draws[i];
+					draw.world = transforms[i].GetWorldMatrix();
+					draw.worldInvTranspose = transforms[i].GetWorldInverseTranspose();
+					draw.worldSphere = localSphere.Transform(draw.world);
+					draw.worldBox = localBox.Transform(draw.world);
+					spheres.Set(i, draw.worldSphere);
+				}
+
+				Culling::CullSpheres(frustum, spheres, begin, end, visible.data());
+			});
+			double prepareMs = MsSince(start);
+
+			if (frame >= 0)
+			{
+				result.transformMs += transformMs / frameCount;
+				result.prepareMs += prepareMs / frameCount;
+			}
+		}
+
+		result.visibleCount = std::count(visible.begin(), visible.end(), 1);
+		results.push_back(result);
+	}
+
+	// A pool of one thread is no pool at all
+	if (previousThreads > 1)
+		JobSystem::Initialize(previousThreads - 1);
+	else
+		JobSystem::Shutdown();
+
+	return results;
+}
+
+void SceneBenchmark::Print(size_t entityCount, const std::vector<Result>& results)
+{
+	printf("Scene benchmark - %zu entities\n", entityCount);
+	printf("%8s %14s %14s %14s %9s %10s\n", "Threads", "Transforms ms", "Prepare ms", "Total ms", "Speedup", "Visible");
+
+	double baseline = results.empty() ? 0.0 : results[0].transformMs + results[0].prepareMs;
+	for (const Result& result : results)
+	{
+		double total = result.transformMs + result.prepareMs;
+		printf("%8u %14.3f %14.3f %14.3f %8.2fx %10zu\n",
+			result.threadCount, result.transformMs, result.prepareMs, total, total > 0.0 ? baseline / total : 0.0, result.visibleCount);
+	}
+}
+
+
+// --------------------------------------------------------
+// Runs the same spawns, despawns and passes on both kinds of
+// storage, with no device needed
+// --------------------------------------------------------
+std::vector<SceneBenchmark::EntityResult> SceneBenchmark::RunEntities(size_t entityCount, size_t churnCount, int frameCount)
+{
+	churnCount = std::min(churnCount, entityCount);
+	std::vector<EntityResult> results;
+	Gathered gathered;
+
+	// Entity store
+	{
+		std::mt19937 random(1234);
+		EntityResult result = {};
+		result.storage = "EntityStore";
+		EntityStore store;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		store.Reserve(entityCount);
+		for (size_t i = 0; i < entityCount; i++)
+			store.Spawn(nullptr, nullptr);
+		result.spawnMs = MsSince(start);
+
+		for (int frame = -1; frame < frameCount; frame++)
+		{
+			start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < churnCount; i++)
+				store.Despawn(store.HandleAt(random() % store.Count()));
+			for (size_t i = 0; i < churnCount; i++)
+				store.Spawn(nullptr, nullptr);
+			double churnMs = MsSince(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			gathered.Resize(store.Count());
+			for (size_t i = 0; i < store.Count(); i++)
+			{
+				gathered.slots[i] = store.TransformAt(i).GetSlot();
+				gathered.meshes[i] = store.MeshAt(i).get();
+				gathered.materials[i] = store.MaterialAt(i).get();
+			}
+			double iterateMs = MsSince(start);
+
+			if (frame >= 0)
+			{
+				result.churnMs += churnMs / frameCount;
+				result.iterateMs += iterateMs / frameCount;
+			}
+		}
+
+		results.push_back(result);
+	}
+
+	// Vector of shared pointers
+	{
+		std::mt19937 random(1234);
+		EntityResult result = {};
+		result.storage = "Legacy";
+		std::vector<LegacyEntity> entities;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		entities.reserve(entityCount);
+		for (size_t i = 0; i < entityCount; i++)
+			entities.push_back({ std::make_shared<Transform>(), nullptr, nullptr, false });
+		result.spawnMs = MsSince(start);
+
+		for (int frame = -1; frame < frameCount; frame++)
+		{
+			start = std::chrono::high_resolution_clock::now();
+			for (size_t i = 0; i < churnCount; i++)
+			{
+				size_t position = random() % entities.size();
+				entities[position] = std::move(entities.back());
+				entities.pop_back();
+			}
+			for (size_t i = 0; i < churnCount; i++)
+				entities.push_back({ std::make_shared<Transform>(), nullptr, nullptr, false });
+			double churnMs = MsSince(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			gathered.Resize(entities.size());
+			for (size_t i = 0; i < entities.size(); i++)
+			{
+				gathered.slots[i] = entities[i].transform->GetSlot();
+				gathered.meshes[i] = entities[i].mesh.get();
+				gathered.materials[i] = entities[i].material.get();
+			}
+			double iterateMs = MsSince(start);
+
+			if (frame >= 0)
+			{
+				result.churnMs += churnMs / frameCount;
+				result.iterateMs += iterateMs / frameCount;
+			}
+		}
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void SceneBenchmark::PrintEntities(size_t entityCount, size_t churnCount, const std::vector<EntityResult>& results)
+{
+	printf("Entity benchmark - %zu entities, %zu despawned and respawned per frame\n", entityCount, churnCount);
+	printf("%12s %12s %12s %12s\n", "Storage", "Spawn ms", "Churn ms", "Iterate ms");
+	for (const EntityResult& result : results)
+		printf("%12s %12.3f %12.3f %12.3f\n", result.storage, result.spawnMs, result.churnMs, result.iterateMs);
+}
+
+
+// --------------------------------------------------------
+// Scatters spheres through a box around the camera, so
+// some are culled by every plane, then tests them all with
+// each kernel in turn
+// --------------------------------------------------------
+std::vector<SceneBenchmark::CullingResult> SceneBenchmark::RunCulling(size_t sphereCount, int frameCount)
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> spread(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> size(0.1f, 10.0f);
+
+	SphereList spheres;
+	spheres.Resize(sphereCount);
+	for (size_t i = 0; i < sphereCount; i++)
+	{
+		Sphere sphere = { XMFLOAT3(spread(random), spread(random) * 0.1f, spread(random)), size(random) };
+		spheres.Set(i, sphere);
+	}
+
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection,
+		XMMatrixLookToLH(XMVectorSet(0, 10, 0, 0), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0)) *
+		XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+	Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+	std::vector<uint8_t> visible(sphereCount);
+	std::vector<CullingResult> results;
+	for (Culling::Kernel kernel : { Culling::Kernel::Scalar, Culling::Kernel::Sse, Culling::Kernel::Avx })
+	{
+		if (!Culling::IsSupported(kernel))
+			continue;
+
+		CullingResult result = {};
+		result.kernel = Culling::GetName(kernel);
+
+		// One extra frame up front to warm the caches
+		for (int frame = -1; frame < frameCount; frame++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			result.visibleCount = Culling::CullSpheres(frustum, spheres, 0, sphereCount, visible.data(), kernel);
+			double cullMs = MsSince(start);
+
+			if (frame >= 0)
+				result.cullMs += cullMs / frameCount;
+		}
+
+		results.push_back(result);
+	}
+
+	return results;
+}
+
+void SceneBenchmark::PrintCulling(size_t sphereCount, const std::vector<CullingResult>& results)
+{
+	printf("Culling benchmark - %zu spheres\n", sphereCount);
+	printf("%14s %10s %9s %10s\n", "Kernel", "Cull ms", "Speedup", "Visible");
+
+	double baseline = results.empty() ? 0.0 : results[0].cullMs;
+	for (const CullingResult& result : results)
+	{
+		printf("%14s %10.3f %8.2fx %10zu\n",
+			result.kernel, result.cullMs, result.cullMs > 0.0 ? baseline / result.cullMs : 0.0, result.visibleCount);
+	}
+}
+
+
+// --------------------------------------------------------
+// Scatters boxes, moves a quarter of them and refits, then
+// runs queryCount of each query both ways
+// --------------------------------------------------------
+SceneBenchmark::BvhResults SceneBenchmark::RunBvh(size_t boxCount, int queryCount)
+{
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> spread(-1000.0f, 1000.0f);
+	std::uniform_real_distribution<float> size(0.1f, 5.0f);
+	std::uniform_real_distribution<float> nudge(-5.0f, 5.0f);
+	std::uniform_real_distribution<float> angle(0.0f, XM_2PI);
+
+	std::vector<Aabb> boxes(boxCount);
+	for (Aabb& box : boxes)
+	{
+		box.center = XMFLOAT3(spread(random), spread(random) * 0.1f, spread(random));
+		box.extents = XMFLOAT3(size(random), size(random), size(random));
+	}
+
+	BvhResults results = {};
+	Bvh bvh;
+	auto start = std::chrono::high_resolution_clock::now();
+	bvh.Build(boxes);
+	results.buildMs = MsSince(start);
+	results.builtCost = bvh.GetBuiltCost();
+
+	for (size_t i = 0; i < boxCount; i += 4)
+	{
+		boxes[i].center.x += nudge(random);
+		boxes[i].center.z += nudge(random);
+	}
+
+	start = std::chrono::high_resolution_clock::now();
+	bvh.Refit(boxes);
+	results.refitMs = MsSince(start);
+	results.refitCost = bvh.GetCost();
+
+	std::vector<unsigned int> items;
+	items.reserve(boxCount);
+
+	// Frustums from cameras in the middle, facing every which way
+	{
+		BvhQueryResult result = {};
+		result.query = "Frustum";
+		std::vector<Frustum> frustums;
+		for (int q = 0; q < queryCount; q++)
+		{
+			float yaw = angle(random);
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection,
+				XMMatrixLookToLH(XMVectorSet(0, 10, 0, 0), XMVectorSet(sinf(yaw), 0, cosf(yaw), 0), XMVectorSet(0, 1, 0, 0)) *
+				XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+			frustums.push_back(Frustum::FromMatrix(viewProjection));
+		}
+
+		start = std::chrono::high_resolution_clock::now();
+		for (const Frustum& frustum : frustums)
+		{
+			items.clear();
+			bvh.QueryFrustum(frustum, items);
+			result.hits += items.size();
+		}
+		result.bvhMs = MsSince(start) / queryCount;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (const Frustum& frustum : frustums)
+		{
+			items.clear();
+			for (unsigned int i = 0; i < (unsigned int)boxCount; i++)
+			{
+				if (frustum.IntersectsBox(boxes[i].center, boxes[i].extents))
+					items.push_back(i);
+			}
+		}
+		result.bruteForceMs = MsSince(start) / queryCount;
+		results.queries.push_back(result);
+	}
+
+	// Spheres about the size of an explosion's reach
+	{
+		BvhQueryResult result = {};
+		result.query = "Sphere";
+		std::vector<Sphere> spheres;
+		for (int q = 0; q < queryCount; q++)
+			spheres.push_back({ XMFLOAT3(spread(random), 0.0f, spread(random)), 50.0f });
+
+		start = std::chrono::high_resolution_clock::now();
+		for (const Sphere& sphere : spheres)
+		{
+			items.clear();
+			bvh.QuerySphere(sphere, items);
+			result.hits += items.size();
+		}
+		result.bvhMs = MsSince(start) / queryCount;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (const Sphere& sphere : spheres)
+		{
+			items.clear();
+			for (unsigned int i = 0; i < (unsigned int)boxCount; i++)
+			{
+				if (BvhTests::BoxTouchesSphere(boxes[i], sphere))
+					items.push_back(i);
+			}
+		}
+		result.bruteForceMs = MsSince(start) / queryCount;
+		results.queries.push_back(result);
+	}
+
+	// Level rays from random points, for the nearest box hit
+	{
+		BvhQueryResult result = {};
+		result.query = "Ray";
+		std::vector<XMFLOAT3> origins, directions;
+		for (int q = 0; q < queryCount; q++)
+		{
+			float yaw = angle(random);
+			origins.push_back(XMFLOAT3(spread(random), 0.0f, spread(random)));
+			directions.push_back(XMFLOAT3(sinf(yaw), 0.0f, cosf(yaw)));
+		}
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			Bvh::RayHit hit;
+			if (bvh.Raycast(origins[q], directions[q], 2000.0f, hit))
+				result.hits++;
+		}
+		result.bvhMs = MsSince(start) / queryCount;
+
+		start = std::chrono::high_resolution_clock::now();
+		for (int q = 0; q < queryCount; q++)
+		{
+			XMFLOAT3 inverseDirection(1.0f / directions[q].x, 1.0f / directions[q].y, 1.0f / directions[q].z);
+			float nearest = 2000.0f;
+			for (unsigned int i = 0; i < (unsigned int)boxCount; i++)
+			{
+				float distance;
+				if (BvhTests::RayEntersBox(boxes[i], origins[q], inverseDirection, nearest, distance))
+					nearest = distance;
+			}
+		}
+		result.bruteForceMs = MsSince(start) / queryCount;
+		results.queries.push_back(result);
+	}
+
+	return results;
+}
+
+void SceneBenchmark::PrintBvh(size_t boxCount, const BvhResults& results)
+{
+	printf("BVH benchmark - %zu boxes\n", boxCount);
+	printf("Build %.3f ms (cost %.2f), refit %.3f ms (cost %.2f)\n",
+		results.buildMs, results.builtCost, results.refitMs, results.refitCost);
+	printf("%10s %12s %16s %9s %10s\n", "Query", "BVH ms", "Brute force ms", "Speedup", "Hits");
+	for (const BvhQueryResult& result : results.queries)
+	{
+		printf("%10s %12.4f %16.4f %8.1fx %10zu\n", result.query, result.bvhMs, result.bruteForceMs,
+			result.bvhMs > 0.0 ? result.bruteForceMs / result.bvhMs : 0.0, result.hits);
+	}
+}
+
+
+// --------------------------------------------------------
+// Writes a grid of roughly the given size to a temporary
+// file, then loads it with each parser
+//
+// - Writing the file leaves it in the OS's file cache, so
+//   every load reads from memory and times only the parsing
+// --------------------------------------------------------
+SceneBenchmark::ObjResults SceneBenchmark::RunObjLoading(size_t megabytes, std::vector<unsigned int> threadCounts)
+{
+	// Each grid vertex writes about 160 bytes of vertex and face lines
+	unsigned int side = (unsigned int)sqrt(megabytes * 1024.0 * 1024.0 / 160.0);
+	side = std::clamp(side, 2u, 999u);
+
+	std::string filename = (std::filesystem::temp_directory_path() / "SceneBenchmark.obj").string();
+	WriteGridObj(filename, side);
+
+	ObjResults results = {};
+	results.fileBytes = (size_t)std::filesystem::file_size(filename);
+	double megabytesRead = results.fileBytes / (1024.0 * 1024.0);
+
+	auto time = [&](ObjLoaderResult result, auto load)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		MeshData data = load();
+		result.loadMs = MsSince(start);
+		result.megabytesPerSecond = megabytesRead / (result.loadMs / 1000.0);
+		result.vertexCount = data.vertices.size();
+		results.loaders.push_back(result);
+	};
+
+	time({ "getline/sscanf", 1, 0, 0, 0 }, [&]() { return LoadObjLegacy(filename.c_str()); });
+	for (unsigned int threadCount : threadCounts)
+		time({ "ObjLoader", threadCount, 0, 0, 0 }, [&]() { return ObjLoader::Load(filename.c_str(), threadCount); });
+
+	std::filesystem::remove(filename);
+	return results;
+}
+
+void SceneBenchmark::PrintObjLoading(const ObjResults& results)
+{
+	printf("OBJ loading benchmark - %.1f MB file\n", results.fileBytes / (1024.0 * 1024.0));
+	printf("%16s %8s %12s %10s %9s %10s\n", "Loader", "Threads", "Load ms", "MB/s", "Speedup", "Vertices");
+
+	double baseline = results.loaders.empty() ? 0.0 : results.loaders[0].loadMs;
+	for (const ObjLoaderResult& result : results.loaders)
+	{
+		printf("%16s %8u %12.1f %10.1f %8.2fx %10zu\n", result.loader, result.threadCount, result.loadMs,
+			result.megabytesPerSecond, result.loadMs > 0.0 ? baseline / result.loadMs : 0.0, result.vertexCount);
+	}
+}
+
+
+// --------------------------------------------------------
+// Builds a grid of about triangleCount triangles, then times
+// runCount passes over it with each method
+// --------------------------------------------------------
+std::vector<SceneBenchmark::TangentResult> SceneBenchmark::RunTangents(size_t triangleCount, int runCount)
+{
+	unsigned int quads = std::max((unsigned int)sqrt(triangleCount / 2.0), 1u);
+	unsigned int side = quads + 1;
+
+	MeshData data;
+	for (unsigned int z = 0; z < side; z++)
+	{
+		for (unsigned int x = 0; x < side; x++)
+		{
+			Vertex vertex = {};
+			vertex.Position = XMFLOAT3(x * 0.1f, sinf(x * 0.05f) * cosf(z * 0.03f), z * 0.1f);
+			vertex.uv = XMFLOAT2((float)x / quads, (float)z / quads);
+			vertex.normal = XMFLOAT3(0, 1, 0);
+			data.vertices.push_back(vertex);
+		}
+	}
+	for (unsigned int z = 0; z < quads; z++)
+	{
+		for (unsigned int x = 0; x < quads; x++)
+		{
+			unsigned int corner = z * side + x;
+			unsigned int quad[6] = { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 };
+			data.indices.insert(data.indices.end(), quad, quad + 6);
+		}
+	}
+
+	double millionTriangles = data.indices.size() / 3 / 1000000.0;
+	std::vector<TangentResult> results;
+	auto time = [&](TangentResult result, auto calculate)
+	{
+		// One extra run up front to warm the caches
+		for (int run = -1; run < runCount; run++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			calculate();
+			double calculateMs = MsSince(start);
+			if (run >= 0)
+				result.calculateMs += calculateMs / runCount;
+		}
+
+		result.millionTrianglesPerSecond = millionTriangles / (result.calculateMs / 1000.0);
+		results.push_back(result);
+	};
+
+	Vertex* vertices = data.vertices.data();
+	size_t vertexCount = data.vertices.size();
+	time({ "Scalar", 1, 0, 0 }, [&]() { Tangents::CalculateScalar(vertices, vertexCount, data.indices.data(), data.indices.size()); });
+
+	unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	for (unsigned int threadCount = 1; ; threadCount = std::min(threadCount * 2, hardwareThreads))
+	{
+		time({ "SSE", threadCount, 0, 0 }, [&]() { Tangents::Calculate(vertices, vertexCount, data.indices.data(), data.indices.size(), threadCount); });
+		if (threadCount == hardwareThreads)
+			break;
+	}
+
+	return results;
+}
+
+void SceneBenchmark::PrintTangents(size_t triangleCount, const std::vector<TangentResult>& results)
+{
+	printf("Tangent benchmark - %zu triangles\n", triangleCount);
+	printf("%8s %8s %14s %12s %9s\n", "Method", "Threads", "Calculate ms", "Mtris/s", "Speedup");
+
+	double baseline = results.empty() ? 0.0 : results[0].calculateMs;
+	for (const TangentResult& result : results)
+	{
+		printf("%8s %8u %14.3f %12.1f %8.2fx\n", result.method, result.threadCount, result.calculateMs,
+			result.millionTrianglesPerSecond, result.calculateMs > 0.0 ? baseline / result.calculateMs : 0.0);
+	}
+}
+
+
+// --------------------------------------------------------
+// Scatters transforms, then each frame moves and turns every
+// one and reads back its world matrix and inverse transpose,
+// as the renderer does for entities that all move
+// --------------------------------------------------------
+std::vector<SceneBenchmark::TransformResult> SceneBenchmark::RunTransforms(size_t transformCount, int frameCount)
+{
+	std::vector<TransformResult> results;
+	std::vector<XMFLOAT4X4> matrices(transformCount * 2);
+
+	auto run = [&](TransformResult result, auto& transforms, auto update, auto get)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> spread(-500.0f, 500.0f);
+		for (auto& transform : transforms)
+		{
+			get(transform).SetPosition(spread(random), 0.0f, spread(random));
+			get(transform).SetRotation(0.0f, spread(random), 0.0f);
+		}
+
+		// One extra frame up front to warm the caches
+		for (int frame = -1; frame < frameCount; frame++)
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			for (auto& transform : transforms)
+			{
+				get(transform).MoveAbsolute(0.0f, 0.0f, 0.01f);
+				get(transform).Rotate(0.0f, 0.01f, 0.0f);
+			}
+			double changeMs = MsSince(start);
+
+			start = std::chrono::high_resolution_clock::now();
+			update();
+			for (size_t i = 0; i < transformCount; i++)
+			{
+				matrices[i * 2] = get(transforms[i]).GetWorldMatrix();
+				matrices[i * 2 + 1] = get(transforms[i]).GetWorldInverseTranspose();
+			}
+			double matricesMs = MsSince(start);
+
+			if (frame >= 0)
+			{
+				result.changeMs += changeMs / frameCount;
+				result.matricesMs += matricesMs / frameCount;
+			}
+		}
+
+		results.push_back(result);
+	};
+
+	{
+		std::vector<Transform> transforms(transformCount);
+		run({ "TransformSystem", 0, 0 }, transforms, []() { TransformSystem::UpdateDirty(); }, [](Transform& transform) -> Transform& { return transform; });
+	}
+	{
+		std::vector<std::shared_ptr<LegacyTransform>> transforms;
+		for (size_t i = 0; i < transformCount; i++)
+			transforms.push_back(std::make_shared<LegacyTransform>());
+		run({ "Legacy", 0, 0 }, transforms, []() {}, [](std::shared_ptr<LegacyTransform>& transform) -> LegacyTransform& { return *transform; });
+	}
+
+	return results;
+}
+
+void SceneBenchmark::PrintTransforms(size_t transformCount, const std::vector<TransformResult>& results)
+{
+	printf("Transform benchmark - %zu transforms, all moving\n", transformCount);
+	printf("%16s %10s %12s %10s %9s\n", "Storage", "Change ms", "Matrices ms", "Total ms", "Speedup");
+
+	double baseline = results.empty() ? 0.0 : results.back().changeMs + results.back().matricesMs;
+	for (const TransformResult& result : results)
+	{
+		double total = result.changeMs + result.matricesMs;
+		printf("%16s %10.3f %12.3f %10.3f %8.2fx\n", result.storage, result.changeMs, result.matricesMs, total, total > 0.0 ? baseline / total : 0.0);
+	}
+}
+
+
+// --------------------------------------------------------
+// Builds each shape out of the same number of transforms,
+// then times both kinds of frame at one thread and at the
+// hardware's thread count
+//
+// - Reparenting moves the child's subtree in the update
+//   order, which is what it costs over a plain update
+// --------------------------------------------------------
+std::vector<SceneBenchmark::HierarchyResult> SceneBenchmark::RunHierarchy(size_t transformCount, int frameCount)
+{
+	struct Shape
+	{
+		const char* name;
+		size_t childrenPerRoot;
+		bool chained;		// Each child under the one before, rather than the root
+	};
+
+	const Shape shapes[] = { { "Deep", 99, true }, { "Wide", 99, false } };
+
+	unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<unsigned int> threadCounts = { 1 };
+	if (hardwareThreads > 1)
+		threadCounts.push_back(hardwareThreads);
+
+	unsigned int previousThreads = JobSystem::GetThreadCount();
+	std::vector<HierarchyResult> results;
+	for (const Shape& shape : shapes)
+	{
+		size_t familySize = shape.childrenPerRoot + 1;
+		size_t familyCount = std::max<size_t>(transformCount / familySize, 2);
+
+		std::vector<Transform> transforms(familyCount * familySize);
+		for (size_t family = 0; family < familyCount; family++)
+		{
+			Transform* root = &transforms[family * familySize];
+			root->SetPosition((float)family, 0.0f, 0.0f);
+			for (size_t i = 1; i < familySize; i++)
+			{
+				Transform& child = transforms[family * familySize + i];
+				child.SetParent(shape.chained ? &transforms[family * familySize + i - 1] : root);
+				child.SetPosition(0.0f, 0.1f, 0.0f);
+				child.SetRotation(0.0f, 0.01f, 0.0f);
+			}
+		}
+
+		for (unsigned int threadCount : threadCounts)
+		{
+			JobSystem::Initialize(threadCount - 1);
+			TransformSystem::UpdateDirty();
+
+			HierarchyResult result = { shape.name, 0, JobSystem::GetThreadCount(), 0, 0, 0 };
+			result.levels = TransformSystem::GetStats().hierarchyDepth;
+
+			// One extra frame up front to warm the caches and the pool
+			for (int frame = -1; frame < frameCount; frame++)
+			{
+				for (size_t family = 0; family < familyCount; family++)
+					transforms[family * familySize].Rotate(0.0f, 0.01f, 0.0f);
+
+				auto start = std::chrono::high_resolution_clock::now();
+				TransformSystem::UpdateDirty();
+				double updateMs = MsSince(start);
+
+				// The last child of one family moves to another family's root
+				size_t family = (frame + 1) % familyCount;
+				Transform& leaf = transforms[family * familySize + familySize - 1];
+				leaf.SetParent(&transforms[((family + 3 + (frame & 1)) % familyCount) * familySize]);
+
+				start = std::chrono::high_resolution_clock::now();
+				TransformSystem::UpdateDirty();
+				double reparentMs = MsSince(start);
+
+				// Then a burst of last children, alternating between the next
+				// two families' roots so every one of them really moves
+				start = std::chrono::high_resolution_clock::now();
+				for (size_t i = 0; i < ReparentsPerFrame; i++)
+				{
+					size_t from = ((frame + 1) * ReparentsPerFrame + i) % familyCount;
+					transforms[from * familySize + familySize - 1].SetParent(&transforms[((from + 1 + (frame & 1)) % familyCount) * familySize]);
+				}
+				TransformSystem::UpdateDirty();
+				double manyReparentsMs = MsSince(start);
+
+				if (frame >= 0)
+				{
+					result.updateMs += updateMs / frameCount;
+					result.reparentMs += reparentMs / frameCount;
+					result.manyReparentsMs += manyReparentsMs / frameCount;
+				}
+			}
+
+			results.push_back(result);
+		}
+	}
+
+	if (previousThreads > 1)
+		JobSystem::Initialize(previousThreads - 1);
+	else
+		JobSystem::Shutdown();
+
+	return results;
+}
+
+void SceneBenchmark::PrintHierarchy(size_t transformCount, const std::vector<HierarchyResult>& results)
+{
+	printf("Hierarchy benchmark - %zu transforms\n", transformCount);
+	char manyLabel[32];
+	snprintf(manyLabel, sizeof(manyLabel), "Reparent x%zu ms", ReparentsPerFrame);
+	printf("%8s %8s %8s %12s %14s %18s\n", "Shape", "Levels", "Threads", "Update ms", "Reparent ms", manyLabel);
+	for (const HierarchyResult& result : results)
+		printf("%8s %8u %8u %12.3f %14.3f %18.3f\n", result.shape, result.levels, result.threadCount, result.updateMs, result.reparentMs, result.manyReparentsMs);
+}
+
+
+// --------------------------------------------------------
+// Makes callCount calls of each kind on a single transform,
+// with small turns like a mouse look's
+// --------------------------------------------------------
+std::vector<SceneBenchmark::RotationResult> SceneBenchmark::RunRotations(int callCount)
+{
+	std::vector<RotationResult> results;
+	float sink = 0.0f;
+
+	auto run = [&](RotationResult result, auto& transform)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < callCount; i++)
+			transform.Rotate(0.001f, 0.002f, 0.0f);
+		result.rotateNs = MsSince(start) * 1000000.0 / callCount;
+
+		// Turning between moves, as a camera does, so nothing built
+		// from the rotation can be hoisted out of the loop
+		start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < callCount; i++)
+		{
+			transform.Rotate(0.001f, 0.002f, 0.0f);
+			transform.MoveRelative(0.0f, 0.0f, 0.01f);
+			sink += transform.GetForward().x + transform.GetWorldMatrix()._41;
+		}
+		result.cameraNs = MsSince(start) * 1000000.0 / callCount;
+
+		results.push_back(result);
+	};
+
+	Transform transform;
+	run({ "Quaternion", 0, 0 }, transform);
+	LegacyTransform legacy;
+	run({ "Euler", 0, 0 }, legacy);
+
+	// Keeps the reads from being optimized away
+	if (sink == 12345.0f)
+		printf(" ");
+
+	return results;
+}
+
+void SceneBenchmark::PrintRotations(int callCount, const std::vector<RotationResult>& results)
+{
+	printf("Rotation benchmark - %d calls each\n", callCount);
+	printf("%12s %12s %12s\n", "Storage", "Rotate ns", "Camera ns");
+	for (const RotationResult& result : results)
+		printf("%12s %12.1f %12.1f\n", result.storage, result.rotateNs, result.cameraNs);
+}
+
+
+// --------------------------------------------------------
+// Everything -benchmark runs, in order
+// --------------------------------------------------------
+void SceneBenchmark::PrintAll()
+{
+	const size_t entityCount = 50000;
+	Print(entityCount, Run(entityCount));
+	printf("\n");
+	PrintTransforms(100000, RunTransforms(100000));
+	printf("\n");
+	PrintHierarchy(100000, RunHierarchy(100000));
+	printf("\n");
+	PrintRotations(1000000, RunRotations(1000000));
+	printf("\n");
+	PrintEntities(entityCount, 5000, RunEntities(entityCount, 5000));
+	printf("\n");
+	PrintCulling(100000, RunCulling(100000));
+	printf("\n");
+	PrintBvh(100000, RunBvh(100000));
+	printf("\n");
+	PrintObjLoading(RunObjLoading(128));
+	printf("\n");
+	PrintTangents(2000000, RunTangents(2000000));
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// --------------------------------------------------------
+// Times a frame's CPU-side scene work on a synthetic scene,
+// at several job system sizes
+// - Runs headless (see -benchmark in Main.cpp)
+// --------------------------------------------------------
+namespace SceneBenchmark
+{
+	struct Result
+	{
+		unsigned int threadCount;
+		double transformMs;		// Per frame, TransformSystem::UpdateDirty()
+		double prepareMs;		// Per frame, per-draw data and culling
+		size_t visibleCount;	// Entities inside the frustum on the last frame
+	};
+
+	// Thread counts default to 1, 2, 4, 8, ... up to the hardware's
+	std::vector<Result> Run(size_t entityCount = 50000, int frameCount = 60, std::vector<unsigned int> threadCounts = {});
+
+	// Prints a table of results to stdout
+	void Print(size_t entityCount, const std::vector<Result>& results);
+
+	// Entity storage: an EntityStore against the vector of entities
+	// holding shared pointers it replaced, with the same work on each
+	// - Spawning fills an empty scene
+	// - Each frame despawns churnCount random entities and spawns as
+	//   many new ones, then walks every entity gathering what a draw
+	//   list needs (transform slot, mesh and material)
+	struct EntityResult
+	{
+		const char* storage;
+		double spawnMs;			// Filling the scene once
+		double churnMs;			// Per frame, despawning and respawning
+		double iterateMs;		// Per frame, one pass over every entity
+	};
+
+	std::vector<EntityResult> RunEntities(size_t entityCount = 50000, size_t churnCount = 5000, int frameCount = 60);
+	void PrintEntities(size_t entityCount, size_t churnCount, const std::vector<EntityResult>& results);
+
+	// Frustum culling: every kernel the CPU supports (see Culling),
+	// on one thread, over the same scattered spheres
+	struct CullingResult
+	{
+		const char* kernel;
+		double cullMs;			// Per frame, testing every sphere once
+		size_t visibleCount;
+	};
+
+	std::vector<CullingResult> RunCulling(size_t sphereCount = 100000, int frameCount = 100);
+	void PrintCulling(size_t sphereCount, const std::vector<CullingResult>& results);
+
+	// Bounding volume hierarchy: building and refitting a Bvh over
+	// scattered boxes, then the same frustum, sphere and ray queries
+	// through it and by testing every box
+	struct BvhQueryResult
+	{
+		const char* query;
+		double bvhMs;			// Per query
+		double bruteForceMs;
+		size_t hits;			// Over all queries, the same both ways
+	};
+
+	struct BvhResults
+	{
+		double buildMs;
+		double refitMs;			// After a quarter of the boxes moved
+		float builtCost;		// Surface area heuristic cost, see Bvh
+		float refitCost;
+		std::vector<BvhQueryResult> queries;
+	};
+
+	BvhResults RunBvh(size_t boxCount = 100000, int queryCount = 100);
+	void PrintBvh(size_t boxCount, const BvhResults& results);
+
+	// OBJ loading: ObjLoader at each thread count against the getline
+	// and sscanf parser it replaced, reading the same synthetic grid
+	struct ObjLoaderResult
+	{
+		const char* loader;
+		unsigned int threadCount;
+		double loadMs;
+		double megabytesPerSecond;
+		size_t vertexCount;		// The old parser doesn't weld, so has more
+	};
+
+	struct ObjResults
+	{
+		size_t fileBytes;
+		std::vector<ObjLoaderResult> loaders;
+	};
+
+	ObjResults RunObjLoading(size_t megabytes = 128, std::vector<unsigned int> threadCounts = { 1, 2, 4, 8, 16 });
+	void PrintObjLoading(const ObjResults& results);
+
+	// Tangent generation: Tangents::Calculate() at each thread count
+	// against the scalar version, on a bumpy grid
+	struct TangentResult
+	{
+		const char* method;
+		unsigned int threadCount;
+		double calculateMs;
+		double millionTrianglesPerSecond;
+	};
+
+	std::vector<TangentResult> RunTangents(size_t triangleCount = 2000000, int runCount = 10);
+	void PrintTangents(size_t triangleCount, const std::vector<TangentResult>& results);
+
+	// Transforms: the same moves and matrix reads on TransformSystem
+	// handles and on the heap allocated Transform class it replaced,
+	// each on one thread
+	struct TransformResult
+	{
+		const char* storage;
+		double changeMs;		// Per frame, moving and turning every transform
+		double matricesMs;		// Per frame, updating and reading every world matrix
+	};
+
+	std::vector<TransformResult> RunTransforms(size_t transformCount = 100000, int frameCount = 60);
+	void PrintTransforms(size_t transformCount, const std::vector<TransformResult>& results);
+
+	// Hierarchies: TransformSystem::UpdateDirty() on a deep shape
+	// (long chains) and a wide one (roots with many children), with
+	// every root turning so every child has to be composed again
+	struct HierarchyResult
+	{
+		const char* shape;
+		unsigned int levels;		// Below the roots
+		unsigned int threadCount;
+		double updateMs;			// Per frame, after the roots turn
+		double reparentMs;			// Per frame, after one child moves to another root
+		double manyReparentsMs;		// Per frame, moving ReparentsPerFrame children and updating
+	};
+
+	const size_t ReparentsPerFrame = 1000;
+
+	std::vector<HierarchyResult> RunHierarchy(size_t transformCount = 100000, int frameCount = 60);
+	void PrintHierarchy(size_t transformCount, const std::vector<HierarchyResult>& results);
+
+	// Rotation storage: a camera's per-frame calls on Transform's
+	// stored quaternion and on the old Euler angles, which built a
+	// quaternion from them on every call
+	struct RotationResult
+	{
+		const char* storage;
+		double rotateNs;		// Per Rotate()
+		double cameraNs;		// Per Rotate(), MoveRelative(), GetForward() and GetWorldMatrix()
+	};
+
+	std::vector<RotationResult> RunRotations(int callCount = 1000000);
+	void PrintRotations(int callCount, const std::vector<RotationResult>& results);
+
+	// Runs every benchmark above at its usual size and prints them
+	void PrintAll();
+}
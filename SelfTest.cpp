@@ -0,0 +1,1531 @@
+#include "SelfTest.h"
+#include "Bounds.h"
+#include "Bvh.h"
+#include "Culling.h"
+#include "EntityStore.h"
+#include "FileRegistry.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "RangeAllocator.h"
+#include "ObjLoader.h"
+#include "StaticBatching.h"
+#include "Tangents.h"
+#include "Transform.h"
+#include "TransformSystem.h"
+#include "VertexPacking.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <cstdint>
+#include <cstdarg>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	int checkCount = 0;
+	int failureCount = 0;
+
+	// Counts the check, printing the message if it failed
+	void Check(bool passed, const char* format, ...)
+	{
+		checkCount++;
+		if (passed)
+			return;
+
+		failureCount++;
+		printf("FAILED: ");
+		va_list args;
+		va_start(args, format);
+		vprintf(format, args);
+		va_end(args);
+		printf("\n");
+	}
+
+	// Every .obj file in the directory, in name order
+	std::vector<std::string> FindModels(const std::string& directory)
+	{
+		std::vector<std::string> models;
+		for (const auto& entry : std::filesystem::directory_iterator(directory))
+		{
+			if (entry.path().extension() == ".obj")
+				models.push_back(entry.path().string());
+		}
+		std::sort(models.begin(), models.end());
+		return models;
+	}
+
+	// A triangle's vertices as raw bytes, rotated so the smallest comes
+	// first, which keeps the winding but ignores where it starts
+	using TriangleKey = std::array<Vertex, 3>;
+
+	bool VertexLess(const Vertex& a, const Vertex& b)
+	{
+		return memcmp(&a, &b, sizeof(Vertex)) < 0;
+	}
+
+	bool SameTriangles(const std::vector<TriangleKey>& a, const std::vector<TriangleKey>& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(TriangleKey)) == 0;
+	}
+
+	std::vector<TriangleKey> SortedTriangles(const MeshData& data)
+	{
+		std::vector<TriangleKey> triangles;
+		for (size_t i = 0; i + 2 < data.indices.size(); i += 3)
+		{
+			TriangleKey triangle = { data.vertices[data.indices[i]], data.vertices[data.indices[i + 1]], data.vertices[data.indices[i + 2]] };
+			while (VertexLess(triangle[1], triangle[0]) || VertexLess(triangle[2], triangle[0]))
+				std::rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+			triangles.push_back(triangle);
+		}
+
+		std::sort(triangles.begin(), triangles.end(), [](const TriangleKey& a, const TriangleKey& b)
+		{
+			return memcmp(a.data(), b.data(), sizeof(TriangleKey)) < 0;
+		});
+		return triangles;
+	}
+
+	// --------------------------------------------------------
+	// Loads each bundled model, which must weld down to one
+	// vertex per distinct position/uv/normal triple in the file,
+	// and come out the same however many threads read it
+	// --------------------------------------------------------
+	void TestObjLoader(const std::vector<std::string>& models)
+	{
+		struct WeldedCounts { const char* name; size_t vertexCount; size_t indexCount; };
+		const WeldedCounts expected[] =
+		{
+			{ "cube.obj", 48, 72 },
+			{ "cylinder.obj", 130, 372 },
+			{ "helix.obj", 4864, 14472 },
+			{ "quad.obj", 4, 6 },
+			{ "quad_double_sided.obj", 8, 12 },
+			{ "sphere.obj", 559, 2880 },
+			{ "torus.obj", 861, 4800 },
+		};
+
+		for (const std::string& model : models)
+		{
+			MeshData data = ObjLoader::Load(model.c_str());
+			std::string name = std::filesystem::path(model).filename().string();
+			for (const WeldedCounts& counts : expected)
+			{
+				if (name != counts.name)
+					continue;
+
+				Check(data.vertices.size() == counts.vertexCount && data.indices.size() == counts.indexCount,
+					"%s: Welded to %zu vertices and %zu indices, expected %zu and %zu",
+					model.c_str(), data.vertices.size(), data.indices.size(), counts.vertexCount, counts.indexCount);
+			}
+
+			MeshData serial = ObjLoader::Load(model.c_str(), 1);
+			for (unsigned int threadCount : { 2u, 4u, 8u, 16u })
+			{
+				MeshData parallel = ObjLoader::Load(model.c_str(), threadCount);
+				bool same =
+					parallel.indices == serial.indices &&
+					parallel.vertices.size() == serial.vertices.size() &&
+					memcmp(parallel.vertices.data(), serial.vertices.data(), serial.vertices.size() * sizeof(Vertex)) == 0;
+				Check(same, "%s: Reading on %u threads gave a different mesh than on one", model.c_str(), threadCount);
+			}
+		}
+	}
+
+	// Whether two arrays of plain structs hold the same bytes
+	template<typename T> bool SameBytes(const T* a, const T* b, size_t count)
+	{
+		return count == 0 || memcmp(a, b, count * sizeof(T)) == 0;
+	}
+
+	// --------------------------------------------------------
+	// Writes each model's import to a cache file and maps it
+	// back, which must only validate for the same source hash
+	// and flags, and must hold exactly what was written
+	// --------------------------------------------------------
+	void TestMeshCache(const std::vector<std::string>& models)
+	{
+		Check(MeshCache::CachePathFor("a.obj", 0) != MeshCache::CachePathFor("a.obj", MeshCache::FlagOverdrawOptimized),
+			"Cache: Both import variants share a cache path");
+
+		std::string cachePath = (std::filesystem::temp_directory_path() / "SelfTest.meshcache").string();
+		for (const std::string& model : models)
+		{
+			MappedFile source(model.c_str());
+			uint64_t sourceHash = MeshCache::HashContents(source.GetData(), source.GetSize());
+			MeshData data = ObjLoader::Parse(source.GetData(), source.GetSize());
+			VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+			MeshSimplifier::BuildLodChain(data);
+			MeshOptimizer::OptimizeVertexFetch(data);
+			data.meshlets = Meshlets::Build(data.vertices.data(), data.vertices.size(), data.indices.data(), data.lods[0].indexCount);
+			Sphere sphere = Sphere::FromVertices(data.vertices.data(), data.vertices.size());
+
+			uint32_t flags = MeshCache::FlagOverdrawOptimized;
+			if (!MeshCache::Write(cachePath.c_str(), data, sourceHash, flags, stats, 2.0f, 1.5f, sphere))
+			{
+				Check(false, "%s: Couldn't write %s", model.c_str(), cachePath.c_str());
+				continue;
+			}
+
+			{
+				MappedFile cache(cachePath.c_str());
+				const MeshCache::Header* header = MeshCache::Validate(cache.GetData(), cache.GetSize(), sourceHash, flags);
+				Check(header != nullptr, "%s: Cache didn't validate against its own source", model.c_str());
+				Check(!MeshCache::Validate(cache.GetData(), cache.GetSize(), sourceHash + 1, flags), "%s: Cache validated after the source changed", model.c_str());
+				Check(!MeshCache::Validate(cache.GetData(), cache.GetSize(), sourceHash, 0), "%s: Cache validated with other import flags", model.c_str());
+				Check(!MeshCache::Validate(cache.GetData(), cache.GetSize() - 1, sourceHash, flags), "%s: Cache validated when cut short", model.c_str());
+				if (!header)
+					continue;
+
+				bool same =
+					header->vertexCount == data.vertices.size() && header->indexCount == data.indices.size() &&
+					header->meshletCount == data.meshlets.size() && header->lodCount == data.lods.size() &&
+					SameBytes(MeshCache::GetVertices(header), data.vertices.data(), data.vertices.size()) &&
+					SameBytes(MeshCache::GetIndices(header), data.indices.data(), data.indices.size()) &&
+					SameBytes(MeshCache::GetMeshlets(header), data.meshlets.data(), data.meshlets.size()) &&
+					SameBytes(MeshCache::GetLods(header), data.lods.data(), data.lods.size());
+				Check(same, "%s: Cache read back different data than was written", model.c_str());
+				Check(header->unoptimizedACMR == stats.acmr && header->overdraw == 1.5f && header->sphereRadius == sphere.radius,
+					"%s: Cache header read back different stats than were written", model.c_str());
+			}
+		}
+		std::filesystem::remove(cachePath);
+	}
+
+	// --------------------------------------------------------
+	// Runs each model through the import's reordering passes,
+	// which must keep every triangle (and its winding) and
+	// never leave the vertex cache worse off
+	// --------------------------------------------------------
+	void TestMeshOptimizer(const std::vector<std::string>& models)
+	{
+		for (const std::string& model : models)
+		{
+			MeshData data = ObjLoader::Load(model.c_str());
+			VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+			std::vector<TriangleKey> trianglesBefore = SortedTriangles(data);
+
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+			MeshOptimizer::OptimizeOverdraw(data.indices, data.vertices);
+			MeshOptimizer::OptimizeVertexFetch(data);
+
+			VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(data.indices.data(), data.indices.size(), data.vertices.size());
+			Check(after.acmr <= before.acmr, "%s: ACMR went from %.3f to %.3f", model.c_str(), before.acmr, after.acmr);
+			Check(after.atvr <= before.atvr, "%s: ATVR went from %.3f to %.3f", model.c_str(), before.atvr, after.atvr);
+			Check(SameTriangles(SortedTriangles(data), trianglesBefore), "%s: Optimizing changed the triangles", model.c_str());
+		}
+	}
+
+	// Angle between two directions in degrees, in double precision
+	double DegreesBetween(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		double ax = a.x, ay = a.y, az = a.z, bx = b.x, by = b.y, bz = b.z;
+		double cx = ay * bz - az * by, cy = az * bx - ax * bz, cz = ax * by - ay * bx;
+		return atan2(sqrt(cx * cx + cy * cy + cz * cz), ax * bx + ay * by + az * bz) * 180.0 / XM_PI;
+	}
+
+	// --------------------------------------------------------
+	// Packs and unpacks every model's vertices, then directions
+	// on the octahedron's poles, edges and seams, which must
+	// all come back within the quantization's error bounds
+	// --------------------------------------------------------
+	void TestVertexPacking(const std::vector<std::string>& models)
+	{
+		for (const std::string& model : models)
+		{
+			MeshData data = ObjLoader::Load(model.c_str());
+			XMFLOAT3 boundsMin, boundsMax;
+			VertexPacking::ComputeBounds(data.vertices.data(), data.vertices.size(), boundsMin, boundsMax);
+			PositionQuantization quantization = VertexPacking::QuantizationFromBounds(boundsMin, boundsMax);
+			PackingError error = VertexPacking::MeasureError(data.vertices.data(), data.vertices.size(), quantization);
+
+			// Rounding moves each axis at most half a step, plus float rounding
+			XMVECTOR halfStep = XMLoadFloat3(&quantization.scale) * (0.5f / 65535.0f);
+			float positionLimit = XMVectorGetX(XMVector3Length(halfStep)) * 1.01f + 1e-6f;
+			Check(error.position <= positionLimit, "%s: Packed positions are off by %g, over the limit of %g", model.c_str(), error.position, positionLimit);
+			Check(error.normalDegrees <= VertexPacking::OctahedralErrorDegrees, "%s: Packed normals are off by %g degrees", model.c_str(), error.normalDegrees);
+		}
+
+		// Poles, the edges between octants in both halves, and the
+		// seam where the lower half folds, from either side of z = 0
+		std::vector<XMFLOAT3> directions;
+		for (float z : { 1.0f, -1.0f })
+			directions.push_back(XMFLOAT3(0, 0, z));
+		for (int i = 0; i < 3600; i++)
+		{
+			float angle = XM_2PI * i / 3600.0f;
+			float x = cosf(angle), y = sinf(angle);
+			for (float z : { 0.0f, 1e-6f, -1e-6f, 0.5f, -0.5f })
+			{
+				directions.push_back(XMFLOAT3(x, y, z));
+				directions.push_back(XMFLOAT3(x, z, y));
+				directions.push_back(XMFLOAT3(z, x, y));
+			}
+		}
+
+		double worst = 0.0;
+		for (XMFLOAT3 direction : directions)
+		{
+			XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+			short encoded[2];
+			VertexPacking::EncodeOctahedral(direction, encoded);
+			worst = std::max(worst, DegreesBetween(direction, VertexPacking::DecodeOctahedral(encoded)));
+		}
+		Check(worst <= VertexPacking::OctahedralErrorDegrees, "Octahedral: Directions on the poles and seams are off by %g degrees", worst);
+	}
+
+	// A flat grid of quads in the XZ plane, every triangle
+	// facing up (+Y) with D3D's clockwise winding
+	MeshData MakeGrid(unsigned int quads)
+	{
+		MeshData data;
+		unsigned int side = quads + 1;
+		for (unsigned int z = 0; z < side; z++)
+		{
+			for (unsigned int x = 0; x < side; x++)
+			{
+				Vertex vertex = {};
+				vertex.Position = XMFLOAT3((float)x, 0.0f, (float)z);
+				vertex.uv = XMFLOAT2((float)x / quads, (float)z / quads);
+				vertex.normal = XMFLOAT3(0, 1, 0);
+				data.vertices.push_back(vertex);
+			}
+		}
+
+		for (unsigned int z = 0; z < quads; z++)
+		{
+			for (unsigned int x = 0; x < quads; x++)
+			{
+				unsigned int corner = z * side + x;
+				unsigned int quad[6] = { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 };
+				data.indices.insert(data.indices.end(), quad, quad + 6);
+			}
+		}
+		return data;
+	}
+
+	// --------------------------------------------------------
+	// Checks every meshlet of a mesh: the limits, that together
+	// they cover the indices in order, that the sphere holds all
+	// of their vertices, and that the cone only rejects a meshlet
+	// when all of its triangles face away from the camera
+	// --------------------------------------------------------
+	void CheckMeshlets(const char* name, const MeshData& data, unsigned int maxVertices, unsigned int maxTriangles)
+	{
+		std::vector<Meshlet> meshlets = Meshlets::Build(data.vertices.data(), data.vertices.size(),
+			data.indices.data(), data.indices.size(), maxVertices, maxTriangles);
+
+		// Cameras scattered around (and inside) the mesh's bounds
+		XMVECTOR boundsMin = XMLoadFloat3(&data.vertices[0].Position);
+		XMVECTOR boundsMax = boundsMin;
+		for (const Vertex& vertex : data.vertices)
+		{
+			boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&vertex.Position));
+			boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&vertex.Position));
+		}
+		XMVECTOR center = (boundsMin + boundsMax) * 0.5f;
+		float size = XMVectorGetX(XMVector3Length(boundsMax - boundsMin));
+
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> spread(-2.0f, 2.0f);
+		std::vector<XMFLOAT3> cameras(64);
+		for (XMFLOAT3& camera : cameras)
+			XMStoreFloat3(&camera, center + XMVectorSet(spread(random), spread(random), spread(random), 0) * size);
+
+		unsigned int nextIndex = 0;
+		bool limitsKept = true, spheresHold = true, conesHold = true;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			const unsigned int* triangles = &data.indices[meshlet.indexOffset];
+			std::unordered_set<unsigned int> unique(triangles, triangles + meshlet.triangleCount * 3);
+
+			nextIndex = meshlet.indexOffset == nextIndex ? nextIndex + meshlet.triangleCount * 3 : ~0u;
+			limitsKept = limitsKept &&
+				meshlet.triangleCount >= 1 && meshlet.triangleCount <= maxTriangles &&
+				meshlet.vertexCount <= maxVertices && meshlet.vertexCount == unique.size();
+
+			for (unsigned int index : unique)
+			{
+				float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&data.vertices[index].Position) - XMLoadFloat3(&meshlet.center)));
+				spheresHold = spheresHold && distance <= meshlet.radius * 1.0001f + 1e-5f;
+			}
+
+			for (const XMFLOAT3& camera : cameras)
+			{
+				if (!Meshlets::IsBackfacing(meshlet, camera))
+					continue;
+
+				for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+				{
+					XMVECTOR p0 = XMLoadFloat3(&data.vertices[triangles[t * 3 + 0]].Position);
+					XMVECTOR p1 = XMLoadFloat3(&data.vertices[triangles[t * 3 + 1]].Position);
+					XMVECTOR p2 = XMLoadFloat3(&data.vertices[triangles[t * 3 + 2]].Position);
+					XMVECTOR normal = XMVector3Normalize(XMVector3Cross(p1 - p0, p2 - p0));
+					conesHold = conesHold && XMVectorGetX(XMVector3Dot(normal, XMLoadFloat3(&camera) - p0)) <= size * 1e-5f;
+				}
+			}
+		}
+
+		Check(limitsKept && nextIndex == data.indices.size(), "%s: Meshlets break their limits or don't cover the indices", name);
+		Check(spheresHold, "%s: A meshlet's sphere doesn't hold its vertices", name);
+		Check(conesHold, "%s: A meshlet's cone rejected a camera facing one of its triangles", name);
+	}
+
+	// --------------------------------------------------------
+	// Meshlets of a flat grid, where the answers are known, then
+	// of each model as the import would order it
+	// --------------------------------------------------------
+	void TestMeshlets(const std::vector<std::string>& models)
+	{
+		MeshData grid = MakeGrid(32);
+		CheckMeshlets("Grid", grid, Meshlets::MaxVertices, Meshlets::MaxTriangles);
+		CheckMeshlets("Grid (small limits)", grid, 16, 20);
+
+		// Every meshlet of the grid faces away from a camera below it, and toward one above
+		std::vector<Meshlet> meshlets = Meshlets::Build(grid.vertices.data(), grid.vertices.size(), grid.indices.data(), grid.indices.size());
+		size_t rejectedBelow = 0, rejectedAbove = 0;
+		for (const Meshlet& meshlet : meshlets)
+		{
+			rejectedBelow += Meshlets::IsBackfacing(meshlet, XMFLOAT3(16, -10, 16));
+			rejectedAbove += Meshlets::IsBackfacing(meshlet, XMFLOAT3(16, 10, 16));
+		}
+		Check(rejectedBelow == meshlets.size(), "Grid: Only %zu of %zu meshlets rejected from below", rejectedBelow, meshlets.size());
+		Check(rejectedAbove == 0, "Grid: %zu meshlets rejected from above", rejectedAbove);
+
+		// Cones are only used under rotation, translation and uniform scale
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixScaling(3, 3, 3) * XMMatrixRotationRollPitchYaw(0.3f, 1.2f, -0.7f) * XMMatrixTranslation(5, 6, 7));
+		Check(Meshlets::ConesHoldUnder(world), "Cones: Culling was turned off for a uniformly scaled rotation");
+		XMStoreFloat4x4(&world, XMMatrixScaling(1, 4, 1) * XMMatrixRotationRollPitchYaw(0.3f, 1.2f, -0.7f));
+		Check(!Meshlets::ConesHoldUnder(world), "Cones: Culling stayed on under non-uniform scale");
+		XMStoreFloat4x4(&world, XMMatrixRotationRollPitchYaw(0, 0.5f, 0) * XMMatrixScaling(1, 4, 1));
+		Check(!Meshlets::ConesHoldUnder(world), "Cones: Culling stayed on under shear");
+		XMStoreFloat4x4(&world, XMMatrixScaling(-2, 2, 2));
+		Check(!Meshlets::ConesHoldUnder(world), "Cones: Culling stayed on for a mirrored mesh");
+
+		for (const std::string& model : models)
+		{
+			MeshData data = ObjLoader::Load(model.c_str());
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+			MeshOptimizer::OptimizeVertexFetch(data);
+			CheckMeshlets(model.c_str(), data, Meshlets::MaxVertices, Meshlets::MaxTriangles);
+		}
+	}
+
+	// Positions that must never move when simplifying: seams, where
+	// vertices share a position and normal, and open borders, where
+	// an edge has no twin running the other way
+	std::vector<XMFLOAT3> LockedPositions(const MeshData& data, size_t indexCount)
+	{
+		auto key = [&](unsigned int v)
+		{
+			const Vertex& vertex = data.vertices[v];
+			return std::array<float, 6>{ vertex.Position.x, vertex.Position.y, vertex.Position.z, vertex.normal.x, vertex.normal.y, vertex.normal.z };
+		};
+
+		std::map<std::array<float, 6>, unsigned int> firstVertex;
+		std::vector<unsigned int> weldOf(data.vertices.size());
+		std::vector<unsigned int> wedges(data.vertices.size(), 0);
+		for (unsigned int v = 0; v < data.vertices.size(); v++)
+		{
+			weldOf[v] = firstVertex.insert({ key(v), v }).first->second;
+			wedges[weldOf[v]]++;
+		}
+
+		std::map<std::pair<unsigned int, unsigned int>, int> edges;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (int e = 0; e < 3; e++)
+				edges[{ weldOf[data.indices[i + e]], weldOf[data.indices[i + (e + 1) % 3]] }]++;
+		}
+
+		std::vector<bool> locked(data.vertices.size(), false);
+		for (unsigned int v = 0; v < data.vertices.size(); v++)
+			locked[weldOf[v]] = locked[weldOf[v]] || wedges[weldOf[v]] > 1;
+		for (const auto& edge : edges)
+		{
+			auto twin = edges.find({ edge.first.second, edge.first.first });
+			if (edge.second != 1 || twin == edges.end() || twin->second != 1)
+				locked[edge.first.first] = locked[edge.first.second] = true;
+		}
+
+		std::vector<XMFLOAT3> positions;
+		for (unsigned int v = 0; v < data.vertices.size(); v++)
+		{
+			if (locked[v] && weldOf[v] == v)
+				positions.push_back(data.vertices[v].Position);
+		}
+		return positions;
+	}
+
+	// --------------------------------------------------------
+	// Builds each model's level of detail chain, which must get
+	// coarser and less accurate at every level while keeping
+	// seams and borders where they were
+	// --------------------------------------------------------
+	void CheckLods(const char* name, MeshData data)
+	{
+		size_t fullIndexCount = data.indices.size();
+		std::vector<XMFLOAT3> locked = LockedPositions(data, fullIndexCount);
+		MeshSimplifier::BuildLodChain(data);
+
+		Check(!data.lods.empty() && data.lods[0].indexOffset == 0 && data.lods[0].indexCount == fullIndexCount,
+			"%s: Level 0 isn't the full detail mesh", name);
+
+		for (size_t level = 1; level < data.lods.size(); level++)
+		{
+			const MeshLod& lod = data.lods[level];
+			const MeshLod& previous = data.lods[level - 1];
+			Check(lod.indexCount < previous.indexCount && lod.indexCount % 3 == 0,
+				"%s: Level %zu has %u indices after %u", name, level, lod.indexCount, previous.indexCount);
+			Check(std::isfinite(lod.error) && std::isfinite(lod.hausdorffError) && lod.error >= previous.error,
+				"%s: Level %zu has an error of %g after %g", name, level, lod.error, previous.error);
+
+			// Every locked position is still used by the level
+			std::set<std::array<float, 3>> used;
+			for (unsigned int i = lod.indexOffset; i < lod.indexOffset + lod.indexCount; i++)
+			{
+				const XMFLOAT3& p = data.vertices[data.indices[i]].Position;
+				used.insert({ p.x, p.y, p.z });
+			}
+			size_t moved = 0;
+			for (const XMFLOAT3& p : locked)
+				moved += used.count({ p.x, p.y, p.z }) == 0;
+			Check(moved == 0, "%s: Level %zu lost %zu of %zu seam and border vertices", name, level, moved, locked.size());
+		}
+	}
+
+	void TestLods(const std::vector<std::string>& models)
+	{
+		CheckLods("Grid", MakeGrid(32));
+		for (const std::string& model : models)
+		{
+			MeshData data = ObjLoader::Load(model.c_str());
+			MeshOptimizer::OptimizeVertexCache(data.indices, data.vertices.size());
+			CheckLods(model.c_str(), data);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Compares the SIMD tangents, on one thread and several,
+	// with the scalar ones, vertex by vertex
+	// --------------------------------------------------------
+	void CheckTangents(const char* name, const MeshData& data)
+	{
+		std::vector<Vertex> expected = data.vertices;
+		Tangents::CalculateScalar(expected.data(), expected.size(), data.indices.data(), data.indices.size());
+
+		for (unsigned int threadCount : { 1u, 4u })
+		{
+			std::vector<Vertex> vertices = data.vertices;
+			Tangents::Calculate(vertices.data(), vertices.size(), data.indices.data(), data.indices.size(), threadCount);
+
+			float maxError = 0.0f;
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				maxError = std::max(maxError, fabsf(vertices[i].tangent.x - expected[i].tangent.x));
+				maxError = std::max(maxError, fabsf(vertices[i].tangent.y - expected[i].tangent.y));
+				maxError = std::max(maxError, fabsf(vertices[i].tangent.z - expected[i].tangent.z));
+			}
+			Check(maxError <= 1e-4f, "%s: %u thread tangents are off the scalar ones by %g", name, threadCount, maxError);
+		}
+	}
+
+	void TestTangents(const std::vector<std::string>& models)
+	{
+		// Big enough to be split between threads, with bumps and
+		// squashed uvs so the tangents aren't all the same
+		MeshData grid = MakeGrid(200);
+		for (Vertex& vertex : grid.vertices)
+		{
+			vertex.Position.y = sinf(vertex.Position.x * 0.3f) * cosf(vertex.Position.z * 0.2f) * 2.0f;
+			vertex.uv.x *= 1.0f + vertex.uv.y;
+		}
+		grid.vertices[5].uv = grid.vertices[6].uv;
+		CheckTangents("Grid", grid);
+
+		for (const std::string& model : models)
+			CheckTangents(model.c_str(), ObjLoader::Load(model.c_str()));
+	}
+
+	// Whether a point is inside a box, give or take a relative epsilon
+	bool BoxContains(const Aabb& box, FXMVECTOR point)
+	{
+		XMVECTOR slack = XMVectorReplicate(1e-5f) * (XMVectorAbs(XMLoadFloat3(&box.center)) + XMLoadFloat3(&box.extents)) + XMVectorReplicate(1e-6f);
+		XMVECTOR offset = XMVectorAbs(point - XMLoadFloat3(&box.center));
+		return XMVector3LessOrEqual(offset, XMLoadFloat3(&box.extents) + slack);
+	}
+
+	bool SphereContains(const Sphere& sphere, FXMVECTOR point)
+	{
+		float distance = XMVectorGetX(XMVector3Length(point - XMLoadFloat3(&sphere.center)));
+		return distance <= sphere.radius * (1.0f + 1e-5f) + 1e-6f;
+	}
+
+	// --------------------------------------------------------
+	// Fits boxes and spheres around each model, which must hold
+	// every vertex, before and after transforming them with
+	// rotations, non-uniform and negative scales
+	// --------------------------------------------------------
+	void TestBounds(const std::vector<std::string>& models)
+	{
+		XMMATRIX matrices[] =
+		{
+			XMMatrixIdentity(),
+			XMMatrixRotationRollPitchYaw(0.4f, -1.1f, 2.3f) * XMMatrixTranslation(3, -2, 7),
+			XMMatrixScaling(2, 0.5f, 3) * XMMatrixRotationRollPitchYaw(1.0f, 0.2f, -0.6f),
+			XMMatrixScaling(-1, 2, 1) * XMMatrixRotationRollPitchYaw(-0.3f, 0.8f, 0.1f) * XMMatrixTranslation(-5, 0, 1),
+			XMMatrixScaling(-2, -2, -2),
+		};
+
+		for (const std::string& model : models)
+		{
+			MeshData data = ObjLoader::Load(model.c_str());
+			Aabb box = Aabb::FromVertices(data.vertices.data(), data.vertices.size());
+			Sphere sphere = Sphere::FromVertices(data.vertices.data(), data.vertices.size());
+
+			// The smallest sphere is never bigger than the one around the box
+			float halfDiagonal = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.extents)));
+			Check(sphere.radius <= halfDiagonal * (1.0f + 1e-5f), "%s: Sphere radius %g is bigger than the box's half diagonal %g", model.c_str(), sphere.radius, halfDiagonal);
+
+			for (size_t m = 0; m < std::size(matrices); m++)
+			{
+				XMFLOAT4X4 matrix;
+				XMStoreFloat4x4(&matrix, matrices[m]);
+				Aabb transformedBox = box.Transform(matrix);
+				Sphere transformedSphere = sphere.Transform(matrix);
+
+				bool boxHolds = true, sphereHolds = true;
+				for (const Vertex& vertex : data.vertices)
+				{
+					XMVECTOR p = XMVector3Transform(XMLoadFloat3(&vertex.Position), matrices[m]);
+					boxHolds = boxHolds && BoxContains(transformedBox, p);
+					sphereHolds = sphereHolds && SphereContains(transformedSphere, p);
+				}
+				Check(boxHolds, "%s: A vertex is outside the box under matrix %zu", model.c_str(), m);
+				Check(sphereHolds, "%s: A vertex is outside the sphere under matrix %zu", model.c_str(), m);
+
+				// The transformed box is exactly the box around the 8 transformed corners
+				XMVECTOR cornerMin = XMVectorReplicate(FLT_MAX), cornerMax = XMVectorReplicate(-FLT_MAX);
+				for (int corner = 0; corner < 8; corner++)
+				{
+					XMVECTOR sign = XMVectorSet(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f, 0);
+					XMVECTOR p = XMVector3Transform(XMLoadFloat3(&box.center) + sign * XMLoadFloat3(&box.extents), matrices[m]);
+					cornerMin = XMVectorMin(cornerMin, p);
+					cornerMax = XMVectorMax(cornerMax, p);
+				}
+				XMFLOAT3 expectedMin, expectedMax;
+				XMStoreFloat3(&expectedMin, cornerMin);
+				XMStoreFloat3(&expectedMax, cornerMax);
+				Aabb expected = Aabb::FromMinMax(expectedMin, expectedMax);
+				XMFLOAT3 boxMin = transformedBox.Min(), boxMax = transformedBox.Max();
+				Check(BoxContains(transformedBox, cornerMin) && BoxContains(transformedBox, cornerMax) &&
+					BoxContains(expected, XMLoadFloat3(&boxMin)) && BoxContains(expected, XMLoadFloat3(&boxMax)),
+					"%s: Transformed box isn't the box around the transformed corners under matrix %zu", model.c_str(), m);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Has every job system thread ask for the same model at once,
+	// under different spellings of its path, which must load it
+	// once and share that one result with every other request
+	// --------------------------------------------------------
+	void TestFileRegistry(const std::vector<std::string>& models, unsigned int threadCount)
+	{
+		JobSystem::Initialize(threadCount - 1);
+		FileRegistry registry;
+		std::filesystem::path model = models.front();
+		std::string respelled = (model.parent_path() / "." / model.filename()).string();
+
+		std::atomic<int> loads = 0;
+		auto load = [&](const std::string& path)
+		{
+			loads++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			return std::make_shared<MeshData>(ObjLoader::Load(path.c_str()));
+		};
+
+		std::vector<std::shared_ptr<MeshData>> results(threadCount * 4);
+		JobSystem::ParallelFor(results.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				results[i] = registry.Load<MeshData>(i % 2 ? respelled : model.string(), 0, load);
+		});
+
+		FileRegistry::Stats stats = registry.GetStats();
+		bool shared = std::all_of(results.begin(), results.end(), [&](const std::shared_ptr<MeshData>& result) { return result && result == results[0]; });
+		Check(loads == 1 && stats.misses == 1 && stats.hits == results.size() - 1,
+			"Registry: %zu requests on %u threads loaded %d times, with %u misses and %u hits", results.size(), threadCount, (int)loads, stats.misses, stats.hits);
+		Check(shared, "Registry: Requests on %u threads got different results", threadCount);
+
+		// Other options load separately, and a failed load is retried
+		registry.Load<MeshData>(model.string(), 1, load);
+		bool threw = false;
+		try { registry.Load<MeshData>(model.string(), 2, [](const std::string&) -> std::shared_ptr<MeshData> { throw std::runtime_error("Failed"); }); }
+		catch (const std::runtime_error&) { threw = true; }
+		registry.Load<MeshData>(model.string(), 2, load);
+		std::vector<FileRegistry::Entry> entries = registry.GetEntries();
+		Check(threw && loads == 3 && entries.size() == 3 && entries[0].requestCount == results.size(),
+			"Registry: Options or a failed load weren't kept apart (%d loads, %zu entries)", (int)loads, entries.size());
+
+		registry.Clear();
+		Check(registry.GetEntries().empty() && registry.GetStats().hits == 0, "Registry: Clear() left something behind");
+		JobSystem::Shutdown();
+	}
+
+	// Maximal runs of free elements, as offset and size
+	std::vector<std::pair<size_t, size_t>> FreeRuns(const std::vector<bool>& inUse)
+	{
+		std::vector<std::pair<size_t, size_t>> runs;
+		for (size_t i = 0; i < inUse.size(); i++)
+		{
+			if (inUse[i])
+				continue;
+			if (runs.empty() || runs.back().first + runs.back().second != i)
+				runs.push_back({ i, 0 });
+			runs.back().second++;
+		}
+		return runs;
+	}
+
+	// --------------------------------------------------------
+	// Random allocations, frees and growth, checked against a
+	// map of which elements are in use after every step
+	// --------------------------------------------------------
+	void TestRangeAllocator()
+	{
+		std::mt19937 random(7);
+		RangeAllocator allocator(1024);
+		std::vector<bool> inUse(1024, false);
+		std::vector<std::pair<size_t, size_t>> live;
+
+		bool separate = true, bestFit = true, merged = true, counted = true;
+		for (int step = 0; step < 20000; step++)
+		{
+			unsigned int action = random() % 100;
+			if (action < 55)
+			{
+				size_t size = 1 + random() % (random() % 8 == 0 ? 200 : 24);
+				std::vector<std::pair<size_t, size_t>> runs = FreeRuns(inUse);
+				size_t smallestFit = SIZE_MAX;
+				for (const auto& run : runs)
+				{
+					if (run.second >= size)
+						smallestFit = std::min(smallestFit, run.second);
+				}
+
+				size_t offset = allocator.Allocate(size);
+				if (offset == RangeAllocator::InvalidOffset)
+				{
+					bestFit = bestFit && smallestFit == SIZE_MAX;
+					continue;
+				}
+
+				// It lies in a run no bigger than any other that fits, and overlaps nothing
+				auto run = std::find_if(runs.begin(), runs.end(), [&](const std::pair<size_t, size_t>& r) { return offset >= r.first && offset < r.first + r.second; });
+				bestFit = bestFit && run != runs.end() && run->second == smallestFit;
+				for (size_t i = offset; i < offset + size; i++)
+				{
+					separate = separate && i < inUse.size() && !inUse[i];
+					if (i < inUse.size())
+						inUse[i] = true;
+				}
+				live.push_back({ offset, size });
+			}
+			else if (action < 97 && !live.empty())
+			{
+				size_t pick = random() % live.size();
+				allocator.Free(live[pick].first);
+				for (size_t i = live[pick].first; i < live[pick].first + live[pick].second; i++)
+					inUse[i] = false;
+				live[pick] = live.back();
+				live.pop_back();
+
+				// Free neighbours merged, so every free range is a maximal run
+				merged = merged && allocator.GetFreeRangeCount() == FreeRuns(inUse).size();
+			}
+			else if (action >= 97)
+			{
+				size_t newCapacity = allocator.GetCapacity() + 1 + random() % 256;
+				allocator.Grow(newCapacity);
+				inUse.resize(newCapacity, false);
+				merged = merged && allocator.GetFreeRangeCount() == FreeRuns(inUse).size();
+			}
+
+			size_t usedCount = (size_t)std::count(inUse.begin(), inUse.end(), true);
+			counted = counted && allocator.GetUsed() == usedCount && allocator.GetAllocationCount() == live.size();
+		}
+
+		Check(separate, "Allocator: Two live ranges overlapped");
+		Check(bestFit, "Allocator: An allocation didn't take the smallest free range that fits");
+		Check(merged, "Allocator: Freed ranges weren't merged with their free neighbours");
+		Check(counted, "Allocator: Used or allocation counts drifted from the live ranges");
+
+		bool threw = false;
+		try { allocator.Free(allocator.GetCapacity() + 1); }
+		catch (const std::invalid_argument&) { threw = true; }
+		Check(threw, "Allocator: Freeing an offset that isn't allocated didn't throw");
+
+		for (const auto& range : live)
+			allocator.Free(range.first);
+		Check(allocator.GetUsed() == 0 && allocator.GetFreeRangeCount() == 1 && allocator.GetLargestFreeRange() == allocator.GetCapacity(),
+			"Allocator: %zu free ranges left after freeing everything", allocator.GetFreeRangeCount());
+	}
+
+	// --------------------------------------------------------
+	// Merges copies of a flat grid under a plain, a rotated then
+	// squashed, and a mirrored world matrix, and checks each copy
+	// --------------------------------------------------------
+	void TestStaticBatching()
+	{
+		MeshData grid = MakeGrid(4);
+		Tangents::CalculateScalar(grid.vertices.data(), grid.vertices.size(), grid.indices.data(), grid.indices.size());
+
+		XMFLOAT4X4 worlds[3];
+		XMStoreFloat4x4(&worlds[0], XMMatrixTranslation(10, 0, -5));
+		XMStoreFloat4x4(&worlds[1], XMMatrixRotationRollPitchYaw(0.4f, 1.1f, -0.3f) * XMMatrixScaling(3, 0.5f, 1) * XMMatrixTranslation(5, 2, 1));
+		XMStoreFloat4x4(&worlds[2], XMMatrixScaling(-1, 1, 1) * XMMatrixRotationRollPitchYaw(0, 0.7f, 0.2f));
+
+		std::vector<StaticBatching::Instance> instances;
+		for (const XMFLOAT4X4& world : worlds)
+			instances.push_back({ grid.vertices.data(), grid.vertices.size(), grid.indices.data(), grid.indices.size(), world });
+		MeshData batch = StaticBatching::Merge(instances);
+
+		Check(batch.vertices.size() == grid.vertices.size() * 3 && batch.indices.size() == grid.indices.size() * 3,
+			"Static batch: Expected %zu vertices and %zu indices", grid.vertices.size() * 3, grid.indices.size() * 3);
+		if (batch.vertices.size() != grid.vertices.size() * 3 || batch.indices.size() != grid.indices.size() * 3)
+			return;
+
+		for (int copy = 0; copy < 3; copy++)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&worlds[copy]);
+			size_t firstVertex = copy * grid.vertices.size();
+			size_t firstIndex = copy * grid.indices.size();
+
+			bool indicesRebased = true, positionsMoved = true, normalsHold = true;
+			for (size_t i = 0; i < grid.indices.size(); i++)
+				indicesRebased = indicesRebased && batch.indices[firstIndex + i] == firstVertex + grid.indices[i];
+
+			XMVECTOR movedUp = XMVector3TransformNormal(XMVectorSet(0, 1, 0, 0), world);
+			for (size_t i = 0; i < grid.vertices.size(); i++)
+			{
+				const Vertex& vertex = batch.vertices[firstVertex + i];
+				XMVECTOR expected = XMVector3TransformCoord(XMLoadFloat3(&grid.vertices[i].Position), world);
+				positionsMoved = positionsMoved && XMVectorGetX(XMVector3Length(XMLoadFloat3(&vertex.Position) - expected)) < 1e-4f;
+
+				XMVECTOR normal = XMLoadFloat3(&vertex.normal);
+				normalsHold = normalsHold &&
+					fabsf(XMVectorGetX(XMVector3Length(normal)) - 1.0f) < 1e-4f &&
+					XMVectorGetX(XMVector3Dot(normal, movedUp)) > 0.0f;
+			}
+
+			for (size_t t = firstIndex; t < firstIndex + grid.indices.size(); t += 3)
+			{
+				XMVECTOR p0 = XMLoadFloat3(&batch.vertices[batch.indices[t]].Position);
+				XMVECTOR p1 = XMLoadFloat3(&batch.vertices[batch.indices[t + 1]].Position);
+				XMVECTOR p2 = XMLoadFloat3(&batch.vertices[batch.indices[t + 2]].Position);
+				for (int corner = 0; corner < 3; corner++)
+				{
+					XMVECTOR normal = XMLoadFloat3(&batch.vertices[batch.indices[t + corner]].normal);
+					normalsHold = normalsHold &&
+						fabsf(XMVectorGetX(XMVector3Dot(normal, XMVector3Normalize(p1 - p0)))) < 1e-4f &&
+						fabsf(XMVectorGetX(XMVector3Dot(normal, XMVector3Normalize(p2 - p0)))) < 1e-4f;
+				}
+			}
+
+			std::vector<Vertex> regenerated(batch.vertices.begin() + firstVertex, batch.vertices.begin() + firstVertex + grid.vertices.size());
+			Tangents::CalculateScalar(regenerated.data(), regenerated.size(), grid.indices.data(), grid.indices.size());
+			float tangentError = 0.0f;
+			for (size_t i = 0; i < regenerated.size(); i++)
+			{
+				XMVECTOR difference = XMLoadFloat3(&regenerated[i].tangent) - XMLoadFloat3(&batch.vertices[firstVertex + i].tangent);
+				tangentError = std::max(tangentError, XMVectorGetX(XMVector3Length(difference)));
+			}
+
+			Check(indicesRebased, "Static batch copy %d: Indices weren't offset past the earlier copies", copy);
+			Check(positionsMoved, "Static batch copy %d: Positions aren't in world space", copy);
+			Check(normalsHold, "Static batch copy %d: Normals aren't perpendicular to the world space surface", copy);
+			Check(tangentError < 1e-4f, "Static batch copy %d: Tangents are off the world space ones by %g", copy, tangentError);
+		}
+	}
+
+	// A transform's local and world matrices worked out the slow
+	// way, from its components and its parents'
+	XMMATRIX LocalMatrix(Transform& transform)
+	{
+		XMFLOAT3 position = transform.GetPosition();
+		XMFLOAT4 rotation = transform.GetRotation();
+		XMFLOAT3 scale = transform.GetScale();
+		return XMMatrixScaling(scale.x, scale.y, scale.z) *
+			XMMatrixRotationQuaternion(XMLoadFloat4(&rotation)) *
+			XMMatrixTranslation(position.x, position.y, position.z);
+	}
+
+	XMMATRIX ExpectedWorld(Transform& transform)
+	{
+		Transform* parent = transform.GetParent();
+		return parent ? LocalMatrix(transform) * ExpectedWorld(*parent) : LocalMatrix(transform);
+	}
+
+	// Largest difference between two matrices' elements
+	float MatrixError(const XMFLOAT4X4& matrix, FXMMATRIX expected)
+	{
+		XMFLOAT4X4 other;
+		XMStoreFloat4x4(&other, expected);
+
+		float error = 0.0f;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+				error = std::max(error, fabsf(matrix.m[row][column] - other.m[row][column]));
+		}
+		return error;
+	}
+
+	// Compares every transform's world matrix with the slow one,
+	// optionally after an update pass (without one, reads have to
+	// bring the hierarchy up to date themselves)
+	void CheckWorlds(const char* name, std::vector<Transform*> transforms, bool update, float tolerance = 1e-4f)
+	{
+		if (update)
+			TransformSystem::UpdateDirty();
+
+		float maxError = 0.0f;
+		for (Transform* transform : transforms)
+			maxError = std::max(maxError, MatrixError(transform->GetWorldMatrix(), ExpectedWorld(*transform)));
+		Check(maxError <= tolerance, "%s: World matrices are off by %g", name, maxError);
+	}
+
+	// --------------------------------------------------------
+	// Builds small, deep and wide hierarchies, then moves,
+	// reparents and destroys parts of them, checking the world
+	// matrices against ones worked out from the components
+	//
+	// - Reads after UpdateDirty() can't fix anything up, so they
+	//   show whether the sweep put parents before their children
+	// --------------------------------------------------------
+	void TestTransformHierarchy(unsigned int threadCount)
+	{
+		JobSystem::Initialize(threadCount - 1);
+
+		// A little tree with a second root to move things to
+		Transform a, b, c, d;
+		b.SetParent(&a);
+		c.SetParent(&b);
+		a.SetPosition(1, 2, 3);
+		a.SetRotation(0, 0.5f, 0);
+		a.SetScale(2, 1, 1);
+		b.SetPosition(0, 1, 0);
+		b.SetRotation(0.3f, 0, 0);
+		b.SetScale(0.5f, 0.5f, 0.5f);
+		c.SetPosition(1, 0, 0);
+		d.SetPosition(-5, 0, 0);
+		CheckWorlds("Tree", { &a, &b, &c, &d }, true);
+
+		a.Rotate(0, 0.2f, 0);
+		a.MoveAbsolute(1, 0, 0);
+		CheckWorlds("Tree after moving the root", { &a, &b, &c, &d }, true);
+
+		a.SetScale(1, 3, 1);
+		CheckWorlds("Tree read between passes", { &c, &b }, false);
+
+		// Reading again, before or after the pass, changes nothing
+		unsigned int version = c.GetVersion();
+		Check(c.GetVersion() == version && b.GetVersion() == b.GetVersion(), "Tree: Versions moved on between reads");
+		TransformSystem::UpdateDirty();
+		Check(c.GetVersion() == version, "Tree: The pass recomposed a child that reads had brought up to date");
+		a.MoveAbsolute(0, 1, 0);
+		Check(c.GetVersion() != version, "Tree: Version didn't move on with the root");
+
+		c.SetParent(&d);
+		CheckWorlds("Tree after reparenting", { &a, &b, &c, &d }, true);
+		Check(c.GetParent() == &d && b.GetParent() == &a, "Tree: Parents are wrong after reparenting");
+
+		bool threw = false;
+		try { a.SetParent(&b); }
+		catch (const std::invalid_argument&) { threw = true; }
+		Check(threw && a.GetParent() == nullptr, "Tree: Parenting a transform to its child didn't throw");
+
+		// Destroying a parent leaves its children where they were
+		{
+			std::unique_ptr<Transform> parent = std::make_unique<Transform>();
+			parent->SetPosition(3, 4, 5);
+			parent->SetRotation(0.2f, 1.0f, 0.1f);
+			parent->SetScale(2, 2, 2);
+			Transform child;
+			child.SetParent(parent.get());
+			child.SetPosition(1, 1, 0);
+			child.SetRotation(0, 0.5f, 0);
+			XMFLOAT4X4 before = child.GetWorldMatrix();
+
+			parent.reset();
+			Check(child.GetParent() == nullptr, "Destroy: Child still has a parent");
+			CheckWorlds("Destroy", { &child }, true);
+			Check(MatrixError(child.GetWorldMatrix(), XMLoadFloat4x4(&before)) <= 1e-4f, "Destroy: Child moved when its parent was destroyed");
+		}
+
+		// Moved-from transforms read as the identity and can be
+		// assigned to, copied and used again
+		{
+			Transform source;
+			source.SetParent(&a);
+			source.SetPosition(2, 0, 1);
+			Transform moved = std::move(source);
+
+			Check(MatrixError(source.GetWorldMatrix(), XMMatrixIdentity()) == 0.0f && source.GetParent() == nullptr,
+				"Moved from: Source isn't the identity");
+
+			Transform emptied = std::move(source);
+			Transform copy(source);
+			source = moved;
+			CheckWorlds("Moved from, assigned", { &source, &moved, &copy }, true);
+			Check(source.GetParent() == &a && source.GetSlot() != moved.GetSlot(), "Moved from: Assignment didn't copy into a slot of its own");
+
+			Transform other = std::move(emptied);
+			moved = emptied;
+			Check(MatrixError(moved.GetWorldMatrix(), XMMatrixIdentity()) == 0.0f && moved.GetParent() == nullptr,
+				"Moved from: Assigning an empty transform didn't reset to the identity");
+		}
+
+		// A long chain, each link a step along and a little turn
+		{
+			std::vector<Transform> chain(256);
+			std::vector<Transform*> links;
+			for (size_t i = 0; i < chain.size(); i++)
+			{
+				if (i > 0)
+					chain[i].SetParent(&chain[i - 1]);
+				chain[i].SetPosition(1, 0, 0);
+				chain[i].SetRotation(0, 0.01f, 0);
+				links.push_back(&chain[i]);
+			}
+			CheckWorlds("Deep", links, true, 1e-3f);
+
+			chain[0].Rotate(0, 0.3f, 0);
+			chain[128].MoveAbsolute(0, 1, 0);
+			CheckWorlds("Deep after moving the root and a link", links, true, 1e-3f);
+		}
+
+		// Random subtrees moved around a forest, many times between passes
+		{
+			std::mt19937 random(11);
+			std::vector<Transform> forest(300);
+			std::vector<Transform*> all;
+			for (size_t i = 0; i < forest.size(); i++)
+			{
+				forest[i].SetPosition((float)(i % 7), 0.5f, 0);
+				forest[i].SetRotation(0, 0.05f * (i % 5), 0);
+				all.push_back(&forest[i]);
+			}
+
+			for (int round = 0; round < 4; round++)
+			{
+				for (int move = 0; move < 500; move++)
+				{
+					Transform& child = forest[random() % forest.size()];
+					Transform* parent = random() % 8 == 0 ? nullptr : &forest[random() % forest.size()];
+					try { child.SetParent(parent); }
+					catch (const std::invalid_argument&) {}
+				}
+				CheckWorlds("Forest after reparenting", all, true, 1e-3f);
+
+				unsigned int deepest = 0;
+				for (Transform& transform : forest)
+				{
+					unsigned int depth = 0;
+					for (Transform* t = transform.GetParent(); t; t = t->GetParent())
+						depth++;
+					deepest = std::max(deepest, depth);
+				}
+				Check(TransformSystem::GetStats().hierarchyDepth == deepest,
+					"Forest: %u levels in the update order for a depth of %u", TransformSystem::GetStats().hierarchyDepth, deepest);
+			}
+		}
+
+		// One root with many children
+		{
+			Transform root;
+			std::vector<Transform> children(2000);
+			std::vector<Transform*> all = { &root };
+			for (size_t i = 0; i < children.size(); i++)
+			{
+				children[i].SetParent(&root);
+				children[i].SetPosition((float)(i % 50), 0, (float)(i / 50));
+				all.push_back(&children[i]);
+			}
+			CheckWorlds("Wide", all, true);
+
+			root.SetRotation(0, 1.0f, 0);
+			root.SetScale(1, 2, 1);
+			CheckWorlds("Wide after moving the root", all, true, 1e-3f);
+		}
+
+		JobSystem::Shutdown();
+	}
+
+	// The matrix of cofactors, worked out in double precision, which
+	// is the inverse transpose times the determinant when there is
+	// an inverse, and still exists when there isn't
+	XMFLOAT4X4 CofactorMatrix(const XMFLOAT4X4& matrix)
+	{
+		XMFLOAT4X4 cofactors;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				double minor[3][3];
+				for (int r = 0, mr = 0; r < 4; r++)
+				{
+					if (r == row)
+						continue;
+					for (int c = 0, mc = 0; c < 4; c++)
+					{
+						if (c != column)
+							minor[mr][mc++] = matrix.m[r][c];
+					}
+					mr++;
+				}
+
+				double determinant =
+					minor[0][0] * (minor[1][1] * minor[2][2] - minor[1][2] * minor[2][1]) -
+					minor[0][1] * (minor[1][0] * minor[2][2] - minor[1][2] * minor[2][0]) +
+					minor[0][2] * (minor[1][0] * minor[2][1] - minor[1][1] * minor[2][0]);
+				cofactors.m[row][column] = (float)((row + column) % 2 ? -determinant : determinant);
+			}
+		}
+		return cofactors;
+	}
+
+	// Largest difference between two matrices, relative to the
+	// expected one's largest element
+	float RelativeMatrixError(const XMFLOAT4X4& matrix, const XMFLOAT4X4& expected)
+	{
+		float largest = 0.0f;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = 0; column < 4; column++)
+				largest = std::max(largest, fabsf(expected.m[row][column]));
+		}
+
+		float error = MatrixError(matrix, XMLoadFloat4x4(&expected));
+		return largest > 0.0f ? error / largest : error;
+	}
+
+	// --------------------------------------------------------
+	// Checks TransformSystem's inverse transposes against the
+	// general inverse, or the cofactor matrix for zero scales
+	// - Children are checked against the product of their local
+	//   reference and the parent's
+	// --------------------------------------------------------
+	void TestInverseTranspose()
+	{
+		struct ScaleCase
+		{
+			const char* name;
+			XMFLOAT3 scale;
+			bool invertible;
+		};
+
+		const ScaleCase cases[] =
+		{
+			{ "Unit scale", XMFLOAT3(1, 1, 1), true },
+			{ "Non-uniform scale", XMFLOAT3(2, 0.5f, 3), true },
+			{ "Mirrored", XMFLOAT3(-1, 1, 2), true },
+			{ "Small scale", XMFLOAT3(1e-3f, 1, 1), true },
+			{ "Tiny scales", XMFLOAT3(1e-6f, 1e-6f, 1), true },
+			{ "Near-zero scale", XMFLOAT3(1e-19f, 1, 1), true },
+			{ "Below-threshold scale", XMFLOAT3(1e-21f, 1, 1), false },
+			{ "Zero scale", XMFLOAT3(0, 1, 2), false },
+			{ "Two zero scales", XMFLOAT3(0, 0, 2), false },
+			{ "All zero scales", XMFLOAT3(0, 0, 0), false },
+		};
+
+		for (const ScaleCase& scaleCase : cases)
+		{
+			Transform root, child;
+			root.SetScale(scaleCase.scale);
+			root.SetRotation(0.3f, -1.2f, 0.7f);
+			root.SetPosition(4, -2, 7);
+			child.SetParent(&root);
+			child.SetScale(1, 2, 0.5f);
+			child.SetRotation(0.1f, 0.4f, 0);
+			child.SetPosition(1, 1, -3);
+			TransformSystem::UpdateDirty();
+
+			XMFLOAT4X4 rootWorld = root.GetWorldMatrix();
+			XMFLOAT4X4 rootExpected;
+			if (scaleCase.invertible)
+				XMStoreFloat4x4(&rootExpected, XMMatrixTranspose(XMMatrixInverse(nullptr, XMLoadFloat4x4(&rootWorld))));
+			else
+				rootExpected = CofactorMatrix(rootWorld);
+
+			XMFLOAT4X4 childExpected;
+			XMStoreFloat4x4(&childExpected,
+				XMMatrixTranspose(XMMatrixInverse(nullptr, LocalMatrix(child))) * XMLoadFloat4x4(&rootExpected));
+
+			for (Transform* transform : { &root, &child })
+			{
+				XMFLOAT4X4 inverseTranspose = transform->GetWorldInverseTranspose();
+				XMFLOAT4X4 expected = transform == &root ? rootExpected : childExpected;
+
+				bool finite = true;
+				for (int i = 0; i < 16; i++)
+					finite = finite && std::isfinite(inverseTranspose.m[i / 4][i % 4]);
+
+				float error = RelativeMatrixError(inverseTranspose, expected);
+				const char* which = transform == &root ? "root" : "child";
+				Check(finite, "%s (%s): Inverse transpose isn't finite", scaleCase.name, which);
+				Check(error <= 1e-4f, "%s (%s): Inverse transpose is off the %s by %g", scaleCase.name, which,
+					scaleCase.invertible ? "general inverse" : "cofactor matrix", error);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Random spawns, despawns and clears checked against a map
+	// of what each live handle should hold, including handles
+	// kept after their entity was despawned
+	// --------------------------------------------------------
+	void TestEntityStore()
+	{
+		struct Expected { float tag; bool isStatic; };
+		auto key = [](EntityHandle entity) { return ((uint64_t)entity.generation << 32) | entity.index; };
+
+		std::mt19937 random(5);
+		EntityStore store;
+		std::map<uint64_t, std::pair<EntityHandle, Expected>> live;
+		std::vector<EntityHandle> stale;
+
+		bool packed = true, matches = true, rejected = true;
+		for (int step = 0; step < 5000; step++)
+		{
+			unsigned int action = random() % 100;
+			if (action < 55 || live.empty())
+			{
+				EntityHandle entity = store.Spawn(nullptr, nullptr);
+				Expected expected = { (float)step, random() % 2 == 0 };
+				store.GetTransform(entity).SetPosition(expected.tag, 0, 0);
+				store.SetStatic(entity, expected.isStatic);
+				live[key(entity)] = { entity, expected };
+			}
+			else if (action < 99)
+			{
+				auto victim = std::next(live.begin(), random() % live.size());
+				store.Despawn(victim->second.first);
+				stale.push_back(victim->second.first);
+				live.erase(victim);
+
+				// Despawning again does nothing
+				store.Despawn(stale.back());
+			}
+			else
+			{
+				store.Clear();
+				for (const auto& entry : live)
+					stale.push_back(entry.second.first);
+				live.clear();
+			}
+
+			// Dense storage holds exactly the live entities, each where its handle says
+			packed = packed && store.Count() == live.size();
+			for (size_t position = 0; position < store.Count() && packed; position++)
+			{
+				EntityHandle entity = store.HandleAt(position);
+				packed = live.count(key(entity)) == 1 && store.PositionOf(entity) == position;
+			}
+
+			for (const auto& entry : live)
+			{
+				const auto& [entity, expected] = entry.second;
+				matches = matches && store.IsAlive(entity) &&
+					store.GetTransform(entity).GetPosition().x == expected.tag &&
+					store.IsStatic(entity) == expected.isStatic;
+			}
+
+			// Stale handles stay rejected, even once their index is reused
+			for (int i = 0; i < 8 && !stale.empty(); i++)
+			{
+				EntityHandle entity = stale[random() % stale.size()];
+				bool threw = false;
+				try { store.PositionOf(entity); }
+				catch (const std::out_of_range&) { threw = true; }
+				rejected = rejected && !store.IsAlive(entity) && threw;
+			}
+		}
+
+		Check(packed, "Entities: Dense storage doesn't hold exactly the live entities");
+		Check(matches, "Entities: A live handle's components don't match what was set");
+		Check(rejected, "Entities: A stale handle was accepted");
+		Check(std::any_of(stale.begin(), stale.end(), [](EntityHandle entity) { return entity.generation > 0; }),
+			"Entities: No index was ever reused");
+	}
+
+	// --------------------------------------------------------
+	// Runs every supported culling kernel over ranges of each
+	// length and starting point, which must match the frustum's
+	// own sphere test exactly, without writing outside the range
+	//
+	// - A box shaped frustum with whole numbers has spheres that
+	//   exactly touch each plane, and ones just outside them
+	// --------------------------------------------------------
+	void TestCulling()
+	{
+		Frustum box;
+		box.planes[0] = XMFLOAT4(1, 0, 0, 10);
+		box.planes[1] = XMFLOAT4(-1, 0, 0, 10);
+		box.planes[2] = XMFLOAT4(0, 1, 0, 10);
+		box.planes[3] = XMFLOAT4(0, -1, 0, 10);
+		box.planes[4] = XMFLOAT4(0, 0, 1, 0);
+		box.planes[5] = XMFLOAT4(0, 0, -1, 100);
+
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection,
+			XMMatrixTranslation(-3, -2, 20) * XMMatrixRotationRollPitchYaw(0.1f, -0.2f, 0) *
+			XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 100.0f));
+		Frustum perspective = Frustum::FromMatrix(viewProjection);
+
+		std::vector<Sphere> spheres;
+		for (int plane = 0; plane < 6; plane++)
+		{
+			XMFLOAT4 p = box.planes[plane];
+			float radius = 2.0f;
+			XMFLOAT3 touching(-p.x * (p.w + radius), -p.y * (p.w + radius), plane == 4 ? -radius : -p.z * (p.w + radius));
+			if (plane < 4)
+				touching.z = 50.0f;
+			spheres.push_back({ touching, radius });
+			spheres.push_back({ touching, nextafterf(radius, 0.0f) });
+			spheres.push_back({ touching, nextafterf(radius, 4.0f) });
+		}
+
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> spread(-40.0f, 40.0f);
+		std::uniform_real_distribution<float> size(0.0f, 6.0f);
+		while (spheres.size() < 200)
+			spheres.push_back({ XMFLOAT3(spread(random), spread(random), spread(random) + 40.0f), size(random) });
+
+		SphereList list;
+		list.Resize(spheres.size());
+		for (size_t i = 0; i < spheres.size(); i++)
+			list.Set(i, spheres[i]);
+
+		for (const Frustum* frustum : { &box, &perspective })
+		{
+			const char* name = frustum == &box ? "box" : "perspective";
+			std::vector<uint8_t> expected(spheres.size());
+			for (size_t i = 0; i < spheres.size(); i++)
+				expected[i] = frustum->IntersectsSphere(spheres[i].center, spheres[i].radius) ? 1 : 0;
+
+			for (Culling::Kernel kernel : { Culling::Kernel::Scalar, Culling::Kernel::Sse, Culling::Kernel::Avx })
+			{
+				if (!Culling::IsSupported(kernel))
+					continue;
+
+				bool same = true, contained = true;
+				for (size_t begin = 0; begin < 9; begin++)
+				{
+					for (size_t count = 0; count <= 25 && begin + count <= spheres.size(); count++)
+					{
+						std::vector<uint8_t> visible(spheres.size(), 0xCD);
+						size_t visibleCount = Culling::CullSpheres(*frustum, list, begin, begin + count, visible.data(), kernel);
+
+						size_t expectedCount = 0;
+						for (size_t i = 0; i < spheres.size(); i++)
+						{
+							bool inRange = i >= begin && i < begin + count;
+							same = same && (!inRange || visible[i] == expected[i]);
+							contained = contained && (inRange || visible[i] == 0xCD);
+							expectedCount += inRange && expected[i];
+						}
+						same = same && visibleCount == expectedCount;
+					}
+				}
+
+				// And the whole list in one go
+				std::vector<uint8_t> visible(spheres.size());
+				Culling::CullSpheres(*frustum, list, 0, spheres.size(), visible.data(), kernel);
+				same = same && visible == expected;
+
+				Check(same, "Culling (%s): %s kernel disagrees with Frustum::IntersectsSphere()", name, Culling::GetName(kernel));
+				Check(contained, "Culling (%s): %s kernel wrote outside its range", name, Culling::GetName(kernel));
+			}
+		}
+
+		// The touching spheres are in, the ones just short of touching are out
+		bool touchingIn = true;
+		for (size_t i = 0; i < 18; i += 3)
+			touchingIn = touchingIn && box.IntersectsSphere(spheres[i].center, spheres[i].radius) && !box.IntersectsSphere(spheres[i + 1].center, spheres[i + 1].radius);
+		Check(touchingIn, "Culling: Spheres touching a plane aren't counted as inside");
+	}
+
+	// Query results in a comparable order
+	std::vector<unsigned int> Sorted(std::vector<unsigned int> items)
+	{
+		std::sort(items.begin(), items.end());
+		return items;
+	}
+
+	// --------------------------------------------------------
+	// Compares BVH queries with testing every box, after a build
+	// and after refitting to moved, grown and shrunk boxes
+	// --------------------------------------------------------
+	void CheckBvhQueries(const char* name, const Bvh& bvh, const std::vector<Aabb>& boxes, std::mt19937& random)
+	{
+		std::uniform_real_distribution<float> spread(-60.0f, 60.0f);
+		std::uniform_real_distribution<float> angle(-XM_PI, XM_PI);
+		std::normal_distribution<float> normal;
+
+		bool frustumsMatch = true, spheresMatch = true, raysMatch = true;
+		for (int query = 0; query < 50; query++)
+		{
+			XMFLOAT4X4 viewProjection;
+			XMStoreFloat4x4(&viewProjection,
+				XMMatrixTranslation(-spread(random), -spread(random), -spread(random)) *
+				XMMatrixRotationRollPitchYaw(angle(random) * 0.5f, angle(random), 0) *
+				XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 80.0f));
+			Frustum frustum = Frustum::FromMatrix(viewProjection);
+
+			std::vector<unsigned int> found, expected;
+			bvh.QueryFrustum(frustum, found);
+			for (unsigned int i = 0; i < boxes.size(); i++)
+			{
+				if (frustum.IntersectsBox(boxes[i].center, boxes[i].extents))
+					expected.push_back(i);
+			}
+			frustumsMatch = frustumsMatch && Sorted(found) == expected;
+
+			Sphere sphere = { XMFLOAT3(spread(random), spread(random), spread(random)), std::abs(spread(random)) * 0.3f };
+			found.clear();
+			expected.clear();
+			bvh.QuerySphere(sphere, found);
+			for (unsigned int i = 0; i < boxes.size(); i++)
+			{
+				if (BvhTests::BoxTouchesSphere(boxes[i], sphere))
+					expected.push_back(i);
+			}
+			spheresMatch = spheresMatch && Sorted(found) == expected;
+
+			// The nearest box along the ray; on a tie either item will do
+			XMFLOAT3 origin(spread(random), spread(random), spread(random));
+			XMFLOAT3 direction;
+			XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(normal(random), normal(random), normal(random), 0)));
+			XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+			float maxDistance = 200.0f;
+
+			bool expectedFound = false;
+			float nearest = maxDistance;
+			for (const Aabb& box : boxes)
+			{
+				float distance;
+				if (BvhTests::RayEntersBox(box, origin, inverseDirection, nearest, distance) && (!expectedFound || distance < nearest))
+				{
+					nearest = distance;
+					expectedFound = true;
+				}
+			}
+
+			Bvh::RayHit hit;
+			bool hitFound = bvh.Raycast(origin, direction, maxDistance, hit);
+			float itemDistance = 0.0f;
+			bool itemEntered = hitFound && BvhTests::RayEntersBox(boxes[hit.item], origin, inverseDirection, maxDistance, itemDistance);
+			raysMatch = raysMatch && hitFound == expectedFound &&
+				(!hitFound || (hit.distance == nearest && itemEntered && itemDistance == nearest));
+		}
+
+		Check(frustumsMatch, "BVH (%s): Frustum queries differ from testing every box", name);
+		Check(spheresMatch, "BVH (%s): Sphere queries differ from testing every box", name);
+		Check(raysMatch, "BVH (%s): Raycasts differ from testing every box", name);
+	}
+
+	void TestBvh()
+	{
+		std::mt19937 random(9);
+		std::uniform_real_distribution<float> spread(-50.0f, 50.0f);
+		std::uniform_real_distribution<float> size(0.0f, 3.0f);
+
+		// Mostly small boxes, some large, some flat, and some duplicates
+		std::vector<Aabb> boxes;
+		for (int i = 0; i < 3000; i++)
+		{
+			XMFLOAT3 center(spread(random), spread(random), spread(random));
+			XMFLOAT3 extents(size(random), size(random), i % 10 == 0 ? 0.0f : size(random));
+			if (i % 50 == 0)
+				extents = XMFLOAT3(extents.x * 8, extents.y * 8, extents.z * 8);
+			boxes.push_back({ center, extents });
+			if (i % 100 == 0)
+				boxes.push_back(boxes.back());
+		}
+
+		Bvh bvh;
+		bvh.Build(boxes);
+		Check(bvh.GetItemCount() == boxes.size(), "BVH: Built over %zu of %zu boxes", bvh.GetItemCount(), boxes.size());
+		CheckBvhQueries("built", bvh, boxes, random);
+
+		// Everything moves, some a long way, and sizes change
+		std::uniform_real_distribution<float> nudge(-2.0f, 2.0f);
+		for (size_t i = 0; i < boxes.size(); i++)
+		{
+			float reach = i % 7 == 0 ? 20.0f : 1.0f;
+			boxes[i].center = XMFLOAT3(boxes[i].center.x + nudge(random) * reach, boxes[i].center.y + nudge(random) * reach, boxes[i].center.z + nudge(random) * reach);
+			boxes[i].extents.x *= i % 3 == 0 ? 2.0f : 0.5f;
+		}
+		bvh.Refit(boxes);
+		CheckBvhQueries("refit", bvh, boxes, random);
+	}
+}
+
+
+// --------------------------------------------------------
+// Runs the checks for each part in turn
+// --------------------------------------------------------
+int SelfTest::Run(const std::string& modelDirectory)
+{
+	checkCount = 0;
+	failureCount = 0;
+
+	std::vector<std::string> models = FindModels(modelDirectory);
+	Check(!models.empty(), "No OBJ files found in %s", modelDirectory.c_str());
+
+	TestObjLoader(models);
+	TestMeshCache(models);
+	TestMeshOptimizer(models);
+	TestVertexPacking(models);
+	TestMeshlets(models);
+	TestLods(models);
+	TestTangents(models);
+	TestBounds(models);
+	TestFileRegistry(models, 1);
+	TestFileRegistry(models, 8);
+	TestRangeAllocator();
+	TestStaticBatching();
+	TestTransformHierarchy(1);
+	TestTransformHierarchy(4);
+	TestInverseTranspose();
+	TestEntityStore();
+	TestCulling();
+	TestBvh();
+
+	printf("%d of %d checks passed\n", checkCount - failureCount, checkCount);
+	return failureCount;
+}
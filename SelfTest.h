@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+// --------------------------------------------------------
+// Headless checks of the CPU-side import and scene code
+//
+// - Needs no window or graphics device (see the -test
+//   switch in Main.cpp)
+// - Prints each failed check as it goes
+// --------------------------------------------------------
+namespace SelfTest
+{
+	// Runs every check, with the bundled OBJ files read from
+	// modelDirectory, and returns how many failed
+	int Run(const std::string& modelDirectory);
+}
@@ -4,15 +4,21 @@
 // Constant Buffer for external (C++) data
 cbuffer externalData : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
+	uint objectIndex;
 };
+
+// Every object's matrices (see ObjectCache)
+StructuredBuffer<ObjectData> Objects : register(t0);
+
 // --------------------------------------------------------
 // A simplified vertex shader for rendering to a shadow map
 // --------------------------------------------------------
 float4 main(VertexShaderInput input) : SV_POSITION
 {
+	matrix world = Objects[objectIndex].world;
+
 	matrix wvp = mul(projection, mul(view, world));
 	return mul(wvp, float4(input.localPosition, 1.0f));
 }
\ No newline at end of file
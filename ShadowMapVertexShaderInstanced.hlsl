@@ -0,0 +1,23 @@
+#include "GlobalShaderStructs.hlsli"
+
+
+// Constant Buffer for external (C++) data
+cbuffer externalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+// Every object's matrices, indexed by the instance data
+StructuredBuffer<ObjectData> Objects : register(t0);
+
+// --------------------------------------------------------
+// Shadow map vertex shader for instanced draws
+// --------------------------------------------------------
+float4 main(VertexShaderInput input, InstanceInput instance) : SV_POSITION
+{
+	matrix world = Objects[instance.objectIndex].world;
+
+	matrix wvp = mul(projection, mul(view, world));
+	return mul(wvp, float4(input.localPosition, 1.0f));
+}
@@ -0,0 +1,29 @@
+#include "GlobalShaderStructs.hlsli"
+
+
+// Constant Buffer for external (C++) data
+cbuffer externalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+	uint objectIndex;
+
+	// Dequantization for positions (see PositionQuantization)
+	float3 positionOffset;
+	float3 positionScale;
+};
+
+// Every object's matrices (see ObjectCache)
+StructuredBuffer<ObjectData> Objects : register(t0);
+
+// --------------------------------------------------------
+// Shadow map vertex shader for meshes using PackedVertex
+// --------------------------------------------------------
+float4 main(VertexShaderInput_Packed input) : SV_POSITION
+{
+	float3 localPosition = positionOffset + input.localPosition.xyz * positionScale;
+	matrix world = Objects[objectIndex].world;
+
+	matrix wvp = mul(projection, mul(view, world));
+	return mul(wvp, float4(localPosition, 1.0f));
+}
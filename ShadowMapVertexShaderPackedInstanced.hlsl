@@ -0,0 +1,29 @@
+#include "GlobalShaderStructs.hlsli"
+
+
+// Constant Buffer for external (C++) data
+cbuffer externalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+
+	// Dequantization for positions (see PositionQuantization)
+	float3 positionOffset;
+	float3 positionScale;
+};
+
+// Every object's matrices, indexed by the instance data
+StructuredBuffer<ObjectData> Objects : register(t0);
+
+// --------------------------------------------------------
+// Shadow map vertex shader for instanced draws of meshes
+// using PackedVertex
+// --------------------------------------------------------
+float4 main(VertexShaderInput_Packed input, InstanceInput instance) : SV_POSITION
+{
+	float3 localPosition = positionOffset + input.localPosition.xyz * positionScale;
+	matrix world = Objects[instance.objectIndex].world;
+
+	matrix wvp = mul(projection, mul(view, world));
+	return mul(wvp, float4(localPosition, 1.0f));
+}
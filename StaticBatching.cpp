@@ -0,0 +1,61 @@
+#include "StaticBatching.h"
+#include <stdexcept>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Moves one vertex into world space
+//
+// - Normals use the inverse transpose so they stay
+//   perpendicular to the surface under non-uniform scale,
+//   while tangents lie in the surface and use the matrix
+//   itself
+// --------------------------------------------------------
+Vertex StaticBatching::TransformVertex(const Vertex& vertex, const XMFLOAT4X4& world, const XMFLOAT4X4& worldInverseTranspose)
+{
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+	XMMATRIX normalMatrix = XMLoadFloat4x4(&worldInverseTranspose);
+
+	Vertex transformed = vertex;
+	XMStoreFloat3(&transformed.Position, XMVector3TransformCoord(XMLoadFloat3(&vertex.Position), worldMatrix));
+	XMStoreFloat3(&transformed.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), normalMatrix)));
+	XMStoreFloat3(&transformed.tangent, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.tangent), worldMatrix)));
+	return transformed;
+}
+
+// --------------------------------------------------------
+// Concatenates every instance's world space vertices and
+// rebased indices into one mesh
+// --------------------------------------------------------
+MeshData StaticBatching::Merge(const std::vector<Instance>& instances)
+{
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (const Instance& instance : instances)
+	{
+		vertexCount += instance.vertexCount;
+		indexCount += instance.indexCount;
+	}
+
+	if (vertexCount > 0xFFFFFFFFull)
+		throw std::length_error("Static batch has too many vertices for 32-bit indices");
+
+	MeshData batch;
+	batch.vertices.reserve(vertexCount);
+	batch.indices.reserve(indexCount);
+
+	for (const Instance& instance : instances)
+	{
+		XMFLOAT4X4 worldInverseTranspose;
+		XMStoreFloat4x4(&worldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(nullptr, XMLoadFloat4x4(&instance.world))));
+
+		unsigned int firstVertex = (unsigned int)batch.vertices.size();
+		for (size_t i = 0; i < instance.vertexCount; i++)
+			batch.vertices.push_back(TransformVertex(instance.vertices[i], instance.world, worldInverseTranspose));
+
+		for (size_t i = 0; i < instance.indexCount; i++)
+			batch.indices.push_back(firstVertex + instance.indices[i]);
+	}
+
+	return batch;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+#include "MeshData.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Merges meshes that never move into a single world space
+// mesh, so they can be drawn with one call
+// --------------------------------------------------------
+namespace StaticBatching
+{
+	// One placed copy of a mesh
+	struct Instance
+	{
+		const Vertex* vertices;
+		size_t vertexCount;
+		const unsigned int* indices;
+		size_t indexCount;
+		DirectX::XMFLOAT4X4 world;
+	};
+
+	// Puts a single vertex into world space
+	// - worldInverseTranspose is the inverse transpose of world
+	Vertex TransformVertex(const Vertex& vertex, const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& worldInverseTranspose);
+
+	// All of the instances in world space, one after another, with
+	// each instance's indices offset past the vertices before it
+	// - Triangles keep their order and winding, so a mirrored instance
+	//   faces the same way it did when drawn with its own world matrix
+	// - Only vertices and indices are filled in
+	MeshData Merge(const std::vector<Instance>& instances);
+}
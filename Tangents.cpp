@@ -0,0 +1,290 @@
+#include "Tangents.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// Where a thread adds up its tangents: either straight into the
+	// vertices' own tangents or into a separate array, so both can
+	// be indexed the same way
+	struct TangentSums
+	{
+		char* first;
+		size_t stride;
+
+		XMFLOAT3& operator[](size_t index) const
+		{
+			return *(XMFLOAT3*)(first + index * stride);
+		}
+	};
+
+	// --------------------------------------------------------
+	// Loads one corner of four triangles as structure-of-arrays
+	// registers, one triangle per lane
+	//
+	// - Position and uv.x sit next to each other in a Vertex, so
+	//   each corner is a single unaligned load, and a transpose
+	//   turns four of those into x, y, z and u registers
+	// --------------------------------------------------------
+	void LoadCorner(const Vertex* vertices, const unsigned int* triangles, int corner,
+		__m128& x, __m128& y, __m128& z, __m128& u, __m128& v)
+	{
+		const Vertex& a = vertices[triangles[corner]];
+		const Vertex& b = vertices[triangles[3 + corner]];
+		const Vertex& c = vertices[triangles[6 + corner]];
+		const Vertex& d = vertices[triangles[9 + corner]];
+
+		x = _mm_loadu_ps(&a.Position.x);
+		y = _mm_loadu_ps(&b.Position.x);
+		z = _mm_loadu_ps(&c.Position.x);
+		u = _mm_loadu_ps(&d.Position.x);
+		_MM_TRANSPOSE4_PS(x, y, z, u);
+
+		v = _mm_setr_ps(a.uv.y, b.uv.y, c.uv.y, d.uv.y);
+	}
+
+	// --------------------------------------------------------
+	// Tangents of four triangles at once, one per lane
+	//
+	// - Triangles whose uvs have no area get a zero tangent
+	//   rather than the infinities dividing by zero would give
+	// --------------------------------------------------------
+	void TriangleTangents(const Vertex* vertices, const unsigned int* triangles, __m128& tx, __m128& ty, __m128& tz)
+	{
+		__m128 x0, y0, z0, u0, v0;
+		__m128 x1, y1, z1, u1, v1;
+		__m128 x2, y2, z2, u2, v2;
+		LoadCorner(vertices, triangles, 0, x0, y0, z0, u0, v0);
+		LoadCorner(vertices, triangles, 1, x1, y1, z1, u1, v1);
+		LoadCorner(vertices, triangles, 2, x2, y2, z2, u2, v2);
+
+		// Vectors relative to the first corner's position and uv
+		x1 = _mm_sub_ps(x1, x0);
+		y1 = _mm_sub_ps(y1, y0);
+		z1 = _mm_sub_ps(z1, z0);
+		x2 = _mm_sub_ps(x2, x0);
+		y2 = _mm_sub_ps(y2, y0);
+		z2 = _mm_sub_ps(z2, z0);
+		__m128 s1 = _mm_sub_ps(u1, u0);
+		__m128 t1 = _mm_sub_ps(v1, v0);
+		__m128 s2 = _mm_sub_ps(u2, u0);
+		__m128 t2 = _mm_sub_ps(v2, v0);
+
+		__m128 determinant = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+		__m128 valid = _mm_cmpneq_ps(determinant, _mm_setzero_ps());
+		__m128 r = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+		tx = _mm_and_ps(valid, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r));
+		ty = _mm_and_ps(valid, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r));
+		tz = _mm_and_ps(valid, _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r));
+	}
+
+	// --------------------------------------------------------
+	// Adds the tangents of a range of triangles to every corner
+	//
+	// - Works four triangles at a time, with the last few padded
+	//   out by repeating the final triangle (whose extra results
+	//   are thrown away)
+	// --------------------------------------------------------
+	void AccumulateTriangles(const Vertex* vertices, const unsigned int* indices, size_t firstTriangle, size_t endTriangle, const TangentSums& sums)
+	{
+		alignas(16) float tx[4], ty[4], tz[4];
+		for (size_t t = firstTriangle; t < endTriangle; t += 4)
+		{
+			size_t lanes = std::min<size_t>(4, endTriangle - t);
+			const unsigned int* triangles = indices + t * 3;
+
+			unsigned int padded[12];
+			if (lanes < 4)
+			{
+				for (size_t i = 0; i < 12; i++)
+					padded[i] = triangles[std::min(i / 3, lanes - 1) * 3 + i % 3];
+				triangles = padded;
+			}
+
+			__m128 x, y, z;
+			TriangleTangents(vertices, triangles, x, y, z);
+			_mm_store_ps(tx, x);
+			_mm_store_ps(ty, y);
+			_mm_store_ps(tz, z);
+
+			for (size_t lane = 0; lane < lanes; lane++)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					XMFLOAT3& sum = sums[triangles[lane * 3 + corner]];
+					sum.x += tx[lane];
+					sum.y += ty[lane];
+					sum.z += tz[lane];
+				}
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Adds in the other threads' sums for a range of vertices and
+	// makes the tangents unit length and perpendicular to the
+	// normals (Gram-Schmidt), four vertices at a time
+	// --------------------------------------------------------
+	void OrthonormalizeVertices(Vertex* vertices, size_t firstVertex, size_t endVertex, const std::vector<std::vector<XMFLOAT3>>& extraSums)
+	{
+		alignas(16) float nx[4], ny[4], nz[4];
+		alignas(16) float tx[4], ty[4], tz[4];
+		for (size_t v = firstVertex; v < endVertex; v += 4)
+		{
+			// The last block repeats its final vertex in the unused lanes
+			size_t lanes = std::min<size_t>(4, endVertex - v);
+			for (size_t lane = 0; lane < 4; lane++)
+			{
+				size_t index = v + std::min(lane, lanes - 1);
+				const Vertex& vertex = vertices[index];
+				nx[lane] = vertex.normal.x;
+				ny[lane] = vertex.normal.y;
+				nz[lane] = vertex.normal.z;
+				tx[lane] = vertex.tangent.x;
+				ty[lane] = vertex.tangent.y;
+				tz[lane] = vertex.tangent.z;
+
+				for (const std::vector<XMFLOAT3>& sums : extraSums)
+				{
+					tx[lane] += sums[index].x;
+					ty[lane] += sums[index].y;
+					tz[lane] += sums[index].z;
+				}
+			}
+
+			__m128 x = _mm_load_ps(tx);
+			__m128 y = _mm_load_ps(ty);
+			__m128 z = _mm_load_ps(tz);
+			__m128 normalX = _mm_load_ps(nx);
+			__m128 normalY = _mm_load_ps(ny);
+			__m128 normalZ = _mm_load_ps(nz);
+
+			// Remove the part of the tangent along the normal
+			__m128 dot = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(normalX, x),
+				_mm_mul_ps(normalY, y)),
+				_mm_mul_ps(normalZ, z));
+			x = _mm_sub_ps(x, _mm_mul_ps(normalX, dot));
+			y = _mm_sub_ps(y, _mm_mul_ps(normalY, dot));
+			z = _mm_sub_ps(z, _mm_mul_ps(normalZ, dot));
+
+			// Normalize, leaving zero length tangents at zero
+			__m128 lengthSq = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(x, x),
+				_mm_mul_ps(y, y)),
+				_mm_mul_ps(z, z));
+			__m128 nonZero = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+			__m128 inverseLength = _mm_and_ps(nonZero, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSq)));
+
+			_mm_store_ps(tx, _mm_mul_ps(x, inverseLength));
+			_mm_store_ps(ty, _mm_mul_ps(y, inverseLength));
+			_mm_store_ps(tz, _mm_mul_ps(z, inverseLength));
+
+			for (size_t lane = 0; lane < lanes; lane++)
+				vertices[v + lane].tangent = XMFLOAT3(tx[lane], ty[lane], tz[lane]);
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// Calculates the tangent of every vertex, each thread adding
+// into its own sums
+// --------------------------------------------------------
+void Tangents::Calculate(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, unsigned int threadCount)
+{
+	if (vertexCount == 0)
+		return;
+
+	size_t triangleCount = indexCount / 3;
+	if (threadCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		size_t chunksWorthSplitting = triangleCount / ParallelTriangleCount + 1;
+		threadCount = (unsigned int)std::min<size_t>(chunksWorthSplitting, hardwareThreads > 0 ? hardwareThreads : 1);
+	}
+
+	for (size_t i = 0; i < vertexCount; i++)
+		vertices[i].tangent = XMFLOAT3(0, 0, 0);
+
+	// Each thread adds up the tangents of its own run of triangles
+	std::vector<std::vector<XMFLOAT3>> extraSums(threadCount - 1);
+	Parallel::RunParallel(threadCount, [&](unsigned int t)
+	{
+		TangentSums sums = { (char*)&vertices[0].tangent, sizeof(Vertex) };
+		if (t > 0)
+		{
+			extraSums[t - 1].assign(vertexCount, XMFLOAT3(0, 0, 0));
+			sums = { (char*)extraSums[t - 1].data(), sizeof(XMFLOAT3) };
+		}
+
+		size_t firstTriangle = triangleCount * t / threadCount;
+		size_t endTriangle = triangleCount * (t + 1) / threadCount;
+		AccumulateTriangles(vertices, indices, firstTriangle, endTriangle, sums);
+	});
+
+	// Then each thread finishes its own run of vertices (in whole blocks of four)
+	size_t blockCount = (vertexCount + 3) / 4;
+	Parallel::RunParallel(threadCount, [&](unsigned int t)
+	{
+		size_t firstVertex = blockCount * t / threadCount * 4;
+		size_t endVertex = std::min(blockCount * (t + 1) / threadCount * 4, vertexCount);
+		OrthonormalizeVertices(vertices, firstVertex, endVertex, extraSums);
+	});
+}
+
+// --------------------------------------------------------
+// Calculates the tangent of every vertex without SIMD
+// --------------------------------------------------------
+void Tangents::CalculateScalar(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount)
+{
+	for (size_t i = 0; i < vertexCount; i++)
+		vertices[i].tangent = XMFLOAT3(0, 0, 0);
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		Vertex* v1 = &vertices[indices[i]];
+		Vertex* v2 = &vertices[indices[i + 1]];
+		Vertex* v3 = &vertices[indices[i + 2]];
+
+		float x1 = v2->Position.x - v1->Position.x;
+		float y1 = v2->Position.y - v1->Position.y;
+		float z1 = v2->Position.z - v1->Position.z;
+		float x2 = v3->Position.x - v1->Position.x;
+		float y2 = v3->Position.y - v1->Position.y;
+		float z2 = v3->Position.z - v1->Position.z;
+
+		float s1 = v2->uv.x - v1->uv.x;
+		float t1 = v2->uv.y - v1->uv.y;
+		float s2 = v3->uv.x - v1->uv.x;
+		float t2 = v3->uv.y - v1->uv.y;
+
+		// Degenerate uvs add nothing
+		float determinant = s1 * t2 - s2 * t1;
+		if (determinant == 0.0f)
+			continue;
+
+		float r = 1.0f / determinant;
+		XMFLOAT3 tangent((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r);
+		for (Vertex* v : { v1, v2, v3 })
+		{
+			v->tangent.x += tangent.x;
+			v->tangent.y += tangent.y;
+			v->tangent.z += tangent.z;
+		}
+	}
+
+	// Gram-Schmidt orthonormalize, leaving zero length tangents at zero
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		XMVECTOR normal = XMLoadFloat3(&vertices[i].normal);
+		XMVECTOR tangent = XMLoadFloat3(&vertices[i].tangent);
+		XMStoreFloat3(&vertices[i].tangent, XMVector3Normalize(tangent - normal * XMVector3Dot(normal, tangent)));
+	}
+}
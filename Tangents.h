@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Generates per-vertex tangents from positions and uvs
+// (FGED2, listing 7.4), four triangles at a time with SSE
+// --------------------------------------------------------
+namespace Tangents
+{
+	// Roughly how many triangles each thread should get before
+	// it's worth spreading a mesh across threads
+	const size_t ParallelTriangleCount = 64 * 1024;
+
+	// Overwrites the tangent of every vertex
+	// - Triangles with degenerate uvs add nothing, and vertices
+	//   left without any tangent get a zero vector
+	// - A thread count of 0 picks one based on the triangle count
+	void Calculate(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount, unsigned int threadCount = 0);
+
+	// Same results one triangle at a time, the way Mesh used to,
+	// to check and time Calculate() against
+	void CalculateScalar(Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+}
@@ -1,58 +1,62 @@
 #include "Transform.h"
+#include "TransformSystem.h"
+#include <cmath>
+#include <utility>
 
 using namespace DirectX;
 
-// Setting default values in constructor
+// New transforms start as the identity
 Transform::Transform()
-	: position(0.0f, 0.0f, 0.0f), rotation(0.0f, 0.0f, 0.0f), scale(1.0f, 1.0f, 1.0f), dirty(true),
-	rightward(1.0f, 0.0f, 0.0f), upward(0.0f, 1.0f, 0.0f), forward(0.0f, 0.0f, 1.0f)
+	: slot(TransformSystem::Create(this))
 {
-	// Storing the identity matrix as the world matrix and inverse matrix
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	XMStoreFloat4x4(&worldInverseTranspose, XMMatrixIdentity());
-
 }
 
-/// <summary>
-/// Updates the world martix based on any tranformations made to it
-/// </summary>
-void Transform::UpdateWorldMatrix()
+// Copies of an empty (moved-from) transform are the identity
+Transform::Transform(const Transform& other)
+	: slot(other.slot == TransformSystem::NoSlot ?
+		TransformSystem::Create(this) :
+		TransformSystem::Clone(other.slot, this))
 {
-	if (dirty)
-	{
-		// Using SRT to apply transformations
-		XMMATRIX world = XMMatrixScaling(scale.x, scale.y, scale.z) * 
-			XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) * 
-			XMMatrixTranslation(position.x, position.y, position.z);
-
-		// Storing the updated world matrix and its inverse transpose
-		XMStoreFloat4x4(&worldMatrix, world);
-		XMStoreFloat4x4(&worldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+}
 
-		// Updating directional vectors
-		UpdateDirectionalVectors();
+Transform::Transform(Transform&& other) noexcept
+	: slot(other.slot)
+{
+	other.slot = TransformSystem::NoSlot;
+	TransformSystem::SetOwner(slot, this);
+}
 
-		dirty = false;
-	}
+Transform& Transform::operator=(const Transform& other)
+{
+	if (other.slot == TransformSystem::NoSlot)
+		TransformSystem::CopyTo(Transform().slot, Slot());
+	else
+		TransformSystem::CopyTo(other.slot, Slot());
+	return *this;
 }
 
-/// <summary>
-/// Updating directional vectors instead of updating them in the getters
-/// </summary>
-void Transform::UpdateDirectionalVectors()
+// Swaps slots, so the source takes this one's old slot with it
+Transform& Transform::operator=(Transform&& other) noexcept
 {
-	// Making a rotation quaternion for current rotation
-	XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
+	std::swap(slot, other.slot);
+	TransformSystem::SetOwner(slot, this);
+	TransformSystem::SetOwner(other.slot, &other);
+	return *this;
+}
 
-	// Updating directional vectors
-	XMVECTOR rightVector = XMVector3Rotate(XMVectorSet(1, 0, 0, 0), rotationQuat);
-	XMVECTOR upVector = XMVector3Rotate(XMVectorSet(0, 1, 0, 0), rotationQuat);
-	XMVECTOR forwardVector = XMVector3Rotate(XMVectorSet(0, 0, 1, 0), rotationQuat);
+Transform::~Transform()
+{
+	if (slot != TransformSystem::NoSlot)
+		TransformSystem::Destroy(slot);
+}
 
-	// Storing vectors inside fields
-	XMStoreFloat3(&rightward, rightVector);
-	XMStoreFloat3(&upward, upVector);
-	XMStoreFloat3(&forward, forwardVector);
+// An empty (moved-from) transform gets a new slot, as the
+// identity, the first time it's used again
+unsigned int Transform::Slot()
+{
+	if (slot == TransformSystem::NoSlot)
+		slot = TransformSystem::Create(this);
+	return slot;
 }
 
 //--------
@@ -60,16 +64,28 @@ void Transform::UpdateDirectionalVectors()
 // -------
 
 // Position setters
-void Transform::SetPosition(float x, float y, float z) { position = { x, y, z }; dirty = true; }
-void Transform::SetPosition(XMFLOAT3 pos) { position = pos; dirty = true; }
+void Transform::SetPosition(float x, float y, float z) { SetPosition(XMFLOAT3(x, y, z)); }
+void Transform::SetPosition(XMFLOAT3 pos) { TransformSystem::SetPosition(Slot(), pos); }
 
 // Rotation setters
-void Transform::SetRotation(float pitch, float yaw, float roll) { rotation = { pitch, yaw, roll }; dirty = true; }
-void Transform::SetRotation(XMFLOAT3 rot) { rotation = rot; dirty = true;}
+void Transform::SetRotation(float pitch, float yaw, float roll)
+{
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionRotationRollPitchYaw(pitch, yaw, roll));
+	SetRotation(quaternion);
+}
+
+void Transform::SetRotation(XMFLOAT3 rot) { SetRotation(rot.x, rot.y, rot.z); }
+
+void Transform::SetRotation(XMFLOAT4 quaternion)
+{
+	XMStoreFloat4(&quaternion, XMQuaternionNormalize(XMLoadFloat4(&quaternion)));
+	TransformSystem::SetRotation(Slot(), quaternion);
+}
 
 // Scale setters
-void Transform::SetScale(float x, float y, float z) { scale = { x, y, z }; dirty = true; }
-void Transform::SetScale(XMFLOAT3 scl) { scale = scl; dirty = true; }
+void Transform::SetScale(float x, float y, float z) { SetScale(XMFLOAT3(x, y, z)); }
+void Transform::SetScale(XMFLOAT3 scl) { TransformSystem::SetScale(Slot(), scl); }
 
 
 //--------
@@ -77,23 +93,61 @@ void Transform::SetScale(XMFLOAT3 scl) { scale = scl; dirty = true; }
 // -------
 
 // Transform getters
-XMFLOAT3 Transform::GetPosition() { return position; }
-XMFLOAT3 Transform::GetPitchYawRoll() { return rotation; }
-XMFLOAT3 Transform::GetScale() { return scale; }
+XMFLOAT3 Transform::GetPosition() { return TransformSystem::GetPosition(Slot()); }
+XMFLOAT4 Transform::GetRotation() { return TransformSystem::GetRotation(Slot()); }
 
-// Matrix getters
-XMFLOAT4X4 Transform::GetWorldMatrix() 
-{ 
-	UpdateWorldMatrix();
-	return worldMatrix; 
+/// <summary>
+/// Recovers Euler angles from the quaternion's rotation matrix, which is
+/// roll * pitch * yaw: pitch and yaw come from its third row, then roll
+/// from the first two rows with yaw taken back out, which stays accurate
+/// even looking straight up or down (where yaw and roll share an axis)
+/// </summary>
+XMFLOAT3 Transform::GetPitchYawRoll()
+{
+	XMFLOAT4 q = GetRotation();
+	float r00 = 1.0f - 2.0f * (q.y * q.y + q.z * q.z);
+	float r02 = 2.0f * (q.x * q.z - q.y * q.w);
+	float r10 = 2.0f * (q.x * q.y - q.z * q.w);
+	float r12 = 2.0f * (q.y * q.z + q.x * q.w);
+	float r20 = 2.0f * (q.x * q.z + q.y * q.w);
+	float r21 = 2.0f * (q.y * q.z - q.x * q.w);
+	float r22 = 1.0f - 2.0f * (q.x * q.x + q.y * q.y);
+
+	float pitch = atan2f(-r21, sqrtf(r20 * r20 + r22 * r22));
+	float yaw = atan2f(r20, r22);
+
+	float sinYaw = sinf(yaw);
+	float cosYaw = cosf(yaw);
+	float roll = atan2f(sinYaw * r12 - cosYaw * r10, cosYaw * r00 - sinYaw * r02);
+
+	return XMFLOAT3(pitch, yaw, roll);
 }
+XMFLOAT3 Transform::GetScale() { return TransformSystem::GetScale(Slot()); }
 
-DirectX::XMFLOAT4X4 Transform::GetWorldInverseTranspose() { return worldInverseTranspose; }
+// Matrix getters (these update the matrices first if anything changed)
+// - Matrices and directions are in world space, including the parent
+XMFLOAT4X4 Transform::GetWorldMatrix() { return TransformSystem::GetWorldMatrix(Slot()); }
+XMFLOAT4X4 Transform::GetWorldInverseTranspose() { return TransformSystem::GetWorldInverseTranspose(Slot()); }
 
 // Directional vectors getters
-XMFLOAT3 Transform::GetRight() { return rightward; }
-XMFLOAT3 Transform::GetUp() { return upward; }
-XMFLOAT3 Transform::GetForward() { return forward; }
+XMFLOAT3 Transform::GetRight() { return TransformSystem::GetRight(Slot()); }
+XMFLOAT3 Transform::GetUp() { return TransformSystem::GetUp(Slot()); }
+XMFLOAT3 Transform::GetForward() { return TransformSystem::GetForward(Slot()); }
+
+unsigned int Transform::GetSlot() { return Slot(); }
+unsigned int Transform::GetVersion() { return TransformSystem::GetVersion(Slot()); }
+
+
+//----------
+// Hierarchy
+//----------
+
+void Transform::SetParent(Transform* parent)
+{
+	TransformSystem::SetParent(Slot(), parent ? parent->Slot() : TransformSystem::NoSlot);
+}
+
+Transform* Transform::GetParent() { return TransformSystem::GetOwner(TransformSystem::GetParent(Slot())); }
 
 
 //-------------
@@ -103,10 +157,8 @@ XMFLOAT3 Transform::GetForward() { return forward; }
 // Position transformers
 void Transform::MoveAbsolute(float x, float y, float z)
 {
-	position.x += x;
-	position.y += y;
-	position.z += z;
-	dirty = true;
+	XMFLOAT3 position = GetPosition();
+	SetPosition(position.x + x, position.y + y, position.z + z);
 }
 
 void Transform::MoveAbsolute(XMFLOAT3 pos)
@@ -117,12 +169,21 @@ void Transform::MoveAbsolute(XMFLOAT3 pos)
 // Rotation transformers
 void Transform::Rotate(float pitch, float yaw, float roll)
 {
-	rotation.x += pitch;
-	rotation.y += yaw;
-	rotation.z += roll;
-	dirty = true;
-	UpdateDirectionalVectors();
+	XMFLOAT4 current = GetRotation();
+	XMVECTOR rotation = XMLoadFloat4(&current);
+
+	// Pitch and roll happen before the current rotation, in local space...
+	if (pitch != 0.0f || roll != 0.0f)
+		rotation = XMQuaternionMultiply(XMQuaternionRotationRollPitchYaw(pitch, 0.0f, roll), rotation);
+
+	// ...and yaw after it, about the up axis
+	if (yaw != 0.0f)
+		rotation = XMQuaternionMultiply(rotation, XMQuaternionRotationNormal(XMVectorSet(0, 1, 0, 0), yaw));
 
+	// Renormalized so repeated small turns don't drift
+	XMFLOAT4 quaternion;
+	XMStoreFloat4(&quaternion, XMQuaternionNormalize(rotation));
+	TransformSystem::SetRotation(Slot(), quaternion);
 }
 
 void Transform::Rotate(XMFLOAT3 rot)
@@ -133,10 +194,8 @@ void Transform::Rotate(XMFLOAT3 rot)
 // Scale transformers
 void Transform::Scale(float x, float y, float z)
 {
-	scale.x *= x;
-	scale.y *= y;
-	scale.z *= z;
-	dirty = true;
+	XMFLOAT3 scale = GetScale();
+	SetScale(scale.x * x, scale.y * y, scale.z * z);
 }
 
 void Transform::Scale(XMFLOAT3 scl)
@@ -146,21 +205,15 @@ void Transform::Scale(XMFLOAT3 scl)
 
 void Transform::MoveRelative(float x, float y, float z)
 {
-	// Making a rotation quaternion for current rotation
-	XMVECTOR rotationQuat = XMQuaternionRotationRollPitchYaw(rotation.x, rotation.y, rotation.z);
-
-	// Getting the absolute direction and rotating it by the current rotation
-	XMVECTOR relativeTransform = XMVector3Rotate(XMVectorSet(x, y, z, 0), rotationQuat);
+	// Rotating the offset by the stored rotation
+	XMFLOAT4 rotation = GetRotation();
+	XMVECTOR relativeTransform = XMVector3Rotate(XMVectorSet(x, y, z, 0), XMLoadFloat4(&rotation));
 
 	// Storing the relative transform as a float3 so that it can be applied to current position
 	XMFLOAT3 move;
 	XMStoreFloat3(&move, relativeTransform);
 
-	position.x += move.x;
-	position.y += move.y;
-	position.z += move.z;
-
-	dirty = true;
+	MoveAbsolute(move);
 }
 
 void Transform::MoveRelative(XMFLOAT3 offset)
@@ -168,7 +221,3 @@ void Transform::MoveRelative(XMFLOAT3 offset)
 	// Calling the other move relative method for it to handle the work
 	MoveRelative(offset.x, offset.y, offset.z);
 }
-
-
-
-
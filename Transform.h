@@ -2,34 +2,26 @@
 #include <DirectXMath.h>
 
 
+// A handle to one slot of the TransformSystem, which stores the data
+// and updates the matrices
+// - Copies get a slot of their own; moves hand the slot over, and
+//   an emptied transform gets a new one when next used
 class Transform
 {
 
 private:
 
-	// Variables
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 rotation;
-	DirectX::XMFLOAT3 scale;
-	DirectX::XMFLOAT3 forward;
-	DirectX::XMFLOAT3 rightward;
-	DirectX::XMFLOAT3 upward;
-
-
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT4X4 worldInverseTranspose;
-
-	bool dirty;
-
-	//--------
-	// Methods
-	//--------
-
-	void UpdateWorldMatrix();
-	void UpdateDirectionalVectors();
+	// Where this transform's data lives in the TransformSystem
+	unsigned int slot;
+	unsigned int Slot();
 
 public:
 	Transform();
+	Transform(const Transform& other);
+	Transform(Transform&& other) noexcept;
+	Transform& operator=(const Transform& other);
+	Transform& operator=(Transform&& other) noexcept;
+	~Transform();
 
 	//--------
 	// Setters
@@ -40,8 +32,10 @@ public:
 	void SetPosition(DirectX::XMFLOAT3 position);
 
 	// Rotation setters
+	// - Stored as a quaternion; Euler angles are converted on the way in
 	void SetRotation(float pitch, float yaw, float roll);
 	void SetRotation(DirectX::XMFLOAT3 rotation); 
+	void SetRotation(DirectX::XMFLOAT4 quaternion);
 
 	// Scale setters
 	void SetScale(float x, float y, float z);
@@ -53,7 +47,8 @@ public:
 	
 	// Getters for transforms
 	DirectX::XMFLOAT3 GetPosition();
-	DirectX::XMFLOAT3 GetPitchYawRoll();
+	DirectX::XMFLOAT3 GetPitchYawRoll();	// Converted from the quaternion, so may differ from what was set
+	DirectX::XMFLOAT4 GetRotation();
 	DirectX::XMFLOAT3 GetScale();
 	
 	// World matrix getters
@@ -65,6 +60,23 @@ public:
 	DirectX::XMFLOAT3 GetUp();
 	DirectX::XMFLOAT3 GetForward();
 
+	unsigned int GetSlot();
+
+	// Rises every time the world matrix may have changed, so anything
+	// computed from it can be kept until the version moves on
+	unsigned int GetVersion();
+
+
+	//----------
+	// Hierarchy
+	//----------
+
+	// Position, rotation and scale are relative to the parent, if any
+	// - nullptr detaches the transform
+	// - Throws if the parent is this transform or one of its children
+	void SetParent(Transform* parent);
+	Transform* GetParent();
+
 
 	//-------------
 	// Transformers
@@ -74,6 +86,9 @@ public:
 	void MoveAbsolute(float x, float y, float z);
 	void MoveAbsolute(DirectX::XMFLOAT3 offset);
 
+	// Yaw turns about the parent's up axis, pitch and roll about the
+	// transform's own axes (the same result as adding to the Euler
+	// angles, as long as roll is zero)
 	void Rotate(float pitch, float yaw, float roll);
 	void Rotate(DirectX::XMFLOAT3 rotation);
 
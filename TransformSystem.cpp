@@ -0,0 +1,641 @@
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// Slots are added a bitset word at a time, which also keeps
+	// every array a multiple of the SSE width
+	const unsigned int SlotsPerWord = 64;
+
+	// Scales smaller than this are treated as zero when inverting
+	const float ZeroScale = 1e-20f;
+
+	// Bitset words (local pass) and slots (hierarchy sweep) per job
+	const size_t LocalPassGrain = 16;
+	const size_t ComposeGrain = 256;
+
+	// Components, one array each, relative to the parent
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ, rotationW;	// Unit quaternion
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// Local values, computed from the components
+	// - Directions are stored as arrays too, since they come
+	//   straight out of the rotation registers
+	std::vector<XMFLOAT4X4> localMatrices;
+	std::vector<XMFLOAT4X4> localInverseTransposes;
+	std::vector<float> rightX, rightY, rightZ;
+	std::vector<float> upX, upY, upZ;
+	std::vector<float> forwardX, forwardY, forwardZ;
+
+	// World values, only used by slots with a parent (for the
+	// rest they're the local values)
+	std::vector<XMFLOAT4X4> worldMatrices;
+	std::vector<XMFLOAT4X4> worldInverseTransposes;
+	std::vector<XMFLOAT3> worldRights, worldUps, worldForwards;
+
+	// Hierarchy links, as slots
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> firstChildren;
+	std::vector<unsigned int> nextSiblings;
+	std::vector<unsigned int> previousSiblings;
+	std::vector<Transform*> owners;
+
+	// Bumped whenever a slot's world values may have changed, and
+	// never reset, so a slot's versions keep rising as it's reused
+	std::vector<unsigned int> versions;
+
+	// For slots with a parent, the slot's and parent's versions when
+	// it was last composed; its world values are stale once either
+	// has moved on
+	std::vector<unsigned int> composedVersions;
+	std::vector<unsigned int> composedParentVersions;
+
+	// Every slot with a parent, by depth: level 0 holds the roots'
+	// children, and so on, so each level only needs the ones before
+	// it (the order within a level doesn't matter)
+	// - Reparenting moves just the slot's subtree between levels
+	std::vector<std::vector<unsigned int>> hierarchyLevels;
+	std::vector<unsigned int> depths;			// 0 for roots
+	std::vector<unsigned int> levelPositions;	// Index in the slot's level
+	std::vector<unsigned int> subtreeStack;		// Reused while moving subtrees
+
+	// One bit per slot: components changed since the local values
+	// were computed
+	std::vector<uint64_t> localDirty;
+
+	std::vector<unsigned int> freeSlots;
+	size_t liveCount = 0;
+	size_t childCount = 0;
+	size_t lastUpdateCount = 0;
+	size_t lastComposeCount = 0;
+	double lastUpdateMs = 0.0;
+
+	void SetBit(std::vector<uint64_t>& bits, unsigned int slot)
+	{
+		bits[slot / SlotsPerWord] |= 1ull << (slot % SlotsPerWord);
+	}
+
+	bool IsSet(const std::vector<uint64_t>& bits, unsigned int slot)
+	{
+		return (bits[slot / SlotsPerWord] >> (slot % SlotsPerWord)) & 1;
+	}
+
+	// --------------------------------------------------------
+	// Adds a word's worth of slots, all free and holding the
+	// identity transform
+	// --------------------------------------------------------
+	void Grow()
+	{
+		size_t oldCapacity = positionX.size();
+		size_t capacity = oldCapacity + SlotsPerWord;
+
+		for (std::vector<float>* zeroes : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ,
+			&rightY, &rightZ, &upX, &upZ, &forwardX, &forwardY })
+			zeroes->resize(capacity, 0.0f);
+		for (std::vector<float>* ones : { &rotationW, &scaleX, &scaleY, &scaleZ, &rightX, &upY, &forwardZ })
+			ones->resize(capacity, 1.0f);
+
+		XMFLOAT4X4 identity;
+		XMStoreFloat4x4(&identity, XMMatrixIdentity());
+		localMatrices.resize(capacity, identity);
+		localInverseTransposes.resize(capacity, identity);
+		worldMatrices.resize(capacity, identity);
+		worldInverseTransposes.resize(capacity, identity);
+		worldRights.resize(capacity, XMFLOAT3(1, 0, 0));
+		worldUps.resize(capacity, XMFLOAT3(0, 1, 0));
+		worldForwards.resize(capacity, XMFLOAT3(0, 0, 1));
+
+		for (std::vector<unsigned int>* links : { &parents, &firstChildren, &nextSiblings, &previousSiblings })
+			links->resize(capacity, TransformSystem::NoSlot);
+		owners.resize(capacity, nullptr);
+		versions.resize(capacity, 0);
+		depths.resize(capacity, 0);
+		levelPositions.resize(capacity, 0);
+		composedVersions.resize(capacity, 0);
+		composedParentVersions.resize(capacity, 0);
+
+		localDirty.push_back(0);
+
+		// Handed out lowest first
+		for (size_t slot = capacity; slot > oldCapacity; slot--)
+			freeSlots.push_back((unsigned int)(slot - 1));
+	}
+
+	// Picks between a and b per lane
+	__m128 Select(__m128 mask, __m128 a, __m128 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	// Writes one row of four matrices, given each column's four lanes
+	void StoreRows(std::vector<XMFLOAT4X4>& matrices, unsigned int first, int row, __m128 c0, __m128 c1, __m128 c2, __m128 c3)
+	{
+		_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+		_mm_storeu_ps(&matrices[first + 0].m[row][0], c0);
+		_mm_storeu_ps(&matrices[first + 1].m[row][0], c1);
+		_mm_storeu_ps(&matrices[first + 2].m[row][0], c2);
+		_mm_storeu_ps(&matrices[first + 3].m[row][0], c3);
+	}
+
+	// --------------------------------------------------------
+	// Recomputes the local values of four consecutive slots
+	// - The inverse transpose comes from the scale directly, or
+	//   the cofactor matrix when a scale is zero
+	// --------------------------------------------------------
+	void UpdateGroup(unsigned int first)
+	{
+		__m128 qx = _mm_loadu_ps(&rotationX[first]);
+		__m128 qy = _mm_loadu_ps(&rotationY[first]);
+		__m128 qz = _mm_loadu_ps(&rotationZ[first]);
+		__m128 qw = _mm_loadu_ps(&rotationW[first]);
+
+		// Rotation rows, which are also the right, up and forward directions
+		__m128 one = _mm_set1_ps(1.0f);
+		__m128 two = _mm_set1_ps(2.0f);
+		__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+		__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+		__m128 xw = _mm_mul_ps(qx, qw), yw = _mm_mul_ps(qy, qw), zw = _mm_mul_ps(qz, qw);
+		__m128 r00 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+		__m128 r01 = _mm_mul_ps(two, _mm_add_ps(xy, zw));
+		__m128 r02 = _mm_mul_ps(two, _mm_sub_ps(xz, yw));
+		__m128 r10 = _mm_mul_ps(two, _mm_sub_ps(xy, zw));
+		__m128 r11 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+		__m128 r12 = _mm_mul_ps(two, _mm_add_ps(yz, xw));
+		__m128 r20 = _mm_mul_ps(two, _mm_add_ps(xz, yw));
+		__m128 r21 = _mm_mul_ps(two, _mm_sub_ps(yz, xw));
+		__m128 r22 = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+		_mm_storeu_ps(&rightX[first], r00);
+		_mm_storeu_ps(&rightY[first], r01);
+		_mm_storeu_ps(&rightZ[first], r02);
+		_mm_storeu_ps(&upX[first], r10);
+		_mm_storeu_ps(&upY[first], r11);
+		_mm_storeu_ps(&upZ[first], r12);
+		_mm_storeu_ps(&forwardX[first], r20);
+		_mm_storeu_ps(&forwardY[first], r21);
+		_mm_storeu_ps(&forwardZ[first], r22);
+
+		__m128 scx = _mm_loadu_ps(&scaleX[first]);
+		__m128 scy = _mm_loadu_ps(&scaleY[first]);
+		__m128 scz = _mm_loadu_ps(&scaleZ[first]);
+		__m128 px = _mm_loadu_ps(&positionX[first]);
+		__m128 py = _mm_loadu_ps(&positionY[first]);
+		__m128 pz = _mm_loadu_ps(&positionZ[first]);
+		__m128 zero = _mm_setzero_ps();
+
+		// Matrix
+		StoreRows(localMatrices, first, 0, _mm_mul_ps(r00, scx), _mm_mul_ps(r01, scx), _mm_mul_ps(r02, scx), zero);
+		StoreRows(localMatrices, first, 1, _mm_mul_ps(r10, scy), _mm_mul_ps(r11, scy), _mm_mul_ps(r12, scy), zero);
+		StoreRows(localMatrices, first, 2, _mm_mul_ps(r20, scz), _mm_mul_ps(r21, scz), _mm_mul_ps(r22, scz), zero);
+		StoreRows(localMatrices, first, 3, px, py, pz, one);
+
+		// Inverse transpose, or the cofactor matrix for lanes where it
+		// doesn't exist (the divisions there are discarded)
+		__m128 signBit = _mm_set1_ps(-0.0f);
+		__m128 smallest = _mm_set1_ps(ZeroScale);
+		__m128 singular = _mm_or_ps(_mm_or_ps(
+			_mm_cmplt_ps(_mm_andnot_ps(signBit, scx), smallest),
+			_mm_cmplt_ps(_mm_andnot_ps(signBit, scy), smallest)),
+			_mm_cmplt_ps(_mm_andnot_ps(signBit, scz), smallest));
+		__m128 ix = Select(singular, _mm_mul_ps(scy, scz), _mm_div_ps(one, scx));
+		__m128 iy = Select(singular, _mm_mul_ps(scx, scz), _mm_div_ps(one, scy));
+		__m128 iz = Select(singular, _mm_mul_ps(scx, scy), _mm_div_ps(one, scz));
+		__m128 iw = Select(singular, _mm_mul_ps(_mm_mul_ps(scx, scy), scz), one);
+		__m128 d0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r00, px), _mm_mul_ps(r01, py)), _mm_mul_ps(r02, pz));
+		__m128 d1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r10, px), _mm_mul_ps(r11, py)), _mm_mul_ps(r12, pz));
+		__m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r20, px), _mm_mul_ps(r21, py)), _mm_mul_ps(r22, pz));
+		StoreRows(localInverseTransposes, first, 0, _mm_mul_ps(r00, ix), _mm_mul_ps(r01, ix), _mm_mul_ps(r02, ix), _mm_sub_ps(zero, _mm_mul_ps(d0, ix)));
+		StoreRows(localInverseTransposes, first, 1, _mm_mul_ps(r10, iy), _mm_mul_ps(r11, iy), _mm_mul_ps(r12, iy), _mm_sub_ps(zero, _mm_mul_ps(d1, iy)));
+		StoreRows(localInverseTransposes, first, 2, _mm_mul_ps(r20, iz), _mm_mul_ps(r21, iz), _mm_mul_ps(r22, iz), _mm_sub_ps(zero, _mm_mul_ps(d2, iz)));
+		StoreRows(localInverseTransposes, first, 3, zero, zero, zero, iw);
+
+		// The whole group is now clean; the lanes that were dirty have
+		// new values, so their versions move on and anything composed
+		// from them goes stale (the others came out the same)
+		uint64_t dirtyLanes = (localDirty[first / SlotsPerWord] >> (first % SlotsPerWord)) & 0xF;
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			if ((dirtyLanes >> lane) & 1)
+				versions[first + lane]++;
+		}
+		localDirty[first / SlotsPerWord] &= ~(0xFull << (first % SlotsPerWord));
+	}
+
+	// Whether a slot with a parent needs composing, given an up to
+	// date parent and local values
+	bool NeedsCompose(unsigned int slot)
+	{
+		return versions[slot] != composedVersions[slot] || versions[parents[slot]] != composedParentVersions[slot];
+	}
+
+	// --------------------------------------------------------
+	// Composes a slot's world values from its local values and
+	// its parent's world values, which must be up to date
+	// --------------------------------------------------------
+	void Compose(unsigned int slot)
+	{
+		unsigned int parent = parents[slot];
+		bool parentIsRoot = parents[parent] == TransformSystem::NoSlot;
+		XMMATRIX parentWorld = XMLoadFloat4x4(parentIsRoot ? &localMatrices[parent] : &worldMatrices[parent]);
+		XMMATRIX parentInverseTranspose = XMLoadFloat4x4(parentIsRoot ? &localInverseTransposes[parent] : &worldInverseTransposes[parent]);
+
+		XMStoreFloat4x4(&worldMatrices[slot], XMLoadFloat4x4(&localMatrices[slot]) * parentWorld);
+		XMStoreFloat4x4(&worldInverseTransposes[slot], XMLoadFloat4x4(&localInverseTransposes[slot]) * parentInverseTranspose);
+
+		XMStoreFloat3(&worldRights[slot], XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(rightX[slot], rightY[slot], rightZ[slot], 0), parentWorld)));
+		XMStoreFloat3(&worldUps[slot], XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(upX[slot], upY[slot], upZ[slot], 0), parentWorld)));
+		XMStoreFloat3(&worldForwards[slot], XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(forwardX[slot], forwardY[slot], forwardZ[slot], 0), parentWorld)));
+
+		versions[slot]++;
+		composedVersions[slot] = versions[slot];
+		composedParentVersions[slot] = versions[parent];
+	}
+
+	// --------------------------------------------------------
+	// Brings one slot, and any stale parents, up to date before
+	// it's read
+	// --------------------------------------------------------
+	void Refresh(unsigned int slot)
+	{
+		if (parents[slot] == TransformSystem::NoSlot)
+		{
+			if (IsSet(localDirty, slot))
+				UpdateGroup(slot & ~3u);
+			return;
+		}
+
+		// Nothing to write if the whole chain is current, so reads
+		// between passes leave the versions alone
+		bool stale = false;
+		for (unsigned int s = slot; s != TransformSystem::NoSlot && !stale; s = parents[s])
+			stale = IsSet(localDirty, s) || (parents[s] != TransformSystem::NoSlot && NeedsCompose(s));
+
+		if (!stale)
+			return;
+
+		std::vector<unsigned int> chain;
+		for (unsigned int s = slot; s != TransformSystem::NoSlot; s = parents[s])
+			chain.push_back(s);
+
+		// From the root down, so each parent is current before its child
+		// is checked against it
+		for (size_t i = chain.size(); i > 0; i--)
+		{
+			unsigned int s = chain[i - 1];
+			if (IsSet(localDirty, s))
+				UpdateGroup(s & ~3u);
+			if (parents[s] != TransformSystem::NoSlot && NeedsCompose(s))
+				Compose(s);
+		}
+	}
+
+	// Removes a slot from its parent's list of children
+	void Unlink(unsigned int slot)
+	{
+		unsigned int parent = parents[slot];
+		if (parent == TransformSystem::NoSlot)
+			return;
+
+		if (previousSiblings[slot] != TransformSystem::NoSlot)
+			nextSiblings[previousSiblings[slot]] = nextSiblings[slot];
+		else
+			firstChildren[parent] = nextSiblings[slot];
+
+		if (nextSiblings[slot] != TransformSystem::NoSlot)
+			previousSiblings[nextSiblings[slot]] = previousSiblings[slot];
+
+		parents[slot] = TransformSystem::NoSlot;
+		nextSiblings[slot] = TransformSystem::NoSlot;
+		previousSiblings[slot] = TransformSystem::NoSlot;
+		childCount--;
+	}
+
+	// --------------------------------------------------------
+	// Puts a slot and everything below it in the levels for
+	// their depths, after the slot's parent has changed
+	// - Parents are placed before their children, whose depth
+	//   follows from theirs
+	// --------------------------------------------------------
+	void MoveSubtreeLevels(unsigned int slot)
+	{
+		subtreeStack.assign(1, slot);
+		while (!subtreeStack.empty())
+		{
+			unsigned int s = subtreeStack.back();
+			subtreeStack.pop_back();
+
+			// Out of the old level, swapping the level's last slot into its place
+			if (depths[s] > 0)
+			{
+				std::vector<unsigned int>& level = hierarchyLevels[depths[s] - 1];
+				unsigned int last = level.back();
+				level[levelPositions[s]] = last;
+				levelPositions[last] = levelPositions[s];
+				level.pop_back();
+			}
+
+			// Into the new one
+			depths[s] = parents[s] == TransformSystem::NoSlot ? 0 : depths[parents[s]] + 1;
+			if (depths[s] > 0)
+			{
+				if (hierarchyLevels.size() < depths[s])
+					hierarchyLevels.resize(depths[s]);
+
+				std::vector<unsigned int>& level = hierarchyLevels[depths[s] - 1];
+				levelPositions[s] = (unsigned int)level.size();
+				level.push_back(s);
+			}
+
+			for (unsigned int child = firstChildren[s]; child != TransformSystem::NoSlot; child = nextSiblings[child])
+				subtreeStack.push_back(child);
+		}
+
+		while (!hierarchyLevels.empty() && hierarchyLevels.back().empty())
+			hierarchyLevels.pop_back();
+	}
+}
+
+
+// --------------------------------------------------------
+// Slot lifetime
+// --------------------------------------------------------
+unsigned int TransformSystem::Create(Transform* owner)
+{
+	if (freeSlots.empty())
+		Grow();
+
+	unsigned int slot = freeSlots.back();
+	freeSlots.pop_back();
+	owners[slot] = owner;
+	versions[slot]++;
+	liveCount++;
+
+	// Free slots already hold the identity, including derived values
+	return slot;
+}
+
+unsigned int TransformSystem::Clone(unsigned int source, Transform* owner)
+{
+	unsigned int slot = Create(owner);
+	CopyTo(source, slot);
+	return slot;
+}
+
+void TransformSystem::CopyTo(unsigned int source, unsigned int destination)
+{
+	if (source == destination)
+		return;
+
+	SetPosition(destination, GetPosition(source));
+	SetRotation(destination, GetRotation(source));
+	SetScale(destination, GetScale(source));
+	SetParent(destination, parents[source]);
+}
+
+// --------------------------------------------------------
+// Frees a slot
+//
+// - Its children become roots where they are in the world
+//   (see DetachInPlace())
+// --------------------------------------------------------
+void TransformSystem::Destroy(unsigned int slot)
+{
+	while (firstChildren[slot] != NoSlot)
+		DetachInPlace(firstChildren[slot]);
+	SetParent(slot, NoSlot);
+
+	// Back to the identity, so the group update stays harmless
+	SetPosition(slot, XMFLOAT3(0, 0, 0));
+	SetRotation(slot, XMFLOAT4(0, 0, 0, 1));
+	SetScale(slot, XMFLOAT3(1, 1, 1));
+
+	owners[slot] = nullptr;
+	freeSlots.push_back(slot);
+	liveCount--;
+}
+
+
+// --------------------------------------------------------
+// Components
+// --------------------------------------------------------
+XMFLOAT3 TransformSystem::GetPosition(unsigned int slot) { return XMFLOAT3(positionX[slot], positionY[slot], positionZ[slot]); }
+XMFLOAT4 TransformSystem::GetRotation(unsigned int slot) { return XMFLOAT4(rotationX[slot], rotationY[slot], rotationZ[slot], rotationW[slot]); }
+XMFLOAT3 TransformSystem::GetScale(unsigned int slot) { return XMFLOAT3(scaleX[slot], scaleY[slot], scaleZ[slot]); }
+
+void TransformSystem::SetPosition(unsigned int slot, XMFLOAT3 position)
+{
+	positionX[slot] = position.x;
+	positionY[slot] = position.y;
+	positionZ[slot] = position.z;
+	SetBit(localDirty, slot);
+}
+
+void TransformSystem::SetRotation(unsigned int slot, XMFLOAT4 rotation)
+{
+	rotationX[slot] = rotation.x;
+	rotationY[slot] = rotation.y;
+	rotationZ[slot] = rotation.z;
+	rotationW[slot] = rotation.w;
+	SetBit(localDirty, slot);
+}
+
+void TransformSystem::SetScale(unsigned int slot, XMFLOAT3 scale)
+{
+	scaleX[slot] = scale.x;
+	scaleY[slot] = scale.y;
+	scaleZ[slot] = scale.z;
+	SetBit(localDirty, slot);
+}
+
+
+// --------------------------------------------------------
+// Hierarchy
+// --------------------------------------------------------
+
+// --------------------------------------------------------
+// Moves a slot (and everything below it) under a new parent,
+// or makes it a root when the parent is NoSlot
+// - Throws if the new parent is the slot itself or below it
+// --------------------------------------------------------
+void TransformSystem::SetParent(unsigned int slot, unsigned int parent)
+{
+	if (parents[slot] == parent)
+		return;
+
+	for (unsigned int s = parent; s != NoSlot; s = parents[s])
+	{
+		if (s == slot)
+			throw std::invalid_argument("A transform can't be parented to itself or its descendants");
+	}
+
+	Unlink(slot);
+
+	if (parent != NoSlot)
+	{
+		parents[slot] = parent;
+		nextSiblings[slot] = firstChildren[parent];
+		if (firstChildren[parent] != NoSlot)
+			previousSiblings[firstChildren[parent]] = slot;
+		firstChildren[parent] = slot;
+		childCount++;
+	}
+
+	// Its world values (and so its subtree's) change with the parent
+	versions[slot]++;
+	MoveSubtreeLevels(slot);
+}
+
+// --------------------------------------------------------
+// Makes a slot a root without moving it in the world
+//
+// - Its world matrix is split back into components, which
+//   drops any shear a non-uniformly scaled parent gave it
+// - A world matrix with a zero scale can't be split, so the
+//   slot keeps its local values instead
+// --------------------------------------------------------
+void TransformSystem::DetachInPlace(unsigned int slot)
+{
+	XMFLOAT4X4 world = GetWorldMatrix(slot);
+	SetParent(slot, NoSlot);
+
+	XMVECTOR scale, rotation, position;
+	if (!XMMatrixDecompose(&scale, &rotation, &position, XMLoadFloat4x4(&world)))
+		return;
+
+	XMFLOAT3 newScale, newPosition;
+	XMFLOAT4 newRotation;
+	XMStoreFloat3(&newScale, scale);
+	XMStoreFloat4(&newRotation, XMQuaternionNormalize(rotation));
+	XMStoreFloat3(&newPosition, position);
+	SetPosition(slot, newPosition);
+	SetRotation(slot, newRotation);
+	SetScale(slot, newScale);
+}
+
+unsigned int TransformSystem::GetParent(unsigned int slot) { return parents[slot]; }
+Transform* TransformSystem::GetOwner(unsigned int slot) { return slot == NoSlot ? nullptr : owners[slot]; }
+
+void TransformSystem::SetOwner(unsigned int slot, Transform* owner)
+{
+	if (slot != NoSlot)
+		owners[slot] = owner;
+}
+
+
+// --------------------------------------------------------
+// Derived values
+// --------------------------------------------------------
+unsigned int TransformSystem::GetVersion(unsigned int slot)
+{
+	Refresh(slot);
+	return versions[slot];
+}
+
+XMFLOAT4X4 TransformSystem::GetWorldMatrix(unsigned int slot)
+{
+	Refresh(slot);
+	return parents[slot] == NoSlot ? localMatrices[slot] : worldMatrices[slot];
+}
+
+XMFLOAT4X4 TransformSystem::GetWorldInverseTranspose(unsigned int slot)
+{
+	Refresh(slot);
+	return parents[slot] == NoSlot ? localInverseTransposes[slot] : worldInverseTransposes[slot];
+}
+
+XMFLOAT3 TransformSystem::GetRight(unsigned int slot)
+{
+	Refresh(slot);
+	return parents[slot] == NoSlot ? XMFLOAT3(rightX[slot], rightY[slot], rightZ[slot]) : worldRights[slot];
+}
+
+XMFLOAT3 TransformSystem::GetUp(unsigned int slot)
+{
+	Refresh(slot);
+	return parents[slot] == NoSlot ? XMFLOAT3(upX[slot], upY[slot], upZ[slot]) : worldUps[slot];
+}
+
+XMFLOAT3 TransformSystem::GetForward(unsigned int slot)
+{
+	Refresh(slot);
+	return parents[slot] == NoSlot ? XMFLOAT3(forwardX[slot], forwardY[slot], forwardZ[slot]) : worldForwards[slot];
+}
+
+
+// --------------------------------------------------------
+// Updates everything that changed since the last pass, spread
+// over the job system: dirty local values first, then the
+// hierarchy a level at a time
+// --------------------------------------------------------
+void TransformSystem::UpdateDirty()
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::atomic<size_t> updated = 0;
+	JobSystem::ParallelFor(localDirty.size(), LocalPassGrain, [&](size_t begin, size_t end)
+	{
+		size_t count = 0;
+		for (size_t word = begin; word < end; word++)
+		{
+			if (localDirty[word] == 0)
+				continue;
+
+			for (unsigned int group = 0; group < SlotsPerWord; group += 4)
+			{
+				if ((localDirty[word] >> group) & 0xF)
+				{
+					UpdateGroup((unsigned int)(word * SlotsPerWord + group));
+					count += 4;
+				}
+			}
+		}
+		updated += count;
+	});
+
+	std::atomic<size_t> composed = 0;
+	for (const std::vector<unsigned int>& level : hierarchyLevels)
+	{
+		JobSystem::ParallelFor(level.size(), ComposeGrain, [&](size_t begin, size_t end)
+		{
+			size_t count = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				// The level above is finished, so the parent's version is final
+				unsigned int slot = level[i];
+				if (NeedsCompose(slot))
+				{
+					Compose(slot);
+					count++;
+				}
+			}
+			composed += count;
+		});
+	}
+
+	lastUpdateCount = updated;
+	lastComposeCount = composed;
+	lastUpdateMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+TransformSystem::Stats TransformSystem::GetStats()
+{
+	Stats stats = {};
+	stats.transformCount = liveCount;
+	stats.capacity = positionX.size();
+	stats.childCount = childCount;
+	stats.hierarchyDepth = (unsigned int)hierarchyLevels.size();
+	stats.lastUpdateCount = lastUpdateCount;
+	stats.lastComposeCount = lastComposeCount;
+	stats.lastUpdateMs = lastUpdateMs;
+	return stats;
+}
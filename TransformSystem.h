@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <DirectXMath.h>
+
+class Transform;
+
+// --------------------------------------------------------
+// Storage for every Transform, as structure-of-arrays
+// - Changes mark slots dirty, and UpdateDirty() recomputes
+//   them four at a time; reads of a dirty slot update it first
+// - Children are always composed after their parents
+// - Only the main thread creates or changes transforms
+// --------------------------------------------------------
+namespace TransformSystem
+{
+	// "No parent"
+	const unsigned int NoSlot = 0xFFFFFFFF;
+
+	// Counts for reporting
+	struct Stats
+	{
+		size_t transformCount;		// Live slots
+		size_t capacity;			// Allocated slots, live or free
+		size_t childCount;			// Live slots with a parent
+		unsigned int hierarchyDepth;	// Levels below the roots
+		size_t lastUpdateCount;		// Slots whose local values the last UpdateDirty() recomputed
+		size_t lastComposeCount;	// Children whose world values it recomputed
+		double lastUpdateMs;
+	};
+
+	// Slot lifetime
+	// - New slots hold the identity transform, with no parent
+	// - Copies take the source's parent too, but not its children
+	// - Destroying a parent detaches its children in place
+	unsigned int Create(Transform* owner);
+	unsigned int Clone(unsigned int source, Transform* owner);
+	void CopyTo(unsigned int source, unsigned int destination);
+	void Destroy(unsigned int slot);
+
+	// Components
+	// - Rotations are unit quaternions
+	DirectX::XMFLOAT3 GetPosition(unsigned int slot);
+	DirectX::XMFLOAT4 GetRotation(unsigned int slot);
+	DirectX::XMFLOAT3 GetScale(unsigned int slot);
+	void SetPosition(unsigned int slot, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int slot, DirectX::XMFLOAT4 rotation);
+	void SetScale(unsigned int slot, DirectX::XMFLOAT3 scale);
+
+	// Hierarchy
+	// - The child keeps its components, so it moves with the parent
+	//   from where the parent puts it
+	void SetParent(unsigned int slot, unsigned int parent);
+	void DetachInPlace(unsigned int slot);		// Becomes a root, keeping its world placement
+	unsigned int GetParent(unsigned int slot);
+	Transform* GetOwner(unsigned int slot);
+	void SetOwner(unsigned int slot, Transform* owner);	// For Transforms that move in memory
+
+	// Rises whenever the slot's world values may have changed (and
+	// when the slot is reused), so anything derived from them can be
+	// cached against it; brought up to date first, like the values
+	unsigned int GetVersion(unsigned int slot);
+
+	// Derived values in world space, brought up to date first if the
+	// slot (or anything above it) has changed
+	DirectX::XMFLOAT4X4 GetWorldMatrix(unsigned int slot);
+	DirectX::XMFLOAT4X4 GetWorldInverseTranspose(unsigned int slot);
+	DirectX::XMFLOAT3 GetRight(unsigned int slot);
+	DirectX::XMFLOAT3 GetUp(unsigned int slot);
+	DirectX::XMFLOAT3 GetForward(unsigned int slot);
+
+	// Recomputes every dirty slot (called once a frame, after the
+	// frame's changes and before drawing)
+	void UpdateDirty();
+
+	// Reporting
+	Stats GetStats();
+}
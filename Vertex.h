@@ -14,4 +14,28 @@ struct Vertex
 	DirectX::XMFLOAT3 normal;
 	DirectX::XMFLOAT3 tangent;
 
-};
\ No newline at end of file
+};
+
+// --------------------------------------------------------
+// A quantized version of Vertex, less than half the size
+//
+// - See VertexPacking for encoding and decoding these, and
+//   VertexShaderPacked.hlsl for the matching shader input
+// --------------------------------------------------------
+struct PackedVertex
+{
+	unsigned short position[4];	// R16G16B16A16_UNORM, xyz relative to the mesh's bounds
+								// and w the tangent's handedness (0 = -1, 1 = +1)
+	unsigned short uv[2];		// R16G16_FLOAT
+	short normal[2];			// R16G16_SNORM, octahedral encoded
+	short tangent[2];			// R16G16_SNORM, octahedral encoded
+};
+
+// --------------------------------------------------------
+// Tags for the different vertex layouts a mesh can use
+// --------------------------------------------------------
+enum class VertexLayout : unsigned int
+{
+	Standard = 0,	// The full precision Vertex above
+	Packed = 1		// PackedVertex
+};
@@ -0,0 +1,234 @@
+#include "VertexPacking.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	// Float in [0, 1] to and from UNORM16, rounding to nearest
+	unsigned short ToUnorm16(float value)
+	{
+		value = std::clamp(value, 0.0f, 1.0f);
+		return (unsigned short)(value * 65535.0f + 0.5f);
+	}
+
+	float FromUnorm16(unsigned short value)
+	{
+		return value / 65535.0f;
+	}
+
+	// Float in [-1, 1] to and from SNORM16, rounding to nearest
+	short ToSnorm16(float value)
+	{
+		value = std::clamp(value, -1.0f, 1.0f);
+		return (short)roundf(value * 32767.0f);
+	}
+
+	float FromSnorm16(short value)
+	{
+		// -32768 and -32767 both decode to -1
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	// Like copysign(1, value), used when folding the octahedron
+	float SignNotZero(float value)
+	{
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// Angle between two directions, in degrees
+	// - Uses atan2 rather than acos, which can't resolve the tiny
+	//   angles packing produces in single precision
+	float AngleBetween(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		XMVECTOR va = XMVector3Normalize(XMLoadFloat3(&a));
+		XMVECTOR vb = XMVector3Normalize(XMLoadFloat3(&b));
+		float sine = XMVectorGetX(XMVector3Length(XMVector3Cross(va, vb)));
+		float cosine = XMVectorGetX(XMVector3Dot(va, vb));
+		return XMConvertToDegrees(atan2f(sine, cosine));
+	}
+}
+
+
+// --------------------------------------------------------
+// Size of a single vertex in the given layout
+// --------------------------------------------------------
+size_t VertexPacking::StrideOf(VertexLayout layout)
+{
+	return layout == VertexLayout::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+// --------------------------------------------------------
+// Local space bounds of all the vertex positions
+// --------------------------------------------------------
+void VertexPacking::ComputeBounds(const Vertex* vertices, size_t vertexCount, XMFLOAT3& boundsMin, XMFLOAT3& boundsMax)
+{
+	if (vertexCount == 0)
+	{
+		boundsMin = boundsMax = XMFLOAT3(0, 0, 0);
+		return;
+	}
+
+	XMVECTOR minimum = XMLoadFloat3(&vertices[0].Position);
+	XMVECTOR maximum = minimum;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&vertices[i].Position);
+		minimum = XMVectorMin(minimum, position);
+		maximum = XMVectorMax(maximum, position);
+	}
+
+	XMStoreFloat3(&boundsMin, minimum);
+	XMStoreFloat3(&boundsMax, maximum);
+}
+
+// --------------------------------------------------------
+// Spreads the 16-bit range of each axis over the bounds
+//
+// - Flat axes get a scale of 1 so encoding never divides by 0
+// --------------------------------------------------------
+PositionQuantization VertexPacking::QuantizationFromBounds(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax)
+{
+	PositionQuantization quantization;
+	quantization.offset = boundsMin;
+	quantization.scale = XMFLOAT3(
+		boundsMax.x > boundsMin.x ? boundsMax.x - boundsMin.x : 1.0f,
+		boundsMax.y > boundsMin.y ? boundsMax.y - boundsMin.y : 1.0f,
+		boundsMax.z > boundsMin.z ? boundsMax.z - boundsMin.z : 1.0f);
+	return quantization;
+}
+
+// --------------------------------------------------------
+// Octahedral encoding of a unit vector (Cigolle et al, "A
+// Survey of Efficient Representations for Independent Unit
+// Vectors")
+// --------------------------------------------------------
+void VertexPacking::EncodeOctahedral(const XMFLOAT3& direction, short encoded[2])
+{
+	float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if (length == 0.0f)
+	{
+		encoded[0] = encoded[1] = 0;
+		return;
+	}
+
+	float x = direction.x / length;
+	float y = direction.y / length;
+	if (direction.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float foldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = foldedX;
+		y = foldedY;
+	}
+
+	encoded[0] = ToSnorm16(x);
+	encoded[1] = ToSnorm16(y);
+}
+
+// --------------------------------------------------------
+// Decodes an octahedral unit vector (see DecodeOctahedral()
+// in GlobalShaderStructs.hlsli for the shader version)
+// --------------------------------------------------------
+XMFLOAT3 VertexPacking::DecodeOctahedral(const short encoded[2])
+{
+	float x = FromSnorm16(encoded[0]);
+	float y = FromSnorm16(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+
+	// Unfold the lower half
+	if (z < 0.0f)
+	{
+		float unfoldedX = (1.0f - fabsf(y)) * SignNotZero(x);
+		float unfoldedY = (1.0f - fabsf(x)) * SignNotZero(y);
+		x = unfoldedX;
+		y = unfoldedY;
+	}
+
+	XMFLOAT3 direction;
+	XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(x, y, z, 0)));
+	return direction;
+}
+
+// --------------------------------------------------------
+// Packs a single vertex
+//
+// - Handedness is the sign of the bitangent, stored so that
+//   mirrored uvs can be supported later (Vertex has no
+//   handedness of its own, so this is usually +1)
+// --------------------------------------------------------
+PackedVertex VertexPacking::Pack(const Vertex& vertex, const PositionQuantization& quantization, float handedness)
+{
+	PackedVertex packed;
+	packed.position[0] = ToUnorm16((vertex.Position.x - quantization.offset.x) / quantization.scale.x);
+	packed.position[1] = ToUnorm16((vertex.Position.y - quantization.offset.y) / quantization.scale.y);
+	packed.position[2] = ToUnorm16((vertex.Position.z - quantization.offset.z) / quantization.scale.z);
+	packed.position[3] = handedness < 0.0f ? 0 : 65535;
+
+	packed.uv[0] = XMConvertFloatToHalf(vertex.uv.x);
+	packed.uv[1] = XMConvertFloatToHalf(vertex.uv.y);
+
+	EncodeOctahedral(vertex.normal, packed.normal);
+	EncodeOctahedral(vertex.tangent, packed.tangent);
+	return packed;
+}
+
+// --------------------------------------------------------
+// Unpacks a single vertex, exactly as the packed vertex
+// shader would (handedness is dropped)
+// --------------------------------------------------------
+Vertex VertexPacking::Unpack(const PackedVertex& packed, const PositionQuantization& quantization)
+{
+	Vertex vertex;
+	vertex.Position.x = quantization.offset.x + FromUnorm16(packed.position[0]) * quantization.scale.x;
+	vertex.Position.y = quantization.offset.y + FromUnorm16(packed.position[1]) * quantization.scale.y;
+	vertex.Position.z = quantization.offset.z + FromUnorm16(packed.position[2]) * quantization.scale.z;
+
+	vertex.uv.x = XMConvertHalfToFloat(packed.uv[0]);
+	vertex.uv.y = XMConvertHalfToFloat(packed.uv[1]);
+
+	vertex.normal = DecodeOctahedral(packed.normal);
+	vertex.tangent = DecodeOctahedral(packed.tangent);
+	return vertex;
+}
+
+// --------------------------------------------------------
+// Packs every vertex in a mesh
+// --------------------------------------------------------
+std::vector<PackedVertex> VertexPacking::PackAll(const Vertex* vertices, size_t vertexCount, const PositionQuantization& quantization)
+{
+	std::vector<PackedVertex> packed(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		packed[i] = Pack(vertices[i], quantization);
+
+	return packed;
+}
+
+// --------------------------------------------------------
+// Packs and unpacks every vertex, reporting the worst error
+// in each attribute
+// --------------------------------------------------------
+PackingError VertexPacking::MeasureError(const Vertex* vertices, size_t vertexCount, const PositionQuantization& quantization)
+{
+	PackingError error = {};
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const Vertex& original = vertices[i];
+		Vertex decoded = Unpack(Pack(original, quantization), quantization);
+
+		XMVECTOR offset = XMLoadFloat3(&original.Position) - XMLoadFloat3(&decoded.Position);
+		error.position = std::max(error.position, XMVectorGetX(XMVector3Length(offset)));
+
+		error.uv = std::max({ error.uv,
+			fabsf(original.uv.x - decoded.uv.x),
+			fabsf(original.uv.y - decoded.uv.y) });
+
+		error.normalDegrees = std::max(error.normalDegrees, AngleBetween(original.normal, decoded.normal));
+		error.tangentDegrees = std::max(error.tangentDegrees, AngleBetween(original.tangent, decoded.tangent));
+	}
+
+	return error;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <DirectXMath.h>
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// How positions map to and from their 16-bit normalized form
+//
+// - position = offset + normalized * scale, where offset and
+//   scale come from the mesh's bounds
+// --------------------------------------------------------
+struct PositionQuantization
+{
+	DirectX::XMFLOAT3 offset;
+	DirectX::XMFLOAT3 scale;
+};
+
+// --------------------------------------------------------
+// The largest errors packing introduced over a set of vertices
+// --------------------------------------------------------
+struct PackingError
+{
+	float position;			// Distance in local space units
+	float uv;				// Largest difference in either coordinate
+	float normalDegrees;	// Angle between original and decoded normal
+	float tangentDegrees;	// Angle between original and decoded tangent
+};
+
+// --------------------------------------------------------
+// Conversions between Vertex and PackedVertex
+//
+// - Decoding here matches what the GPU does when it reads
+//   UNORM, SNORM and FLOAT16 vertex formats, so the error
+//   measured on the CPU is the error seen when drawing
+// --------------------------------------------------------
+namespace VertexPacking
+{
+	// Size of a single vertex in the given layout
+	size_t StrideOf(VertexLayout layout);
+
+	// Bounds of all the vertex positions, and the quantization that fills them
+	void ComputeBounds(const Vertex* vertices, size_t vertexCount, DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax);
+	PositionQuantization QuantizationFromBounds(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+
+	// Unit vectors to and from two 16-bit normalized values, which
+	// come back within this many degrees of where they started
+	const float OctahedralErrorDegrees = 0.005f;
+	void EncodeOctahedral(const DirectX::XMFLOAT3& direction, short encoded[2]);
+	DirectX::XMFLOAT3 DecodeOctahedral(const short encoded[2]);
+
+	// Single vertices
+	PackedVertex Pack(const Vertex& vertex, const PositionQuantization& quantization, float handedness = 1.0f);
+	Vertex Unpack(const PackedVertex& packed, const PositionQuantization& quantization);
+
+	// Whole meshes
+	std::vector<PackedVertex> PackAll(const Vertex* vertices, size_t vertexCount, const PositionQuantization& quantization);
+	PackingError MeasureError(const Vertex* vertices, size_t vertexCount, const PositionQuantization& quantization);
+}
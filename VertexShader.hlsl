@@ -2,16 +2,19 @@
 
 
 // HLSL cbuffer			
+// - world and worldInvTranspose come from Objects instead
 cbuffer ConstantBuffer : register(b0) // The slot that the buffer is binded too (in VSSetConstantBuffers)
 {
-    float4x4 world; 
     float4x4 view;
     float4x4 projection;
-	float4x4 worldInvTranspose;
 	matrix lightView;
 	matrix lightProjection;
+	uint objectIndex;
 }
 
+// Every object's matrices (see ObjectCache)
+StructuredBuffer<ObjectData> Objects : register(t0);
+
 // --------------------------------------------------------
 // The entry point (main method) for our vertex shader
 // 
@@ -24,6 +27,10 @@ VertexToPixel main( VertexShaderInput input )
 	// Set up output struct
 	VertexToPixel output;
 
+	ObjectData object = Objects[objectIndex];
+	matrix world = object.world;
+	matrix worldInvTranspose = object.worldInvTranspose;
+
 	// Multiplying the 3 matricies together
     matrix wvp = mul(projection, mul(view, world));
 
@@ -47,7 +54,6 @@ VertexToPixel main( VertexShaderInput input )
 	// - The values will be interpolated per-pixel by the rasterizer
 	// - We don't need to alter it here, but we do need to send it to the pixel shader
 	output.uv = input.uv;
-	output.normal = input.normal;
 
 	// World, view, projection matrix calculation for shadow maps
 	matrix shadowWVP = mul(lightProjection, mul(lightView, world));
@@ -0,0 +1,44 @@
+#include "GlobalShaderStructs.hlsli"
+
+
+// HLSL cbuffer
+// - world and worldInvTranspose come from Objects instead
+cbuffer ConstantBuffer : register(b0)
+{
+    float4x4 view;
+    float4x4 projection;
+    matrix lightView;
+    matrix lightProjection;
+}
+
+// Every object's matrices, indexed by the instance data
+StructuredBuffer<ObjectData> Objects : register(t0);
+
+// --------------------------------------------------------
+// Same as VertexShader.hlsl, but for instanced draws, with
+// each instance's matrices looked up by the index in input slot 1
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput input, InstanceInput instance)
+{
+    VertexToPixel output;
+
+    ObjectData object = Objects[instance.objectIndex];
+    matrix world = object.world;
+    matrix worldInvTranspose = object.worldInvTranspose;
+
+    matrix wvp = mul(projection, mul(view, world));
+    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+
+    output.normal = mul((float3x3)worldInvTranspose, input.normal);
+    output.tangent = mul((float3x3)world, input.tangent);
+
+    output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
+
+    output.uv = input.uv;
+
+    // World, view, projection matrix calculation for shadow maps
+    matrix shadowWVP = mul(lightProjection, mul(lightView, world));
+    output.shadowMapPos = mul(shadowWVP, float4(input.localPosition, 1.0f));
+
+    return output;
+}
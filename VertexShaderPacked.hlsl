@@ -0,0 +1,56 @@
+#include "GlobalShaderStructs.hlsli"
+
+
+// HLSL cbuffer
+// - world and worldInvTranspose come from Objects instead
+cbuffer ConstantBuffer : register(b0)
+{
+    float4x4 view;
+    float4x4 projection;
+    matrix lightView;
+    matrix lightProjection;
+    uint objectIndex;
+
+    // Dequantization for positions (see PositionQuantization)
+    float3 positionOffset;
+    float3 positionScale;
+}
+
+// Every object's matrices (see ObjectCache)
+StructuredBuffer<ObjectData> Objects : register(t0);
+
+// --------------------------------------------------------
+// Same as VertexShader.hlsl, but for meshes using PackedVertex
+//
+// - Positions are rebuilt from the mesh bounds and normals and
+//   tangents are decoded, then everything continues as usual
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput_Packed input)
+{
+    VertexToPixel output;
+
+    ObjectData object = Objects[objectIndex];
+    matrix world = object.world;
+    matrix worldInvTranspose = object.worldInvTranspose;
+
+    // Decode the packed attributes
+    float3 localPosition = positionOffset + input.localPosition.xyz * positionScale;
+    float3 normal = DecodeOctahedral(input.normal);
+    float3 tangent = DecodeOctahedral(input.tangent);
+
+    matrix wvp = mul(projection, mul(view, world));
+    output.screenPosition = mul(wvp, float4(localPosition, 1.0f));
+
+    output.normal = mul((float3x3)worldInvTranspose, normal);
+    output.tangent = mul((float3x3)world, tangent);
+
+    output.worldPosition = mul(world, float4(localPosition, 1)).xyz;
+
+    output.uv = input.uv;
+
+    // World, view, projection matrix calculation for shadow maps
+    matrix shadowWVP = mul(lightProjection, mul(lightView, world));
+    output.shadowMapPos = mul(shadowWVP, float4(localPosition, 1.0f));
+
+    return output;
+}